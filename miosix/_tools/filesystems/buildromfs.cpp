@@ -32,33 +32,65 @@ int main(int argc, char *argv[])
 {
     if(argc<4)
     {
-        cerr<<"Miosix buildromfs utility v2.00"<<endl
-            <<"use: buildromfs <target file> --from-directory <source directory>"<<endl;
+        cerr<<"Miosix buildromfs utility v2.02"<<endl
+            <<"use: buildromfs <target file> --from-directory <source directory> [options]"<<endl
+            <<"options:"<<endl
+            <<"--no-index builds a RomFs 2.01 image, for kernels without directory index support"<<endl
+            <<"--convert <ext> <newext> <command> converts files with extension <ext> before"<<endl
+            <<"  storing them with extension <newext>, running <command> where %in is replaced"<<endl
+            <<"  with the source file and %out with the converted file. Can be repeated"<<endl;
         return 1;
     }
 
+    // Parse options
+    bool dirIndex=true;
+    list<FileConverter> converters;
+    filesystem::path tempDir=filesystem::temp_directory_path()
+                            /("buildromfs-"+to_string(getpid()));
+    for(int i=4;i<argc;i++)
+    {
+        string option=argv[i];
+        if(option=="--no-index") dirIndex=false;
+        else if(option=="--convert" && i+3<argc)
+        {
+            converters.emplace_back(argv[i+1],argv[i+2],argv[i+3],tempDir);
+            i+=3;
+        } else {
+            cerr<<option<<": unsupported option"<<endl;
+            return 1;
+        }
+    }
+    if(!converters.empty()) filesystem::create_directory(tempDir);
+
     // Build the tree of files and directories that compose the image
     string mode=argv[2];
     FilesystemEntry root;
     int uidGidOverride=0; //TODO: for now force all uid and gid to 0 (root)
+    int result=0;
     if(mode=="--from-directory")
     {
-        if(int result=buildFromDir(root,argv[3],uidGidOverride)!=0) return result;
+        result=buildFromDir(root,argv[3],uidGidOverride,converters);
     } else {
         cerr<<argv[2]<<": unsupported option"<<endl;
-        return 1;
+        result=1;
     }
 
-    // Open the output image
-    fstream io(argv[1], ios::in | ios::out | ios::trunc | ios::binary);
-    if(!io)
+    if(result==0)
     {
-        cerr<<"Can't open otput file "<<argv[1]<<endl;
-        return 1;
+        // Open the output image
+        fstream io(argv[1], ios::in | ios::out | ios::trunc | ios::binary);
+        if(!io)
+        {
+            cerr<<"Can't open otput file "<<argv[1]<<endl;
+            result=1;
+        } else {
+            // Build the image and write it to file
+            MkRomFs img(io,root,dirIndex);
+            cout<<"RomFs size "<<img.size()<<endl;
+        }
     }
 
-    // Build the image and write it to file
-    MkRomFs img(io,root);
-    cout<<"RomFs size "<<img.size()<<endl;
-    return 0;
+    // Converted files are no longer needed once the image is written
+    if(!converters.empty()) filesystem::remove_all(tempDir);
+    return result;
 }
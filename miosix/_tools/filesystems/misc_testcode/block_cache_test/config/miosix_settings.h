@@ -0,0 +1,5 @@
+// Host stub of config/miosix_settings.h
+
+#pragma once
+
+#define WITH_FILESYSTEM
@@ -0,0 +1,29 @@
+// Host stub of filesystem/file.h, only what BlockCache needs
+
+#pragma once
+
+#include <memory>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace miosix {
+
+#define intrusive_ref_ptr std::shared_ptr
+
+class FilesystemBase {};
+
+class FileBase
+{
+public:
+    FileBase(intrusive_ref_ptr<FilesystemBase> parent, int flags) {}
+    virtual ssize_t write(const void *data, size_t len)=0;
+    virtual ssize_t read(void *data, size_t len)=0;
+    virtual off_t lseek(off_t pos, int whence)=0;
+    virtual int fstat(struct stat *pstat) const=0;
+    virtual int ioctl(int cmd, void *arg) { return -ENOTTY; }
+    virtual ~FileBase() {}
+};
+
+} //namespace miosix
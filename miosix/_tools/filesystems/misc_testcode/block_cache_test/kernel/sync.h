@@ -0,0 +1,12 @@
+// Host stub of kernel/sync.h, only what BlockCache needs
+
+#pragma once
+
+#include <mutex>
+
+namespace miosix {
+
+using FastMutex=std::mutex;
+template<typename T> using Lock=std::lock_guard<T>;
+
+} //namespace miosix
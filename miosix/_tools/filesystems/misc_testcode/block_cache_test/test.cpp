@@ -0,0 +1,207 @@
+// Host test of the BlockCache write-back sector cache, using a RAM-backed
+// block device. Compile from this directory with
+// g++ -std=c++14 -O2 -I. -I../../../.. -o t test.cpp
+//     ../../../../filesystem/block_cache/block_cache.cpp && ./t
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include "filesystem/block_cache/block_cache.h"
+#include "filesystem/ioctl.h"
+
+using namespace std;
+using namespace miosix;
+
+/**
+ * Block device backed by RAM, counting device accesses
+ */
+class RamDisk : public FileBase
+{
+public:
+    RamDisk(unsigned int numSectors)
+        : FileBase(intrusive_ref_ptr<FilesystemBase>(),O_RDWR),
+          data(numSectors*BlockCache::sectorSize,0) {}
+
+    ssize_t write(const void *buf, size_t len) override
+    {
+        if(pos+len>data.size()) return -EIO;
+        memcpy(data.data()+pos,buf,len);
+        pos+=len;
+        writes++;
+        return len;
+    }
+
+    ssize_t read(void *buf, size_t len) override
+    {
+        if(pos+len>data.size()) return -EIO;
+        memcpy(buf,data.data()+pos,len);
+        pos+=len;
+        reads++;
+        return len;
+    }
+
+    off_t lseek(off_t p, int whence) override
+    {
+        switch(whence)
+        {
+            case SEEK_SET: pos=p; break;
+            case SEEK_CUR: pos+=p; break;
+            case SEEK_END: pos=data.size()+p; break;
+            default: return -EINVAL;
+        }
+        return pos;
+    }
+
+    int fstat(struct stat *pstat) const override
+    {
+        memset(pstat,0,sizeof(struct stat));
+        pstat->st_size=data.size();
+        return 0;
+    }
+
+    int ioctl(int cmd, void *arg) override
+    {
+        if(cmd!=IOCTL_SYNC) return -ENOTTY;
+        syncs++;
+        return 0;
+    }
+
+    vector<unsigned char> data;
+    off_t pos=0;
+    unsigned int reads=0, writes=0, syncs=0;
+};
+
+static void check(bool x, const char *msg)
+{
+    if(x) return;
+    cout<<"Test failed: "<<msg<<endl;
+    exit(1);
+}
+
+static BlockCacheStats getStats(BlockCache& cache)
+{
+    BlockCacheStats s;
+    check(cache.ioctl(IOCTL_CACHE_STATS,&s)==0,"ioctl");
+    return s;
+}
+
+/**
+ * Randomized test, compares the content seen through the cache with a shadow
+ * copy, and the device with the shadow copy after each sync
+ */
+static void consistency(unsigned int cacheSize, unsigned int readAhead)
+{
+    const unsigned int sectors=64;
+    const unsigned int size=sectors*BlockCache::sectorSize;
+    auto disk=make_shared<RamDisk>(sectors);
+    for(auto& c : disk->data) c=rand();
+    vector<unsigned char> shadow=disk->data;
+    {
+        BlockCache cache(disk,cacheSize,readAhead);
+        vector<unsigned char> buf(4*BlockCache::sectorSize);
+        for(int i=0;i<20000;i++)
+        {
+            unsigned int pos=rand()%size;
+            unsigned int len=min<unsigned int>(rand()%buf.size()+1,size-pos);
+            check(cache.lseek(pos,SEEK_SET)==pos,"lseek");
+            switch(rand()%5)
+            {
+                case 0:
+                case 1:
+                    for(unsigned int j=0;j<len;j++) buf[j]=rand();
+                    check(cache.write(buf.data(),len)==len,"write");
+                    memcpy(shadow.data()+pos,buf.data(),len);
+                    break;
+                case 2:
+                case 3:
+                    check(cache.read(buf.data(),len)==len,"read");
+                    check(memcmp(buf.data(),shadow.data()+pos,len)==0,"data");
+                    break;
+                case 4:
+                    check(cache.ioctl(IOCTL_SYNC,nullptr)==0,"sync");
+                    check(disk->data==shadow,"device content after sync");
+                    break;
+            }
+        }
+        BlockCacheStats s=getStats(cache);
+        cout<<"cache "<<cacheSize<<" read-ahead "<<readAhead<<": "<<s.hits
+            <<" hits "<<s.misses<<" misses "<<s.readAhead<<" read ahead "
+            <<s.writeBacks<<" written back"<<endl;
+    }
+    check(disk->data==shadow,"device content after destruction");
+}
+
+/**
+ * Repeated small writes to the same sector, as a filesystem does when updating
+ * the FAT while logging, must not reach the device until a sync
+ */
+static void writeBack()
+{
+    auto disk=make_shared<RamDisk>(64);
+    BlockCache cache(disk,8,4);
+    unsigned char record[16];
+    for(int i=0;i<1000;i++)
+    {
+        memset(record,i,sizeof(record));
+        cache.lseek(2*BlockCache::sectorSize+(i%32)*sizeof(record),SEEK_SET);
+        check(cache.write(record,sizeof(record))==sizeof(record),"write");
+        cache.lseek(40*BlockCache::sectorSize+(i%32)*sizeof(record),SEEK_SET);
+        check(cache.write(record,sizeof(record))==sizeof(record),"write");
+    }
+    check(disk->writes==0,"write before sync");
+    check(cache.ioctl(IOCTL_SYNC,nullptr)==0,"sync");
+    check(disk->writes==2 && disk->syncs==1,"write count after sync");
+    check(disk->data[2*BlockCache::sectorSize+(999%32)*sizeof(record)]==(999 & 0xff),
+          "data after sync");
+    //Consecutive dirty sectors are merged in a single write
+    for(int i=10;i<14;i++)
+    {
+        cache.lseek(i*BlockCache::sectorSize,SEEK_SET);
+        cache.write(record,sizeof(record));
+    }
+    disk->writes=0;
+    check(cache.ioctl(IOCTL_SYNC,nullptr)==0,"sync");
+    check(disk->writes==1,"merged write");
+    cout<<"Write back test passed"<<endl;
+}
+
+/**
+ * Sequential reads must be served with fewer device accesses when read-ahead
+ * is enabled, including at the end of the device
+ */
+static void sequential()
+{
+    const unsigned int sectors=100;
+    unsigned int reads[2];
+    for(int k=0;k<2;k++)
+    {
+        auto disk=make_shared<RamDisk>(sectors);
+        for(unsigned int i=0;i<disk->data.size();i++) disk->data[i]=i/7;
+        BlockCache cache(disk,16,k==0 ? 0 : 8);
+        unsigned char buf[BlockCache::sectorSize];
+        for(unsigned int i=0;i<sectors;i++)
+        {
+            check(cache.read(buf,sizeof(buf))==sizeof(buf),"read");
+            check(memcmp(buf,disk->data.data()+i*sizeof(buf),sizeof(buf))==0,
+                  "data");
+        }
+        check(cache.read(buf,sizeof(buf))<0,"read past end");
+        reads[k]=disk->reads;
+    }
+    cout<<"Sequential read of "<<sectors<<" sectors: "<<reads[0]
+        <<" device reads without read-ahead, "<<reads[1]<<" with"<<endl;
+    check(reads[1]<reads[0]/4,"read-ahead");
+}
+
+int main()
+{
+    writeBack();
+    sequential();
+    consistency(2,0);
+    consistency(4,2);
+    consistency(16,0);
+    consistency(16,8);
+    consistency(100,8);
+    cout<<"All tests passed"<<endl;
+}
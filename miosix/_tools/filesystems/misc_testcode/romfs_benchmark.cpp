@@ -0,0 +1,168 @@
+// Host benchmark of RomFs path lookup, comparing "RomFs 2.01" images, whose
+// directories are scanned linearly, with "RomFs 2.02" images, whose
+// directories have a hash index. Directories are searched with
+// romFsFindInDirectory(), the same code used by MemoryMappedRomFs.
+// Built by the CMakeLists.txt in the parent directory
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include "tree.h"
+#include "mkromfs.h"
+
+using namespace std;
+
+/**
+ * Lookup paths in an in-memory RomFs image
+ */
+class RomFsLookup
+{
+public:
+    RomFsLookup(const string& image) : image(image)
+    {
+        auto header=ptr<const RomFsHeader*>(0);
+        hashed=strcmp(header->fsName,"RomFs 2.02")==0;
+    }
+
+    /**
+     * \param path path relative to the image root, without leading /
+     * \return the entry, or nullptr if not found
+     */
+    const RomFsDirectoryEntry *find(const string& path)
+    {
+        auto entry=ptr<const RomFsDirectoryEntry*>(sizeof(RomFsHeader));
+        char element[256];
+        for(size_t begin=0;begin<path.size();)
+        {
+            size_t end=min(path.find('/',begin),path.size());
+            if(end-begin>=sizeof(element)) return nullptr;
+            memcpy(element,path.data()+begin,end-begin);
+            element[end-begin]='\0';
+            begin=end+1;
+            if((fromLittleEndian(entry->mode) & S_IFMT)!=S_IFDIR)
+                return nullptr;
+            entry=findInDirectory(entry,element);
+            if(entry==nullptr) return nullptr;
+        }
+        return entry;
+    }
+
+    /**
+     * \return the target of a symlink entry
+     */
+    string target(const RomFsDirectoryEntry *entry)
+    {
+        return string(ptr(fromLittleEndian(entry->inode)),
+                      fromLittleEndian(entry->size));
+    }
+
+    bool hashed; ///< Image has directory indices
+
+private:
+    const RomFsDirectoryEntry *findInDirectory(const RomFsDirectoryEntry *dir,
+                                               const char *name)
+    {
+        return romFsFindInDirectory(image.data(),dir,name,hashed,
+            [](unsigned int x) { return fromLittleEndian(x); });
+    }
+
+    /**
+     * \return a 32 bit field of the image, stored little endian, in the
+     * host byte order
+     */
+    static unsigned int fromLittleEndian(unsigned int x)
+    {
+        auto b=reinterpret_cast<const unsigned char*>(&x);
+        return b[0] | b[1]<<8 | b[2]<<16 | static_cast<unsigned int>(b[3])<<24;
+    }
+
+    /**
+     * \return a 16 bit field of the image, stored little endian, in the
+     * host byte order
+     */
+    static unsigned short fromLittleEndian(unsigned short x)
+    {
+        auto b=reinterpret_cast<const unsigned char*>(&x);
+        return b[0] | b[1]<<8;
+    }
+
+    template<typename T=const char*>
+    T ptr(unsigned int offset) { return reinterpret_cast<T>(image.data()+offset); }
+
+    const string& image;
+};
+
+/**
+ * Generate a directory tree with symlinks in place of files, so that no host
+ * file is needed. Each symlink target is its own path, to verify lookups
+ */
+static void generate(FilesystemEntry& dir, const string& path, int depth,
+                     int numFiles, vector<string>& paths)
+{
+    for(int i=0;i<numFiles;i++)
+    {
+        FilesystemEntry e;
+        e.mode=S_IFLNK | 0777;
+        e.name="asset_"+to_string(rand())+"_"+to_string(i)+".bin";
+        e.path=path+e.name;
+        paths.push_back(e.path);
+        dir.addEntryToDirectory(std::move(e));
+    }
+    if(depth==0) return;
+    for(int i=0;i<8;i++)
+    {
+        FilesystemEntry d;
+        d.mode=S_IFDIR | 0755;
+        d.name="dir"+to_string(i);
+        generate(d,path+d.name+"/",depth-1,numFiles,paths);
+        dir.addEntryToDirectory(std::move(d));
+    }
+}
+
+static void benchmark(const string& image, const vector<string>& paths,
+                      int iterations)
+{
+    RomFsLookup fs(image);
+    for(auto& p : paths)
+    {
+        auto e=fs.find(p);
+        if(e==nullptr || fs.target(e)!=p)
+        {
+            cout<<"Lookup of "<<p<<" failed"<<endl;
+            exit(1);
+        }
+        if(fs.find(p+"x")!=nullptr)
+        {
+            cout<<"Lookup of nonexistent "<<p<<"x succeeded"<<endl;
+            exit(1);
+        }
+    }
+    auto start=chrono::steady_clock::now();
+    for(int i=0;i<iterations;i++) for(auto& p : paths) fs.find(p);
+    auto end=chrono::steady_clock::now();
+    auto ns=chrono::duration_cast<chrono::nanoseconds>(end-start).count();
+    cout<<(fs.hashed ? "RomFs 2.02 (hash index)" : "RomFs 2.01 (linear scan)")
+        <<": image size "<<image.size()<<", "
+        <<ns/(static_cast<long long>(iterations)*paths.size())
+        <<"ns per path lookup"<<endl;
+}
+
+int main(int argc, char *argv[])
+{
+    int numFiles=argc>1 ? atoi(argv[1]) : 200;
+    FilesystemEntry root;
+    root.mode=S_IFDIR | 0755;
+    vector<string> paths;
+    generate(root,"",2,numFiles,paths);
+    cout<<paths.size()<<" files, "<<numFiles<<" per directory"<<endl;
+    for(bool dirIndex : {false,true})
+    {
+        stringstream io;
+        MkRomFs img(io,root,dirIndex);
+        benchmark(io.str(),paths,10);
+    }
+}
@@ -20,6 +20,7 @@
 #include <cstring>
 #include <fstream>
 #include <list>
+#include <vector>
 #include <cassert>
 #include <algorithm>
 #include <stdexcept>
@@ -70,14 +71,17 @@ public:
      * Everything is done in the constructor, the class exists as a convenience
      * \param io iostream where the image will be built
      * \param root root of the directory tree
+     * \param dirIndex if true build a "RomFs 2.02" image with a hash index for
+     * every directory, otherwise build a "RomFs 2.01" image without indices
      */
-    MkRomFs(std::iostream& io, const FilesystemEntry& root) : img(io)
+    MkRomFs(std::iostream& io, const FilesystemEntry& root, bool dirIndex=true)
+        : img(io), dirIndex(dirIndex)
     {
         // Construct the filesystem header
         RomFsHeader header;
         memset(&header,0,sizeof(RomFsHeader));
         strncpy(header.marker,"wwwww",6);
-        strncpy(header.fsName,"RomFs 2.01",11);
+        strncpy(header.fsName,dirIndex ? "RomFs 2.02" : "RomFs 2.01",11);
         strncpy(header.osName,"Miosix",7);
         //header.imageSize still unknown at this point
         auto headerOffset=img.append(header,romFsStructAlignment);
@@ -161,6 +165,9 @@ private:
         // NOTE: Must be done before we recursively add the directory content!
         auto size=img.size()-inode; //inode is also address of first byte
 
+        // The index follows the entries, and is not part of the directory size
+        if(dirIndex) addDirectoryIndex(dir,inode,entryOffsets);
+
         // Then for each entry, recursively add the content
         list<InodeInfo> entryContent;
         for(auto& d : dir.directoryEntries)
@@ -194,6 +201,34 @@ private:
         return InodeInfo(inode,size);
     }
 
+    /**
+     * Add the hash index of a directory to the image
+     * \param dir directory whose index is added
+     * \param inode inode of the directory
+     * \param entryOffsets offsets in the image of the directory entries
+     */
+    void addDirectoryIndex(const FilesystemEntry& dir, unsigned int inode,
+                           const std::list<unsigned int>& entryOffsets)
+    {
+        using namespace std;
+
+        // Load factor at most 75%, and always at least one empty bucket
+        unsigned int n=entryOffsets.size();
+        unsigned int numBuckets=1;
+        while(numBuckets<=n || numBuckets*3<n*4) numBuckets*=2;
+        vector<unsigned int> buckets(numBuckets,0);
+        auto o=begin(entryOffsets);
+        for(auto& d : dir.directoryEntries)
+        {
+            unsigned int i=romFsHash(d.name.c_str());
+            while(buckets[i & (numBuckets-1)]!=0) i++; //Linear probing
+            buckets[i & (numBuckets-1)]=*o++-inode;
+        }
+
+        img.append(toLittleEndian32(numBuckets),romFsStructAlignment);
+        for(auto b : buckets) img.append(toLittleEndian32(b));
+    }
+
     /**
      * Add a file inode to the image
      * \param dir directory to add
@@ -228,4 +263,5 @@ private:
     }
 
     Image<unsigned int> img; ///< Backing storage
+    bool dirIndex;           ///< Add directory hash indices
 };
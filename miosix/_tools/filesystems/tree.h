@@ -20,6 +20,8 @@
 #include <iostream>
 #include <filesystem>
 #include <list>
+#include <string>
+#include <cstdlib>
 #include <cassert>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -91,14 +93,98 @@ public:
     std::list<FilesystemEntry> directoryEntries;
 };
 
+/**
+ * Converts files with a given extension while building the image by running
+ * an external command, for example to store images already decoded
+ */
+class FileConverter
+{
+public:
+    /**
+     * Constructor
+     * \param from extension of the files to convert, without the dot
+     * \param to extension the converted files will have in the image
+     * \param command command that converts a file, where %in is replaced
+     * with the source file and %out with the file to produce
+     * \param tempDir directory where converted files are stored until the
+     * image is written
+     */
+    FileConverter(const std::string& from, const std::string& to,
+                  const std::string& command,
+                  const std::filesystem::path& tempDir)
+        : from("."+from), to("."+to), command(command), tempDir(tempDir) {}
+
+    /**
+     * \param file a file in the source directory
+     * \return true if this converter handles the file
+     */
+    bool matches(const std::filesystem::path& file) const
+    {
+        return file.extension()==from;
+    }
+
+    /**
+     * Convert a file
+     * \param entry entry whose path is the file to convert. On success path
+     * is replaced with the converted file, and the extension of name with the
+     * new one
+     * \return 0 on success
+     */
+    int convert(FilesystemEntry& entry) const
+    {
+        using namespace std;
+        using namespace std::filesystem;
+        path out=tempDir / (to_string(counter++)+to);
+        string cmd=command;
+        substitute(cmd,"%in",entry.path);
+        substitute(cmd,"%out",out.string());
+        if(system(cmd.c_str())!=0 || !is_regular_file(out))
+        {
+            cerr<<entry.path<<": conversion failed"<<endl;
+            return 1;
+        }
+        entry.path=out;
+        entry.name=path(entry.name).replace_extension(to);
+        return 0;
+    }
+
+private:
+    /**
+     * Replace all occurrences of a placeholder with a path, quoted for the
+     * shell run by system(). Single quotes in the path are closed, escaped
+     * and reopened, so that spaces and quotes in file names are preserved
+     */
+    static void substitute(std::string& cmd, const std::string& placeholder,
+                           const std::string& value)
+    {
+        std::string quoted="'";
+        for(char c : value)
+        {
+            if(c=='\'') quoted+="'\\''";
+            else quoted+=c;
+        }
+        quoted+="'";
+        for(auto pos=cmd.find(placeholder);pos!=std::string::npos;
+            pos=cmd.find(placeholder,pos+quoted.size()))
+            cmd.replace(pos,placeholder.size(),quoted);
+    }
+
+    std::string from, to, command;
+    std::filesystem::path tempDir;
+    static inline int counter=0; ///< To give converted files unique names
+};
+
 /**
  * Recursively build a FilesystemEntry tree starting from a root directory
  * \param entry an empty FilesystemEntry that will become the root of the tree
  * \param directory path to a directory on the host machine
  * \param uidGidOverride if >=0 set all files uid and gid to the given number
+ * \param converters files matching one of these are converted before being
+ * added to the tree
  */
 inline int buildFromDir(FilesystemEntry& entry,
-                        const std::filesystem::path& directory, int uidGidOverride=-1)
+                        const std::filesystem::path& directory, int uidGidOverride=-1,
+                        const std::list<FileConverter>& converters={})
 {
     using namespace std;
     using namespace std::filesystem;
@@ -120,7 +206,8 @@ inline int buildFromDir(FilesystemEntry& entry,
         bool good=true;
         if(is_directory(it->status()))
         {
-            if(int result=buildFromDir(subentry, it->path(), uidGidOverride))
+            if(int result=buildFromDir(subentry, it->path(), uidGidOverride,
+                                       converters))
                 return result;
         } else {
             struct stat st;
@@ -133,6 +220,12 @@ inline int buildFromDir(FilesystemEntry& entry,
             {
                 case S_IFREG:
                     subentry.path=it->path();
+                    for(auto& c : converters)
+                    {
+                        if(!c.matches(it->path())) continue;
+                        if(int result=c.convert(subentry)) return result;
+                        break;
+                    }
                     break;
                 case S_IFLNK:
                     subentry.path=read_symlink(it->path());
@@ -720,6 +720,41 @@ getppid:
 
 /* TODO: missing syscalls: getuid, getgid, geteuid, getegid, setuid, setgid */
 
+/**
+ * __futex, nonstandard syscall used to implement pthread mutexes and condvars
+ * \param addr address of the futex word
+ * \param op FUTEX_WAIT (0) or FUTEX_WAKE (1)
+ * \param val expected futex word value for FUTEX_WAIT, max number of threads
+ * to wake for FUTEX_WAKE
+ * \return 0 or the number of woken threads on success, a negative error code
+ * on failure. errno is not set, as callers retry on their own
+ */
+.section .text.__futex
+.global __futex
+.type __futex, %function
+__futex:
+	movs r3, #53
+	svc  0
+	bx   lr
+
+/**
+ * ppoll, wait for a set of file descriptors to become ready
+ * \param fds array of struct pollfd
+ * \param nfds number of elements in fds
+ * \param timeout pointer to relative timeout, or NULL to wait forever
+ * \param sigmask ignored, as there are no signals
+ * \return the number of ready file descriptors, 0 on timeout, -1 on failure
+ */
+.section .text.ppoll
+.global ppoll
+.type ppoll, %function
+ppoll:
+	movs r3, #54
+	svc  0
+	cmp  r0, #0
+	blt  syscallfailed32
+	bx   lr
+
 /* common jump target for all failing syscalls with 32 bit return value */
 .section .text.__seterrno32
 syscallfailed32:
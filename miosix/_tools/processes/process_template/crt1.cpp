@@ -28,6 +28,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <climits>
 #include <errno.h>
 #include <unistd.h>
 #include <pthread.h>
@@ -39,6 +40,7 @@
 #include <sys/wait.h>
 #include <reent.h>
 #include <cxxabi.h>
+#include "poll.h"
 
 extern "C" {
 
@@ -347,10 +349,192 @@ pid_t wait(int *status)
     return waitpid(-1,status,0);
 }
 
-// TODO: implement when processes can spawn threads
-int pthread_mutex_unlock(pthread_mutex_t *mutex)  { return 0; }
-int pthread_mutex_lock(pthread_mutex_t *mutex)    { return 0; }
-int pthread_mutex_destroy(pthread_mutex_t *mutex) { return 0; }
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if(timeout<0) return ppoll(fds,nfds,nullptr,nullptr);
+    struct timespec t;
+    t.tv_sec=timeout/1000;
+    t.tv_nsec=(timeout%1000)*1000000;
+    return ppoll(fds,nfds,&t,nullptr);
+}
+
+//
+// Futex based pthread mutexes and condition variables
+// ===================================================
+//
+// The owner field of a mutex is used as the futex word, and can be
+// 0 (unlocked), 1 (locked, no waiters) or 2 (locked, possibly with waiters).
+// The uncontended lock and unlock are a single atomic operation, the __futex
+// syscall is only used to sleep on a contended mutex and to wake a waiter.
+// For recursive mutexes the first field holds the owner thread identity, and
+// the recursive field the additional lock depth.
+// Condition variables use the first field as a futex word that is incremented
+// at every signal/broadcast, and the last field as the number of waiters, so
+// that signaling a condition variable nobody waits on does not need a syscall.
+
+enum { FUTEX_WAIT=0, FUTEX_WAKE=1 };
+
+/**
+ * \internal
+ * Futex syscall, implemented in crt0.s
+ */
+int __futex(volatile int *addr, int op, int val);
+
+/**
+ * \internal
+ * \return the futex word of a mutex
+ */
+static inline volatile int *mutexWord(pthread_mutex_t *mutex)
+{
+    return reinterpret_cast<volatile int*>(&mutex->owner);
+}
+
+/**
+ * \internal
+ * \return an identity of the calling thread, used by recursive mutexes
+ */
+static inline WaitingList *threadId()
+{
+    return reinterpret_cast<WaitingList*>(__getreent());
+}
+
+/**
+ * \internal
+ * Slow path of pthread_mutex_lock, sleep until the mutex is released. The
+ * mutex is acquired in the contended state, as other threads may be waiting
+ * \param w mutex futex word
+ */
+static void mutexLockSlow(volatile int *w)
+{
+    while(__atomic_exchange_n(w,2,__ATOMIC_ACQUIRE)!=0) __futex(w,FUTEX_WAIT,2);
+}
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr)
+{
+    mutex->owner=nullptr;
+    mutex->first=nullptr;
+    mutex->last=nullptr;
+    mutex->recursive=-1;
+    if(attr && attr->recursive==PTHREAD_MUTEX_RECURSIVE) mutex->recursive=0;
+    return 0;
+}
+
+int pthread_mutex_destroy(pthread_mutex_t *mutex)
+{
+    if(*mutexWord(mutex)!=0) return EBUSY;
+    return 0;
+}
+
+int pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    if(mutex->recursive>=0 && mutex->first==threadId())
+    {
+        mutex->recursive++;
+        return 0;
+    }
+    volatile int *w=mutexWord(mutex);
+    int c=0;
+    if(__atomic_compare_exchange_n(w,&c,1,false,__ATOMIC_ACQUIRE,
+        __ATOMIC_RELAXED)==false) mutexLockSlow(w);
+    if(mutex->recursive>=0) mutex->first=threadId();
+    return 0;
+}
+
+int pthread_mutex_trylock(pthread_mutex_t *mutex)
+{
+    if(mutex->recursive>=0 && mutex->first==threadId())
+    {
+        mutex->recursive++;
+        return 0;
+    }
+    int c=0;
+    if(__atomic_compare_exchange_n(mutexWord(mutex),&c,1,false,__ATOMIC_ACQUIRE,
+        __ATOMIC_RELAXED)==false) return EBUSY;
+    if(mutex->recursive>=0) mutex->first=threadId();
+    return 0;
+}
+
+int pthread_mutex_unlock(pthread_mutex_t *mutex)
+{
+    if(mutex->recursive>0)
+    {
+        mutex->recursive--;
+        return 0;
+    }
+    if(mutex->recursive==0) mutex->first=nullptr;
+    volatile int *w=mutexWord(mutex);
+    if(__atomic_exchange_n(w,0,__ATOMIC_RELEASE)==2) __futex(w,FUTEX_WAKE,1);
+    return 0;
+}
+
+/**
+ * \internal
+ * \return the futex word of a condition variable
+ */
+static inline volatile int *condWord(pthread_cond_t *cond)
+{
+    return reinterpret_cast<volatile int*>(&cond->first);
+}
+
+/**
+ * \internal
+ * \return the number of waiters of a condition variable
+ */
+static inline volatile int *condWaiters(pthread_cond_t *cond)
+{
+    return reinterpret_cast<volatile int*>(&cond->last);
+}
+
+int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr)
+{
+    cond->first=nullptr;
+    cond->last=nullptr;
+    return 0;
+}
+
+int pthread_cond_destroy(pthread_cond_t *cond) { return 0; }
+
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    volatile int *w=condWord(cond);
+    int seq=__atomic_load_n(w,__ATOMIC_RELAXED);
+    __atomic_fetch_add(condWaiters(cond),1,__ATOMIC_RELAXED);
+    //Recursive mutexes are fully released while waiting, as in the kernel
+    int depth=mutex->recursive;
+    if(depth>0) mutex->recursive=0;
+    pthread_mutex_unlock(mutex);
+    //If a signal happened after the unlock, seq has changed and we don't block
+    __futex(w,FUTEX_WAIT,seq);
+    __atomic_fetch_sub(condWaiters(cond),1,__ATOMIC_RELAXED);
+    //We can't know if other threads are waiting on the mutex, so lock it in
+    //the contended state to be sure that they will be woken up
+    mutexLockSlow(mutexWord(mutex));
+    if(depth>=0)
+    {
+        mutex->first=threadId();
+        mutex->recursive=depth;
+    }
+    return 0;
+}
+
+int pthread_cond_signal(pthread_cond_t *cond)
+{
+    volatile int *w=condWord(cond);
+    __atomic_fetch_add(w,1,__ATOMIC_RELEASE);
+    if(__atomic_load_n(condWaiters(cond),__ATOMIC_RELAXED)>0)
+        __futex(w,FUTEX_WAKE,1);
+    return 0;
+}
+
+int pthread_cond_broadcast(pthread_cond_t *cond)
+{
+    volatile int *w=condWord(cond);
+    __atomic_fetch_add(w,1,__ATOMIC_RELEASE);
+    if(__atomic_load_n(condWaiters(cond),__ATOMIC_RELAXED)>0)
+        __futex(w,FUTEX_WAKE,INT_MAX);
+    return 0;
+}
+
 int pthread_setcancelstate(int state, int *oldstate) { return 0; }
 
 int pthread_once(pthread_once_t *once, void (*func)())
@@ -4,6 +4,7 @@
 #include "testsuite_simple.h"
 #include "testsuite_sleep.h"
 #include "testsuite_system.h"
+#include "testsuite_futex.h"
 
 #ifdef WITH_FILESYSTEM
 #include "testsuite_file1.h"
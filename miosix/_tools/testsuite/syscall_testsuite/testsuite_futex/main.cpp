@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <pthread.h>
+#include <errno.h>
+
+namespace miosix { long long getTime(); }
+extern "C" int __futex(volatile int *addr, int op, int val);
+
+enum { FUTEX_WAIT=0, FUTEX_WAKE=1 };
+
+/*
+ * Futex syscall test and mutex contention benchmark.
+ * Processes can't spawn threads yet, so contention is emulated by marking the
+ * mutex as having waiters before unlocking it, which forces the unlock through
+ * the FUTEX_WAKE syscall as it happens when another thread is blocked on it.
+ * Exit code 0 means success, other values identify the failed check.
+ */
+
+int main()
+{
+    static volatile int word=0;
+    if(__futex(&word,FUTEX_WAIT,1)!=-EAGAIN) return 1; //Value mismatch
+    if(__futex(nullptr,FUTEX_WAIT,0)!=-EFAULT) return 2; //Not process memory
+    if(__futex(reinterpret_cast<volatile int*>(
+        reinterpret_cast<char*>(const_cast<int*>(&word))+1),FUTEX_WAKE,1)!=-EFAULT)
+        return 3; //Unaligned
+    if(__futex(&word,FUTEX_WAKE,1)!=0) return 4; //Nobody to wake
+    if(__futex(&word,42,0)!=-EINVAL) return 5; //Bad op
+
+    pthread_mutex_t m=PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t c=PTHREAD_COND_INITIALIZER;
+    const int n=10000;
+
+    long long t=miosix::getTime();
+    for(int i=0;i<n;i++)
+    {
+        pthread_mutex_lock(&m);
+        pthread_mutex_unlock(&m);
+    }
+    long long uncontended=miosix::getTime()-t;
+    if(*reinterpret_cast<volatile int*>(&m.owner)!=0) return 6;
+
+    t=miosix::getTime();
+    for(int i=0;i<n;i++)
+    {
+        pthread_mutex_lock(&m);
+        *reinterpret_cast<volatile int*>(&m.owner)=2; //Pretend there are waiters
+        pthread_mutex_unlock(&m);
+    }
+    long long contended=miosix::getTime()-t;
+    if(*reinterpret_cast<volatile int*>(&m.owner)!=0) return 7;
+
+    t=miosix::getTime();
+    for(int i=0;i<n;i++)
+    {
+        pthread_mutex_lock(&m);
+        pthread_cond_signal(&c); //Nobody waiting, no syscall
+        pthread_mutex_unlock(&m);
+    }
+    long long signal=miosix::getTime()-t;
+
+    printf("Futex benchmark, %d iterations\n"
+           "lock/unlock uncontended %lldns/iteration\n"
+           "lock/unlock contended   %lldns/iteration\n"
+           "lock/signal/unlock      %lldns/iteration\n",n,
+           uncontended/n,contended/n,signal/n);
+    return 0;
+}
@@ -62,6 +62,8 @@
 #include "e20/e20.h"
 #include "kernel/intrusive.h"
 #include "util/crc16.h"
+#include "filesystem/poll.h"
+#include "filesystem/pipe/pipe.h"
 
 #ifdef WITH_PROCESSES
 #include "kernel/elf_program.h"
@@ -139,12 +141,16 @@ static void fs_test_1();
 static void fs_test_2();
 static void fs_test_3();
 static void fs_test_4();
+static void fs_test_5();
 #endif //WITH_FILESYSTEM
 //Benchmark functions
 static void benchmark_1();
 static void benchmark_2();
 static void benchmark_3();
 static void benchmark_4();
+static void benchmark_5();
+static void benchmark_6();
+static void benchmark_7();
 //Exception thread safety test
 #ifndef __NO_EXCEPTIONS
 static void exception_test();
@@ -152,6 +158,7 @@ static void exception_test();
 
 #ifdef WITH_PROCESSES
 void syscall_test_sleep();
+void syscall_test_futex();
 void process_test_process_ret();
 #ifdef WITH_FILESYSTEM
 void syscall_test_files();
@@ -252,6 +259,7 @@ int main()
                 fs_test_2();
                 fs_test_3();
                 fs_test_4();
+                fs_test_5();
                 #else //WITH_FILESYSTEM
                 iprintf("Error, filesystem support is disabled\n");
                 #endif //WITH_FILESYSTEM
@@ -272,6 +280,9 @@ int main()
                 benchmark_2();
                 benchmark_3();
                 benchmark_4();
+                benchmark_5();
+                benchmark_6();
+                benchmark_7();
 
                 ledOff();
                 Thread::sleep(500);//Ensure all threads are deleted.
@@ -299,6 +310,7 @@ int main()
                 #endif //WITH_FILESYSTEM
 
                 syscall_test_sleep();
+                syscall_test_futex();
                 #else //WITH_PROCESSES
                 iprintf("Error, process support is disabled\n");
                 #endif //WITH_PROCESSES
@@ -507,6 +519,36 @@ void syscall_test_sleep()
 	pass();
 }
 
+void syscall_test_futex()
+{
+    test_name("System Call: futex");
+    ElfProgram prog(reinterpret_cast<const unsigned int*>(testsuite_futex_elf),testsuite_futex_elf_len);
+    int ret = 0;
+    pid_t p = Process::create(prog);
+    Process::waitpid(p, &ret, 0);
+    switch(WEXITSTATUS(ret))
+    {
+        case 0:
+            pass();
+            break;
+        case 1:
+            fail("FUTEX_WAIT did not return EAGAIN on value mismatch");
+            break;
+        case 2:
+        case 3:
+            fail("futex accepted an invalid address");
+            break;
+        case 4:
+            fail("FUTEX_WAKE woke a nonexistent thread");
+            break;
+        case 5:
+            fail("futex accepted an invalid operation");
+            break;
+        default:
+            fail("mutex left locked");
+    }
+}
+
 void syscall_test_files()
 {
 	test_name("System Call: open, read, write, seek, close, system");
@@ -4939,6 +4981,70 @@ static void fs_test_4()
     checkInodes("/sd/testdir",testdirIno,sdInode,sdDevice,sdDevice);
     pass();
 }
+
+//
+// Filesystem test 5
+//
+/*
+tests:
+pipe()
+poll()
+*/
+
+static void fs_test_5()
+{
+    test_name("Pipes and poll");
+    int p1[2], p2[2];
+    if(pipe(p1) || pipe(p2)) fail("pipe");
+    //Read end is not readable when empty, write end is writable
+    struct pollfd pfd[3];
+    pfd[0].fd=p1[0]; pfd[0].events=POLLIN;
+    pfd[1].fd=p2[0]; pfd[1].events=POLLIN;
+    pfd[2].fd=p1[1]; pfd[2].events=POLLOUT;
+    if(poll(pfd,3,0)!=1) fail("poll 1");
+    if(pfd[0].revents || pfd[1].revents || pfd[2].revents!=POLLOUT)
+        fail("revents 1");
+    //Wrong direction
+    char c='a';
+    if(read(p1[1],&c,1)!=-1 || errno!=EBADF) fail("read write end");
+    if(write(p1[0],&c,1)!=-1 || errno!=EBADF) fail("write read end");
+    //Timeout
+    long long t=getTime();
+    if(poll(pfd,2,50)!=0) fail("poll timeout");
+    if(getTime()-t<50000000LL) fail("timeout too short");
+    //A thread blocked in poll() is woken by a write on one of many pipes
+    std::thread writer([&]{
+        Thread::sleep(20);
+        if(write(p2[1],"x",1)!=1) fail("write 1");
+    });
+    if(poll(pfd,2,-1)!=1) fail("poll 2");
+    writer.join();
+    if(pfd[0].revents || pfd[1].revents!=POLLIN) fail("revents 2");
+    if(read(p2[0],&c,1)!=1 || c!='x') fail("read 1");
+    //Invalid file descriptors are reported, negative ones are ignored
+    pfd[0].fd=-1;
+    pfd[1].fd=MAX_OPEN_FILES-1;
+    if(poll(pfd,2,0)!=1) fail("poll 3");
+    if(pfd[0].revents || pfd[1].revents!=POLLNVAL) fail("revents 3");
+    //Closing the write end wakes up a blocked reader with end of file
+    std::thread closer([&]{
+        Thread::sleep(20);
+        if(close(p1[1])) fail("close 1");
+    });
+    t=getTime();
+    if(read(p1[0],&c,1)!=0) fail("eof");
+    closer.join();
+    if(getTime()-t>80000000LL) fail("eof not immediate");
+    pfd[0].fd=p1[0]; pfd[0].events=POLLIN;
+    if(poll(pfd,1,0)!=1 || pfd[0].revents!=POLLHUP) fail("pollhup");
+    //Closing the read end makes writes fail
+    if(close(p2[0])) fail("close 2");
+    if(write(p2[1],&c,1)!=-1 || errno!=EPIPE) fail("epipe");
+    pfd[0].fd=p2[1]; pfd[0].events=POLLOUT;
+    if(poll(pfd,1,0)!=1 || pfd[0].revents!=POLLERR) fail("pollerr");
+    if(close(p1[0]) || close(p2[1])) fail("close 3");
+    pass();
+}
 #endif //WITH_FILESYSTEM
 
 //
@@ -5063,11 +5169,33 @@ static int b2_f1(int priority)
     return b2_v2;
 }
 
+static void b2_p2(void *argv)
+{
+    //Stay blocked till terminated, to check that blocked threads do not slow
+    //down context switches
+    while(Thread::testTerminate()==false) Thread::wait();
+}
+
 static void benchmark_2()
 {
     #ifndef SCHED_TYPE_EDF
-    iprintf("%d context switch per second (max priority)\n",b2_f1(3));
+    iprintf("%d context switch per second (max priority)\n",b2_f1(PRIORITY_MAX-1));
     iprintf("%d context switch per second (min priority)\n",b2_f1(0));
+    const int numBlocked=16;
+    Thread *blocked[numBlocked];
+    int created=0;
+    for(int i=0;i<numBlocked;i++)
+    {
+        blocked[created]=Thread::create(b2_p2,STACK_SMALL,i%PRIORITY_MAX,NULL,
+                Thread::JOINABLE);
+        if(blocked[created]!=nullptr) created++;
+    }
+    iprintf("%d context switch per second (max priority, %d blocked threads)\n",
+            b2_f1(PRIORITY_MAX-1),created);
+    iprintf("%d context switch per second (min priority, %d blocked threads)\n",
+            b2_f1(0),created);
+    for(int i=0;i<created;i++) blocked[i]->terminate();
+    for(int i=0;i<created;i++) blocked[i]->join();
     #else //SCHED_TYPE_EDF
     iprintf("Context switch benchmark not possible with EDF\n");
     #endif //SCHED_TYPE_EDF
@@ -5173,6 +5301,21 @@ void b4_t1(void *argv)
     b4_end=true;
 }
 
+static Mutex b4_m;
+static int b4_count;
+
+void b4_t2(void *argv)
+{
+    (void)argv;
+    while(b4_end==false)
+    {
+        b4_m.lock();
+        b4_count++;
+        Thread::yield(); //Let the other threads pile up waiting on the mutex
+        b4_m.unlock();
+    }
+}
+
 static void benchmark_4()
 {
     Mutex m;
@@ -5256,6 +5399,239 @@ static void benchmark_4()
         i++;
     }
     iprintf("%d fast disable/enable interrupts pairs per second\n",i);
+
+    b4_end=false;
+    b4_count=0;
+    #ifndef SCHED_TYPE_EDF
+    //Highest priority, or the waiters would starve it
+    Thread::create(b4_t1,STACK_SMALL,PRIORITY_MAX-1);
+    #else
+    Thread::create(b4_t1,STACK_SMALL,0);
+    #endif
+    const int numWaiters=8;
+    Thread *waiters[numWaiters];
+    for(int j=0;j<numWaiters;j++)
+    {
+        //Different priorities to exercise priority inheritance
+        #ifndef SCHED_TYPE_EDF
+        waiters[j]=Thread::create(b4_t2,STACK_SMALL,j%(PRIORITY_MAX-1),nullptr,
+                Thread::JOINABLE);
+        #else
+        waiters[j]=Thread::create(b4_t2,STACK_SMALL,0,nullptr,Thread::JOINABLE);
+        #endif
+    }
+    for(int j=0;j<numWaiters;j++) if(waiters[j]) waiters[j]->join();
+    iprintf("%d contended Mutex lock/unlock pairs per second (%d threads)\n",
+            b4_count,numWaiters);
+}
+
+//
+// Benchmark 5
+//
+/*
+tests:
+sleeping list insertion/expiry time with interrupts disabled
+*/
+
+static void benchmark_5()
+{
+    //Mimic what IRQwakeThreads() and Thread::nanoSleepUntil() do to the
+    //sleeping list when many periodic threads sleep, using a local heap so as
+    //not to interfere with the kernel one
+    const int numSleepers[]={1,16,64,256};
+    for(int n : numSleepers)
+    {
+        IntrusivePairingHeap<SleepData> heap;
+        std::vector<SleepData> items;
+        try {
+            items.reserve(n);
+        } catch(std::bad_alloc&) {
+            iprintf("Not enough memory for %d sleepers\n",n);
+            break;
+        }
+        long long now=getTime();
+        for(int i=0;i<n;i++)
+        {
+            items.emplace_back(nullptr,now+rand()%10000000);
+            heap.push(&items.back());
+        }
+        long long maxTime=0, sumTime=0;
+        const int iterations=1000;
+        for(int i=0;i<iterations;i++)
+        {
+            long long period=rand()%10000000;
+            FastInterruptDisableLock dLock;
+            long long t0=IRQgetTime();
+            SleepData *d=heap.front();
+            heap.pop();
+            d->wakeupTime+=period;
+            heap.push(d);
+            long long t1=IRQgetTime();
+            maxTime=std::max(maxTime,t1-t0);
+            sumTime+=t1-t0;
+        }
+        iprintf("%d sleepers: sleeping list expiry+insert max %lldns avg %lldns "
+                "with interrupts disabled\n",n,maxTime,sumTime/iterations);
+    }
+}
+
+//
+// Benchmark 6
+//
+/*
+tests:
+C++ new/delete throughput of concurrently allocating threads
+worst case wakeup latency of a high priority thread while others allocate
+*/
+
+static volatile bool b6_end;
+static const int b6_numThreads=2;
+static unsigned int b6_count[b6_numThreads];
+
+static void *b6_alloc(void *argv)
+{
+    const int n=16;
+    char *ptrs[n]={nullptr};
+    unsigned int i=0;
+    while(b6_end==false)
+    {
+        int j=i%n;
+        delete[] ptrs[j];
+        ptrs[j]=new char[1+(i*37)%256];
+        i++;
+    }
+    for(int j=0;j<n;j++) delete[] ptrs[j];
+    b6_count[reinterpret_cast<int>(argv)]=i;
+    return nullptr;
+}
+
+static void *b6_latency(void *argv)
+{
+    long long maxLatency=0;
+    long long t=getTime();
+    for(int i=0;i<1000;i++)
+    {
+        t+=1000000+rand()%100000; //Don't synchronize with the time slice
+        Thread::nanoSleepUntil(t);
+        maxLatency=std::max(maxLatency,getTime()-t);
+    }
+    return reinterpret_cast<void*>(static_cast<int>(maxLatency));
+}
+
+/**
+ * \return the max wakeup latency in ns of a high priority thread
+ */
+static int b6_measureLatency()
+{
+    #ifndef SCHED_TYPE_EDF
+    Thread *t=Thread::create(b6_latency,STACK_SMALL,PRIORITY_MAX-1,nullptr,
+                             Thread::JOINABLE);
+    #else //SCHED_TYPE_EDF
+    Thread *t=Thread::create(b6_latency,STACK_SMALL,0,nullptr,Thread::JOINABLE);
+    #endif //SCHED_TYPE_EDF
+    void *result;
+    t->join(&result);
+    return reinterpret_cast<int>(result);
+}
+
+static void benchmark_6()
+{
+    iprintf("Max high priority wakeup latency, idle: %dns\n",
+            b6_measureLatency());
+    b6_end=false;
+    Thread *threads[b6_numThreads];
+    for(int i=0;i<b6_numThreads;i++)
+        threads[i]=Thread::create(b6_alloc,STACK_SMALL,0,
+                                  reinterpret_cast<void*>(i),Thread::JOINABLE);
+    long long start=getTime();
+    int latency=b6_measureLatency();
+    b6_end=true;
+    for(int i=0;i<b6_numThreads;i++) threads[i]->join();
+    long long elapsed=getTime()-start;
+    unsigned int total=0;
+    for(int i=0;i<b6_numThreads;i++) total+=b6_count[i];
+    iprintf("Max high priority wakeup latency, %d threads allocating: %dns\n",
+            b6_numThreads,latency);
+    iprintf("%d new/delete pairs per second\n",
+            static_cast<int>(total*1000000000ll/elapsed));
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    MemoryProfiling::print();
+    #endif //WITH_SMALL_OBJECT_HEAP
+}
+
+//
+// Benchmark 7
+//
+/*
+tests:
+pipe throughput with read()/write() with different pipe capacities
+pipe throughput with splice() to /dev/null
+*/
+
+#if defined(WITH_FILESYSTEM) && defined(WITH_DEVFS)
+static const int b7_total=256*1024;
+static const int b7_chunk=1024;
+static char b7_wbuf[b7_chunk];
+static char b7_rbuf[b7_chunk];
+
+static void *b7_writer(void *argv)
+{
+    int fd=reinterpret_cast<int>(argv);
+    for(int i=0;i<b7_total;i+=b7_chunk)
+        if(write(fd,b7_wbuf,b7_chunk)!=b7_chunk) fail("write");
+    if(close(fd)) fail("close"); //Reader gets end of file
+    return nullptr;
+}
+
+/**
+ * Move b7_total bytes from a writer thread through a pipe to /dev/null
+ * \param capacity pipe capacity
+ * \param useSplice if true use splice(), otherwise read()+write()
+ * \return throughput in KByte/s
+ */
+static int b7_run(int capacity, bool useSplice)
+{
+    int fds[2];
+    if(pipe(fds)) fail("pipe");
+    if(fcntl(fds[1],F_SETPIPE_SZ,capacity)!=capacity) fail("F_SETPIPE_SZ");
+    int null=open("/dev/null",O_WRONLY);
+    if(null<0) fail("open");
+    long long start=getTime();
+    Thread *t=Thread::create(b7_writer,STACK_SMALL,0,
+                             reinterpret_cast<void*>(fds[1]),Thread::JOINABLE);
+    int moved=0;
+    for(;;)
+    {
+        ssize_t result;
+        if(useSplice) result=splice(fds[0],nullptr,null,nullptr,b7_chunk,0);
+        else {
+            result=read(fds[0],b7_rbuf,b7_chunk);
+            if(result>0 && write(null,b7_rbuf,result)!=result) fail("write");
+        }
+        if(result<0) fail("transfer");
+        if(result==0) break;
+        moved+=result;
+    }
+    t->join();
+    long long elapsed=getTime()-start;
+    if(close(fds[0]) || close(null)) fail("close");
+    if(moved!=b7_total) fail("size");
+    return static_cast<int>(moved*1000000000LL/(1024*elapsed));
+}
+#endif //WITH_FILESYSTEM && WITH_DEVFS
+
+static void benchmark_7()
+{
+    #if defined(WITH_FILESYSTEM) && defined(WITH_DEVFS)
+    const int capacities[]={Pipe::defaultSize,1024,4096};
+    for(int capacity : capacities)
+    {
+        iprintf("Pipe capacity %d: read/write %dKB/s, splice %dKB/s\n",capacity,
+                b7_run(capacity,false),b7_run(capacity,true));
+    }
+    #else //WITH_FILESYSTEM && WITH_DEVFS
+    iprintf("Error, filesystem support is disabled\n");
+    #endif //WITH_FILESYSTEM && WITH_DEVFS
 }
 
 #ifdef WITH_PROCESSES
@@ -33,6 +33,7 @@
 #include "kernel/scheduler/scheduler.h"
 #include "interfaces/portability.h"
 #include "filesystem/ioctl.h"
+#include "filesystem/poll.h"
 #include "core/cache_cortexMx.h"
 
 using namespace std;
@@ -1190,6 +1191,19 @@ int STM32Serial::ioctl(int cmd, void* arg)
     }
 }
 
+#if defined(WITH_FILESYSTEM) || defined(WITH_DEVFS)
+int STM32Serial::poll(int events)
+{
+    //Writes are never refused, they only block until the data is sent
+    int result=events & (POLLOUT | POLLWRNORM);
+    //If the line is not yet idle readBlock() may wait for the end of the
+    //current burst of characters, but that's a bounded wait
+    FastInterruptDisableLock dLock;
+    if(!rxQueue.isEmpty()) result|=events & (POLLIN | POLLRDNORM);
+    return result;
+}
+#endif //WITH_FILESYSTEM || WITH_DEVFS
+
 void STM32Serial::IRQhandleInterrupt()
 {
     #if !defined(_ARCH_CORTEXM7_STM32F7) && !defined(_ARCH_CORTEXM7_STM32H7) \
@@ -1244,14 +1258,18 @@ void STM32Serial::IRQhandleInterrupt()
     if((status & USART_SR_IDLE) || rxQueue.size()>=rxQueueMin)
     {
         //Enough data in buffer or idle line, awake thread
+        bool hppw=false;
         if(rxWaiting)
         {
             rxWaiting->IRQwakeup();
             if(rxWaiting->IRQgetPriority()>
                 Thread::IRQgetCurrentThread()->IRQgetPriority())
-                    Scheduler::IRQfindNextThread();
+                    hppw=true;
             rxWaiting=0;
         }
+        //Also awake threads waiting in poll()
+        FileBase::IRQnotifyReadiness(hppw);
+        if(hppw) Scheduler::IRQfindNextThread();
     }
 }
 
@@ -1270,11 +1288,16 @@ void STM32Serial::IRQhandleDMArx()
 {
     IRQreadDma();
     idle=false;
-    if(rxWaiting==0) return;
-    rxWaiting->IRQwakeup();
-    if(rxWaiting->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
-        Scheduler::IRQfindNextThread();
-    rxWaiting=0;
+    bool hppw=false;
+    FileBase::IRQnotifyReadiness(hppw);
+    if(rxWaiting)
+    {
+        rxWaiting->IRQwakeup();
+        if(rxWaiting->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+            hppw=true;
+        rxWaiting=0;
+    }
+    if(hppw) Scheduler::IRQfindNextThread();
 }
 #endif //SERIAL_DMA
 
@@ -173,6 +173,15 @@ public:
      * \return the exact return value depends on CMD, -1 is returned on error
      */
     int ioctl(int cmd, void *arg);
+
+    #if defined(WITH_FILESYSTEM) || defined(WITH_DEVFS)
+    /**
+     * Check whether the serial port is ready for I/O, used to implement poll()
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready
+     */
+    int poll(int events);
+    #endif //WITH_FILESYSTEM || WITH_DEVFS
     
     /**
      * \internal the serial port interrupts call this member function.
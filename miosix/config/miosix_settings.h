@@ -76,6 +76,15 @@ namespace miosix {
 //#define SCHED_TYPE_CONTROL_BASED
 //#define SCHED_TYPE_EDF
 
+/// \def SCHED_PRIORITY_READY_QUEUE
+/// Only used by the priority scheduler. If uncommented, READY threads are kept
+/// in per-priority run queues indexed by a bitmap, so that selecting the next
+/// thread takes constant time regardless of the number of threads and of
+/// PRIORITY_MAX. Blocked and sleeping threads are not scanned at all during
+/// context switches. Limits PRIORITY_MAX to 32.
+/// By default it is defined.
+#define SCHED_PRIORITY_READY_QUEUE
+
 /// \def WITH_CPU_TIME_COUNTER
 /// Allows to enable/disable CPUTimeCounter to save code size and remove its
 /// overhead from the scheduling process. By default it is not defined
@@ -114,6 +123,23 @@ namespace miosix {
 /// By default it is defined (slow but safe)
 #define SYNC_AFTER_WRITE
 
+/// \def WITH_BLOCK_CACHE
+/// Adds a write-back sector cache between the filesystem mounted on /sd and
+/// its block device. Reduces repeated accesses to the same sectors, such as
+/// the FAT, and reads ahead sequential accesses. Dirty sectors reach the
+/// device when the filesystem syncs, so with SYNC_AFTER_WRITE the benefit is
+/// mostly for reads. Costs (BLOCK_CACHE_SECTORS+BLOCK_CACHE_READ_AHEAD)*512
+/// bytes of RAM
+/// By default it is not defined (no cache)
+//#define WITH_BLOCK_CACHE
+
+/// Number of sectors in the block cache
+const unsigned int BLOCK_CACHE_SECTORS=16;
+
+/// Max number of sectors read at once by the block cache for sequential
+/// accesses, 0 disables read-ahead
+const unsigned int BLOCK_CACHE_READ_AHEAD=4;
+
 /// Maximum number of open files. Trying to open more will fail.
 /// Cannot be lower than 3, as the first three are stdin, stdout, stderr
 const unsigned char MAX_OPEN_FILES=8;
@@ -174,6 +200,20 @@ const unsigned char MAX_OPEN_FILES=8;
 #error Deep sleep cannot work together with jtag
 #endif //defined(WITH_PROCESSES) && !defined(WITH_DEVFS)
 
+/// \def WITH_SMALL_OBJECT_HEAP
+/// Uncomment to serve C++ new/delete of objects up to 256 bytes (std::string,
+/// std::function, container nodes, ...) from a size-class heap with per-thread
+/// caches. Unlike malloc, which pauses the kernel while it operates, it only
+/// blocks threads that contend for the heap. Larger allocations, and those
+/// done while the kernel is paused or not yet started, still use malloc.
+/// By default it is not defined (new/delete use malloc)
+//#define WITH_SMALL_OBJECT_HEAP
+
+/// Size in bytes of the memory area reserved to the small object heap, which
+/// is not part of the malloc heap. When it is exhausted, small objects are
+/// allocated with malloc. MUST be a multiple of 512
+const unsigned int SMALL_OBJECT_HEAP_SIZE=8*1024;
+
 /// Minimum stack size (MUST be divisible by 4)
 const unsigned int STACK_MIN=256;
 
@@ -219,7 +259,9 @@ static_assert(MAX_PROCESS_ARGS_BLOCK_SIZE<=MIN_PROCESS_STACK_SIZE/2,"");
 /// the priority of the idle thread.
 /// The meaning of a thread's priority depends on the chosen scheduler.
 #ifdef SCHED_TYPE_PRIORITY
-//Can be modified, but a high value makes context switches more expensive
+//Can be modified. Without SCHED_PRIORITY_READY_QUEUE a high value makes context
+//switches more expensive, with it the context switch time does not depend on
+//this value, which can be at most 32
 const short int PRIORITY_MAX=4;
 #elif defined(SCHED_TYPE_CONTROL_BASED)
 //Don't touch, the limit is due to the fixed point implementation
@@ -0,0 +1,334 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "block_cache.h"
+#include "filesystem/ioctl.h"
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+
+using namespace std;
+
+#ifdef WITH_FILESYSTEM
+
+namespace miosix {
+
+//
+// class BlockCache
+//
+
+BlockCache::BlockCache(intrusive_ref_ptr<FileBase> dev, unsigned int numSectors,
+                       unsigned int readAhead)
+    : FileBase(intrusive_ref_ptr<FilesystemBase>(),O_RDWR), dev(dev),
+      staging(nullptr), nextSequential(0), pos(0), stats()
+{
+    //Slot indices are stored in a short
+    if(numSectors<2) numSectors=2;
+    if(numSectors>32767) numSectors=32767;
+    if(readAhead>numSectors/2) readAhead=numSectors/2;
+    if(readAhead<2) readAhead=0; //Reading one sector is not reading ahead
+    this->numSectors=numSectors;
+    this->readAhead=readAhead;
+    slots=new Slot[numSectors];
+    buffer=new unsigned char[numSectors*sectorSize];
+    if(readAhead) staging=new unsigned char[readAhead*sectorSize];
+    for(unsigned int i=0;i<numSectors;i++)
+    {
+        slots[i].sector=0;
+        slots[i].prev=i-1;
+        slots[i].next=i+1<numSectors ? i+1 : -1;
+        slots[i].valid=false;
+        slots[i].dirty=false;
+    }
+    mru=0;
+    lru=numSectors-1;
+}
+
+ssize_t BlockCache::write(const void *data, size_t len)
+{
+    Lock<FastMutex> l(mutex);
+    auto d=reinterpret_cast<const unsigned char*>(data);
+    size_t done=0;
+    while(done<len)
+    {
+        unsigned int sector=pos/sectorSize;
+        unsigned int offset=pos%sectorSize;
+        size_t n=min<size_t>(len-done,sectorSize-offset);
+        int i=access(sector,n<sectorSize);
+        if(i<0) return done>0 ? static_cast<ssize_t>(done) : i;
+        memcpy(slotData(i)+offset,d+done,n);
+        slots[i].dirty=true;
+        done+=n;
+        pos+=n;
+    }
+    return done;
+}
+
+ssize_t BlockCache::read(void *data, size_t len)
+{
+    Lock<FastMutex> l(mutex);
+    auto d=reinterpret_cast<unsigned char*>(data);
+    size_t done=0;
+    while(done<len)
+    {
+        unsigned int sector=pos/sectorSize;
+        unsigned int offset=pos%sectorSize;
+        size_t n=min<size_t>(len-done,sectorSize-offset);
+        int i=access(sector,true);
+        if(i<0) return done>0 ? static_cast<ssize_t>(done) : i;
+        memcpy(d+done,slotData(i)+offset,n);
+        done+=n;
+        pos+=n;
+    }
+    return done;
+}
+
+off_t BlockCache::lseek(off_t pos, int whence)
+{
+    Lock<FastMutex> l(mutex);
+    off_t newPos;
+    switch(whence)
+    {
+        case SEEK_CUR:
+            newPos=this->pos+pos;
+            break;
+        case SEEK_SET:
+            newPos=pos;
+            break;
+        case SEEK_END:
+        {
+            off_t end=dev->lseek(0,SEEK_END);
+            if(end<0) return end;
+            newPos=end+pos;
+            break;
+        }
+        default:
+            return -EINVAL;
+    }
+    if(newPos<0) return -EOVERFLOW;
+    this->pos=newPos;
+    return newPos;
+}
+
+int BlockCache::fstat(struct stat *pstat) const
+{
+    return dev->fstat(pstat);
+}
+
+int BlockCache::ioctl(int cmd, void *arg)
+{
+    Lock<FastMutex> l(mutex);
+    switch(cmd)
+    {
+        case IOCTL_SYNC:
+        {
+            int result=flush();
+            if(result<0) return result;
+            return dev->ioctl(cmd,arg);
+        }
+        case IOCTL_CACHE_STATS:
+            if(arg==nullptr) return -EFAULT;
+            memcpy(arg,&stats,sizeof(BlockCacheStats));
+            return 0;
+        default:
+            return dev->ioctl(cmd,arg);
+    }
+}
+
+BlockCache::~BlockCache()
+{
+    flush(); //Nowhere to report errors, filesystems sync before unmounting
+    delete[] staging;
+    delete[] buffer;
+    delete[] slots;
+}
+
+int BlockCache::lookup(unsigned int sector) const
+{
+    //Linear scan, the cache is small and this is cheap compared to a sector
+    //access, on an SD card or flash
+    for(unsigned int i=0;i<numSectors;i++)
+        if(slots[i].valid && slots[i].sector==sector) return i;
+    return -1;
+}
+
+int BlockCache::access(unsigned int sector, bool fill)
+{
+    int i=lookup(sector);
+    if(i>=0)
+    {
+        stats.hits++;
+        touch(i);
+        return i;
+    }
+    if(fill) return fetch(sector);
+    stats.misses++;
+    return replace(sector);
+}
+
+int BlockCache::fetch(unsigned int sector)
+{
+    stats.misses++;
+    unsigned int count=1;
+    if(readAhead && sector==nextSequential)
+    {
+        //Stop reading ahead at the first cached sector, it may be dirty
+        count=readAhead;
+        for(unsigned int k=1;k<count;k++)
+        {
+            if(lookup(sector+k)<0) continue;
+            count=k;
+            break;
+        }
+        //Reading past the end of the device fails, retry with just one sector
+        if(count>1 && devRead(sector,staging,count)<0) count=1;
+    }
+    nextSequential=sector+count;
+
+    if(count>1)
+    {
+        //Insert in reverse order, so that the sector that caused the miss is
+        //the most recently used, and the ones after it follow in LRU order
+        stats.readAhead+=count-1;
+        int i=-1;
+        for(int k=count-1;k>=0;k--)
+        {
+            i=replace(sector+k);
+            if(i<0) return i;
+            memcpy(slotData(i),staging+k*sectorSize,sectorSize);
+        }
+        return i;
+    }
+
+    int i=replace(sector);
+    if(i<0) return i;
+    int result=devRead(sector,slotData(i),1);
+    if(result<0)
+    {
+        slots[i].valid=false;
+        return result;
+    }
+    return i;
+}
+
+int BlockCache::replace(unsigned int sector)
+{
+    int i=lru;
+    if(slots[i].dirty)
+    {
+        int result=writeBack(i);
+        if(result<0) return result;
+    }
+    slots[i].sector=sector;
+    slots[i].valid=true;
+    slots[i].dirty=false;
+    touch(i);
+    return i;
+}
+
+void BlockCache::touch(int i)
+{
+    if(i==mru) return;
+    //Unlink, i is not the mru so it has a previous slot
+    slots[slots[i].prev].next=slots[i].next;
+    if(slots[i].next>=0) slots[slots[i].next].prev=slots[i].prev;
+    else lru=slots[i].prev;
+    //Link as mru
+    slots[i].prev=-1;
+    slots[i].next=mru;
+    slots[mru].prev=i;
+    mru=i;
+}
+
+int BlockCache::flush()
+{
+    //Write back in ascending sector order, which is friendlier to flash based
+    //media, merging runs of consecutive dirty sectors in a single write
+    for(;;)
+    {
+        int first=-1;
+        for(unsigned int i=0;i<numSectors;i++)
+        {
+            if(slots[i].dirty==false) continue;
+            if(first<0 || slots[i].sector<slots[first].sector) first=i;
+        }
+        if(first<0) return 0;
+
+        unsigned int sector=slots[first].sector;
+        unsigned int count=1;
+        while(count<readAhead)
+        {
+            int j=lookup(sector+count);
+            if(j<0 || slots[j].dirty==false) break;
+            count++;
+        }
+        if(count==1)
+        {
+            int result=writeBack(first);
+            if(result<0) return result;
+            continue;
+        }
+        for(unsigned int k=0;k<count;k++)
+            memcpy(staging+k*sectorSize,slotData(lookup(sector+k)),sectorSize);
+        int result=devWrite(sector,staging,count);
+        if(result<0) return result;
+        for(unsigned int k=0;k<count;k++) slots[lookup(sector+k)].dirty=false;
+        stats.writeBacks+=count;
+    }
+}
+
+int BlockCache::writeBack(int i)
+{
+    int result=devWrite(slots[i].sector,slotData(i),1);
+    if(result<0) return result;
+    slots[i].dirty=false;
+    stats.writeBacks++;
+    return 0;
+}
+
+int BlockCache::devRead(unsigned int sector, void *data, unsigned int count)
+{
+    off_t offset=static_cast<off_t>(sector)*sectorSize;
+    if(dev->lseek(offset,SEEK_SET)!=offset) return -EIO;
+    ssize_t size=count*sectorSize;
+    if(dev->read(data,size)!=size) return -EIO;
+    return 0;
+}
+
+int BlockCache::devWrite(unsigned int sector, const void *data,
+                         unsigned int count)
+{
+    off_t offset=static_cast<off_t>(sector)*sectorSize;
+    if(dev->lseek(offset,SEEK_SET)!=offset) return -EIO;
+    ssize_t size=count*sectorSize;
+    if(dev->write(data,size)!=size) return -EIO;
+    return 0;
+}
+
+} //namespace miosix
+
+#endif //WITH_FILESYSTEM
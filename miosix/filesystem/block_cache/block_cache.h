@@ -0,0 +1,218 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "filesystem/file.h"
+#include "kernel/sync.h"
+#include "config/miosix_settings.h"
+
+#ifdef WITH_FILESYSTEM
+
+namespace miosix {
+
+/**
+ * Statistics returned by ioctl(IOCTL_CACHE_STATS) on a BlockCache
+ */
+struct BlockCacheStats
+{
+    unsigned int hits;       ///< Sector accesses served from the cache
+    unsigned int misses;     ///< Sector accesses not found in the cache
+    unsigned int readAhead;  ///< Sectors read from the device in advance
+    unsigned int writeBacks; ///< Dirty sectors written back to the device
+};
+
+/**
+ * BlockCache
+ * A write-back sector cache that wraps a block device file, such as the one
+ * DevFs returns when opening a block device, and can be passed to filesystems
+ * in its place. Sectors are kept in an LRU list, writes only mark the cached
+ * sector as dirty, and dirty sectors are written back when evicted, on
+ * ioctl(IOCTL_SYNC) and when the cache is destroyed. A miss on the sector
+ * following the previous miss triggers a read-ahead of multiple sectors with
+ * a single device read.
+ * All ioctl commands except IOCTL_SYNC and IOCTL_CACHE_STATS are forwarded to
+ * the underlying device.
+ */
+class BlockCache : public FileBase
+{
+public:
+    /// Size of a cached sector, the same one used by all filesystems
+    static const unsigned int sectorSize=512;
+
+    /**
+     * Constructor
+     * \param dev block device to cache
+     * \param numSectors number of sectors in the cache, at least 2
+     * \param readAhead max number of sectors read at once for sequential
+     * accesses, 0 disables read-ahead. Limited to numSectors/2
+     */
+    BlockCache(intrusive_ref_ptr<FileBase> dev, unsigned int numSectors,
+               unsigned int readAhead);
+
+    /**
+     * Write data to the file, if the file supports writing.
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \return the number of written characters, or a negative number in case
+     * of errors
+     */
+    virtual ssize_t write(const void *data, size_t len) override;
+
+    /**
+     * Read data from the file, if the file supports reading.
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \return the number of read characters, or a negative number in case
+     * of errors
+     */
+    virtual ssize_t read(void *data, size_t len) override;
+
+    /**
+     * Move file pointer, if the file supports random-access.
+     * \param pos offset to sum to the beginning of the file, current position
+     * or end of file, depending on whence
+     * \param whence SEEK_SET, SEEK_CUR or SEEK_END
+     * \return the offset from the beginning of the file if the operation
+     * completed, or a negative number in case of errors
+     */
+    virtual off_t lseek(off_t pos, int whence) override;
+
+    /**
+     * Return file information, forwarded to the underlying device.
+     * \param pstat pointer to stat struct
+     * \return 0 on success, or a negative number on failure
+     */
+    virtual int fstat(struct stat *pstat) const override;
+
+    /**
+     * Perform various operations on a file descriptor
+     * \param cmd specifies the operation to perform
+     * \param arg optional argument that some operation require
+     * \return the exact return value depends on CMD, -1 is returned on error
+     */
+    virtual int ioctl(int cmd, void *arg) override;
+
+    /**
+     * Destructor, writes back dirty sectors
+     */
+    ~BlockCache();
+
+private:
+    /**
+     * A cache slot, slots are kept in a doubly linked LRU list by index
+     */
+    struct Slot
+    {
+        unsigned int sector; ///< Sector cached in this slot
+        short prev;          ///< Previous slot in LRU order, -1 if none
+        short next;          ///< Next slot in LRU order, -1 if none
+        bool valid;          ///< True if the slot contains a sector
+        bool dirty;          ///< True if the sector needs to be written back
+    };
+
+    /**
+     * \param sector sector to look for
+     * \return the index of the slot caching the sector, or -1
+     */
+    int lookup(unsigned int sector) const;
+
+    /**
+     * Get the slot for a sector, reading it from the device if needed
+     * \param sector sector to access
+     * \param fill if false the caller will overwrite the whole sector, so
+     * there is no need to read it from the device on a miss
+     * \return the slot index, or a negative error code
+     */
+    int access(unsigned int sector, bool fill);
+
+    /**
+     * Fill the cache on a miss, performing read-ahead if the access pattern
+     * is sequential
+     * \param sector sector that caused the miss
+     * \return the slot index containing sector, or a negative error code
+     */
+    int fetch(unsigned int sector);
+
+    /**
+     * Free the least recently used slot, writing it back if dirty
+     * \param sector sector that will be stored in the slot
+     * \return the slot index, or a negative error code
+     */
+    int replace(unsigned int sector);
+
+    /**
+     * Move a slot to the most recently used position
+     */
+    void touch(int i);
+
+    /**
+     * Write back all dirty sectors, in ascending sector order
+     * \return 0 on success, or a negative error code
+     */
+    int flush();
+
+    /**
+     * Write back a dirty sector
+     * \return 0 on success, or a negative error code
+     */
+    int writeBack(int i);
+
+    /**
+     * \return a pointer to the data of slot i
+     */
+    unsigned char *slotData(int i) { return buffer+i*sectorSize; }
+
+    /**
+     * Read consecutive sectors from the device
+     * \return 0 on success, or a negative error code
+     */
+    int devRead(unsigned int sector, void *data, unsigned int count);
+
+    /**
+     * Write consecutive sectors to the device
+     * \return 0 on success, or a negative error code
+     */
+    int devWrite(unsigned int sector, const void *data, unsigned int count);
+
+    intrusive_ref_ptr<FileBase> dev; ///< Cached block device
+    mutable FastMutex mutex;         ///< Protects the cache state
+    Slot *slots;                     ///< Cache slots
+    unsigned char *buffer;           ///< Sector data, one sector per slot
+    unsigned char *staging;          ///< Buffer for read-ahead and flush
+    unsigned int numSectors;         ///< Number of slots
+    unsigned int readAhead;          ///< Max sectors read in advance
+    short mru;                       ///< Most recently used slot
+    short lru;                       ///< Least recently used slot
+    unsigned int nextSequential;     ///< Sector after the last miss
+    off_t pos;                       ///< Current file position
+    BlockCacheStats stats;           ///< Hit/miss counters
+};
+
+} //namespace miosix
+
+#endif //WITH_FILESYSTEM
@@ -107,6 +107,8 @@ int TerminalDevice::fstat(struct stat *pstat) const
 
 int TerminalDevice::isatty() const { return device->isatty(); }
 
+int TerminalDevice::poll(int events) { return device->poll(events); }
+
 #endif //WITH_FILESYSTEM
 
 int TerminalDevice::ioctl(int cmd, void *arg)
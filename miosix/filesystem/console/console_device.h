@@ -90,6 +90,16 @@ public:
      * case of errors
      */
     virtual int isatty() const;
+
+    /**
+     * Check whether the file is ready for I/O, used to implement poll().
+     * Note that in canonical mode POLLIN is reported as soon as the underlying
+     * device has data, so a subsequent read may still block till the end of
+     * the line.
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready
+     */
+    virtual int poll(int events);
     
     #endif //WITH_FILESYSTEM
     
@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include "filesystem/stringpart.h"
+#include "filesystem/poll.h"
 
 using namespace std;
 
@@ -116,6 +117,13 @@ public:
      */
     virtual int ioctl(int cmd, void *arg);
 
+    /**
+     * Check whether the file is ready for I/O, used to implement poll().
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready
+     */
+    virtual int poll(int events);
+
 private:
     intrusive_ref_ptr<Device> dev; ///< Device file
     off_t seekPoint;               ///< Seek point (note that off_t is 64bit)
@@ -177,6 +185,13 @@ int DevFsFile::ioctl(int cmd, void *arg)
     return dev->ioctl(cmd,arg);
 }
 
+int DevFsFile::poll(int events)
+{
+    if((flags & _FREAD)==0) events&=~(POLLIN | POLLRDNORM);
+    if((flags & _FWRITE)==0) events&=~(POLLOUT | POLLWRNORM);
+    return dev->poll(events);
+}
+
 //
 // class Device
 //
@@ -202,6 +217,11 @@ int Device::isatty() const
     return tty ? 1 : 0;
 }
 
+int Device::poll(int events)
+{
+    return events & (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM);
+}
+
 #endif //WITH_FILESYSTEM || WITH_DEVFS
 
 ssize_t Device::readBlock(void *buffer, size_t size, off_t where)
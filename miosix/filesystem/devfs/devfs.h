@@ -98,6 +98,17 @@ public:
      */
     virtual int isatty() const;
 
+    /**
+     * Check whether the device is ready for I/O, used to implement poll().
+     * Stream devices whose readBlock() or writeBlock() can block should
+     * reimplement this member function, and call one of the
+     * FileBase::notifyReadiness() member functions when readiness changes.
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready. The default
+     * implementation reports the device as always ready
+     */
+    virtual int poll(int events);
+
     #endif //WITH_FILESYSTEM || WITH_DEVFS
     
     #ifdef WITH_DEVFS
@@ -30,6 +30,8 @@
 #include <string>
 #include <fcntl.h>
 #include "file_access.h"
+#include "poll.h"
+#include "kernel/kernel.h"
 #include "config/miosix_settings.h"
 
 using namespace std;
@@ -87,6 +89,72 @@ MemoryMappedFile FileBase::getFileFromMemory()
     return MemoryMappedFile(nullptr,0); //Not supported
 }
 
+int FileBase::poll(int events)
+{
+    return events & (POLLIN | POLLRDNORM | POLLOUT | POLLWRNORM);
+}
+
+ssize_t FileBase::spliceTo(FileBase *out, size_t len)
+{
+    return -EINVAL;
+}
+
+ssize_t FileBase::spliceFrom(FileBase *in, size_t len)
+{
+    return -EINVAL;
+}
+
+void FileBase::IRQnotifyReadiness(bool& hppw)
+{
+    readinessSequence++;
+    //Wake all pollers, they will check their files again. This thundering
+    //herd is acceptable as only few threads are expected to wait in poll()
+    while(!pollWaiters.empty())
+    {
+        PollWaitToken *token=pollWaiters.front();
+        pollWaiters.pop_front();
+        Thread *t=token->thread;
+        token->thread=nullptr;
+        t->IRQwakeup();
+        if(t->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+            hppw=true;
+    }
+}
+
+void FileBase::IRQnotifyReadiness()
+{
+    bool hppw=false;
+    IRQnotifyReadiness(hppw);
+    if(hppw) Scheduler::IRQfindNextThread();
+}
+
+void FileBase::notifyReadiness()
+{
+    bool hppw=false;
+    {
+        FastInterruptDisableLock dLock;
+        IRQnotifyReadiness(hppw);
+    }
+    if(hppw) Thread::yield();
+}
+
+bool FileBase::waitReadiness(unsigned int seq, long long deadline)
+{
+    PollWaitToken token(Thread::getCurrentThread());
+    FastInterruptDisableLock dLock;
+    //A notification happened while the caller was checking its files
+    if(readinessSequence!=seq) return true;
+    pollWaiters.push_back(&token);
+    auto result=TimedWaitResult::NoTimeout;
+    if(deadline<0) Thread::IRQenableIrqAndWait(dLock);
+    else result=Thread::IRQenableIrqAndTimedWait(dLock,deadline);
+    if(token.thread) pollWaiters.removeFast(&token); //Timeout or spurious wakeup
+    return result==TimedWaitResult::NoTimeout;
+}
+
+volatile unsigned int FileBase::readinessSequence=0;
+IntrusiveList<FileBase::PollWaitToken> FileBase::pollWaiters;
+
 //
 // class DirectoryBase
 //
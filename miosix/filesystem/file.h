@@ -38,6 +38,7 @@ namespace miosix {
 // Forward decls
 class FilesystemBase;
 class StringPart;
+class Thread;
 
 /**
  * Return value of FileBase::getFileFromMemory()
@@ -177,16 +178,112 @@ public:
      */
     virtual MemoryMappedFile getFileFromMemory();
 
+    /**
+     * Check whether the file is ready for I/O, used to implement poll().
+     * Files whose readiness can change asynchronously must call one of the
+     * notifyReadiness() member functions whenever that happens, as this is
+     * what wakes up threads blocked in poll().
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready. POLLERR and
+     * POLLHUP shall be returned even if not requested. The default
+     * implementation reports the file as always ready for reading and writing,
+     * which is correct for regular files
+     */
+    virtual int poll(int events);
+
+    /**
+     * Move data from this file to another one without an intermediate buffer,
+     * used to implement splice(). Only files that own a buffer, such as pipes,
+     * can implement this.
+     * \param out file where data is written
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, or a negative number on failure.
+     * The default implementation returns -EINVAL
+     */
+    virtual ssize_t spliceTo(FileBase *out, size_t len);
+
+    /**
+     * Move data from another file to this one without an intermediate buffer,
+     * used to implement splice(). Only files that own a buffer, such as pipes,
+     * can implement this.
+     * \param in file where data is read
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, or a negative number on failure.
+     * The default implementation returns -EINVAL
+     */
+    virtual ssize_t spliceFrom(FileBase *in, size_t len);
+
+    /**
+     * Wake up all threads blocked in poll() so that they check again the
+     * readiness of their files. Only for use in IRQ handlers.
+     * \param hppw is set to true if a scheduler update is necessary to
+     * wake up a formerly sleeping thread with Scheduler::IRQfindNextThread().
+     * Otherwise it is not modified.
+     */
+    static void IRQnotifyReadiness(bool& hppw);
+
+    /**
+     * Wake up all threads blocked in poll() so that they check again the
+     * readiness of their files. Only for use in IRQ handlers.
+     */
+    static void IRQnotifyReadiness();
+
+    /**
+     * Wake up all threads blocked in poll() so that they check again the
+     * readiness of their files.
+     */
+    static void notifyReadiness();
+
+    /**
+     * \internal
+     * \return the current readiness sequence number, to be passed to
+     * waitReadiness() after having checked the readiness of a set of files
+     */
+    static unsigned int getReadinessSequence() { return readinessSequence; }
+
+    /**
+     * \internal
+     * Block the current thread until one of the notifyReadiness() member
+     * functions is called. Does not block if a notification happened after
+     * seq was obtained, so notifications can't be lost.
+     * \param seq value returned by getReadinessSequence()
+     * \param deadline absolute time in nanoseconds, or a negative value for
+     * no timeout
+     * \return false if the wait timed out
+     */
+    static bool waitReadiness(unsigned int seq, long long deadline);
+
     /**
      * \return a pointer to the parent filesystem
      */
     const intrusive_ref_ptr<FilesystemBase> getParent() const { return parent; }
-    
+
 private:
+    /**
+     * \internal Element of the list of threads waiting in poll()
+     */
+    class PollWaitToken : public IntrusiveListItem
+    {
+    public:
+        PollWaitToken(Thread *thread) : thread(thread) {}
+        Thread *thread; ///<\internal Waiting thread and spurious wakeup token
+    };
+
     intrusive_ref_ptr<FilesystemBase> parent; ///< Files may have a parent fs
 
+    static volatile unsigned int readinessSequence; ///< Notification counter
+    static IntrusiveList<PollWaitToken> pollWaiters; ///< Threads in poll()
+
 protected:
     int flags; ///< File open flags (O_RDONLY, O_WRONLY, ...)
+
+    #else //WITH_FILESYSTEM
+
+    //Without filesystem there is no poll(), so notifications are ignored
+    static void IRQnotifyReadiness(bool& hppw) {}
+    static void IRQnotifyReadiness() {}
+    static void notifyReadiness() {}
+
     #endif //WITH_FILESYSTEM
 };
 
@@ -35,7 +35,9 @@
 #include "fat32/fat32.h"
 #include "littlefs/lfs_miosix.h"
 #include "pipe/pipe.h"
+#include "block_cache/block_cache.h"
 #include "kernel/logging.h"
+#include "kernel/kernel.h"
 #ifdef WITH_PROCESSES
 #include "kernel/process.h"
 #endif //WITH_PROCESSES
@@ -292,14 +294,56 @@ int FileDescriptorTable::pipe(int fds[2])
         }
     }
     if(availableFds<2) return -EMFILE;
-    intrusive_ref_ptr<FileBase> pipe(new Pipe);
-    files[fds[0]]=pipe;
-    files[fds[1]]=pipe;
+    intrusive_ref_ptr<FileBase> readEnd, writeEnd;
+    Pipe::create(readEnd,writeEnd);
+    files[fds[0]]=readEnd;
+    files[fds[1]]=writeEnd;
     filesCloexec[fds[0]]=false;
     filesCloexec[fds[1]]=false;
     return 0;
 }
 
+int FileDescriptorTable::poll(struct pollfd *fds, unsigned int nfds,
+        long long timeout)
+{
+    if(nfds>MAX_OPEN_FILES) return -EINVAL;
+    if(fds==nullptr && nfds>0) return -EFAULT;
+    long long deadline=timeout<0 ? -1 : getTime()+timeout;
+    for(;;)
+    {
+        //Get the sequence number before checking files, so that readiness
+        //changes that occur while checking make waitReadiness() return early
+        unsigned int seq=FileBase::getReadinessSequence();
+        int ready=0;
+        for(unsigned int i=0;i<nfds;i++)
+        {
+            fds[i].revents=0;
+            if(fds[i].fd<0) continue;
+            intrusive_ref_ptr<FileBase> file=getFile(fds[i].fd);
+            if(!file) fds[i].revents=POLLNVAL;
+            else fds[i].revents=file->poll(fds[i].events);
+            if(fds[i].revents) ready++;
+        }
+        if(ready>0 || timeout==0) return ready;
+        //On timeout check the files one last time, then return
+        if(FileBase::waitReadiness(seq,deadline)==false) timeout=0;
+    }
+}
+
+ssize_t FileDescriptorTable::splice(int fdIn, int fdOut, size_t len)
+{
+    //Important, since len is specified by standard to be unsigned, but the
+    //return value has to be signed
+    if(static_cast<ssize_t>(len)<0) return -EINVAL;
+    intrusive_ref_ptr<FileBase> in=getFile(fdIn);
+    intrusive_ref_ptr<FileBase> out=getFile(fdOut);
+    if(!in || !out) return -EBADF;
+    //Either the source or the destination must be a pipe, try both
+    ssize_t result=in->spliceTo(out.get(),len);
+    if(result!=-EINVAL) return result;
+    return out->spliceFrom(in.get(),len);
+}
+
 int FileDescriptorTable::statImpl(const char* name, struct stat* pstat, bool f)
 {
     if(name==0 || name[0]=='\0' || pstat==0) return -EFAULT;
@@ -815,6 +859,10 @@ static inline bool tryMount(const char *name, intrusive_ref_ptr<Device> dev,
         return false;
     }
 
+    #ifdef WITH_BLOCK_CACHE
+    disk=intrusive_ref_ptr<FileBase>(new BlockCache(disk,BLOCK_CACHE_SECTORS,
+                                                    BLOCK_CACHE_READ_AHEAD));
+    #endif //WITH_BLOCK_CACHE
     intrusive_ref_ptr<T> fsImpl(new T(disk));
     if(fsImpl->mountFailed()) { bootlog("Failed\n"); return false; }
     StringPart sd("sd");
@@ -34,6 +34,7 @@
 #include <errno.h>
 #include <sys/stat.h>
 #include "file.h"
+#include "poll.h"
 #include "stringpart.h"
 #include "devfs/devfs.h"
 #include "kernel/sync.h"
@@ -344,6 +345,28 @@ public:
      * \return 0 on success, or a negative number on failure
      */
     int pipe(int fds[2]);
+
+    /**
+     * Wait for one of a set of file descriptors to become ready for I/O
+     * \param fds array of file descriptors to wait for
+     * \param nfds number of elements in fds
+     * \param timeout relative timeout in nanoseconds, a negative value means
+     * no timeout
+     * \return the number of file descriptors with nonzero revents, 0 on
+     * timeout, or a negative number on failure
+     */
+    int poll(struct pollfd *fds, unsigned int nfds, long long timeout);
+
+    /**
+     * Move data between two files without an intermediate user buffer.
+     * At least one of the two files must be a pipe
+     * \param fdIn file descriptor to read from
+     * \param fdOut file descriptor to write to
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, 0 on end of file, or a negative
+     * number on failure
+     */
+    ssize_t splice(int fdIn, int fdOut, size_t len);
     
     /**
      * Retrieves an entry in the file descriptor table
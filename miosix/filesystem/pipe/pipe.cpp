@@ -26,7 +26,9 @@
  ***************************************************************************/
 
 #include "pipe.h"
+#include "filesystem/poll.h"
 #include <algorithm>
+#include <cstring>
 
 using namespace std;
 
@@ -34,24 +36,48 @@ using namespace std;
 
 namespace miosix {
 
-Pipe::Pipe() : FileBase(intrusive_ref_ptr<FilesystemBase>(),O_RDWR), put(0),
-    get(0), size(0), capacity(defaultSize), buffer(new char[defaultSize]) {}
+//
+// class Pipe
+//
+
+void Pipe::create(intrusive_ref_ptr<FileBase>& readEnd,
+                  intrusive_ref_ptr<FileBase>& writeEnd)
+{
+    intrusive_ref_ptr<Pipe> pipe(new Pipe);
+    auto r=new PipeEnd(pipe,false);
+    readEnd=intrusive_ref_ptr<FileBase>(r);
+    pipe->readEnd=r;
+    auto w=new PipeEnd(pipe,true);
+    writeEnd=intrusive_ref_ptr<FileBase>(w);
+    pipe->writeEnd=w;
+}
 
 ssize_t Pipe::write(const void *data, size_t len)
 {
     auto d=reinterpret_cast<const char*>(data);
-    Lock<FastMutex> l(m);
     ssize_t written=0;
-    while(len>0)
+    bool notify=false;
     {
-        if(unconnected()) return -EPIPE;
-        int writable=min<int>(len,capacity-size);
-        if(writable==0) cv.wait(l);
-        else {
-            for(int i=0;i<writable;i++)
+        Lock<FastMutex> l(m);
+        while(len>0)
+        {
+            if(readEnd==nullptr)
+            {
+                if(written==0) written=-EPIPE;
+                break;
+            }
+            int writable=writeBusy ? 0 : min<size_t>(len,capacity-size);
+            if(writable==0)
+            {
+                cv.wait(l);
+                continue;
+            }
+            copyIn(d,writable);
+            //Readers only wait if the pipe is empty
+            if(size==0)
             {
-                buffer[put]=d[i];
-                if(++put>=capacity) put=0;
+                cv.broadcast();
+                notify=true;
             }
             size+=writable;
             d+=writable;
@@ -59,62 +85,275 @@ ssize_t Pipe::write(const void *data, size_t len)
             written+=writable;
         }
     }
+    if(notify) FileBase::notifyReadiness();
     return written;
 }
 
 ssize_t Pipe::read(void *data, size_t len)
 {
     if(len==0) return 0;
-    auto d=reinterpret_cast<char*>(data);
-    Lock<FastMutex> l(m);
-    for(;;)
+    int readable;
+    bool notify=false;
     {
-        if(unconnected()) return 0;
-        int readable=min<int>(len,size);
-        //HACK: if the other end of the pipe is closed after we wait on the
-        //condition variable, we'll wait forever. To fix that, we set a timeout
-        if(readable==0) cv.timedWait(l,getTime()+pollTime);
-        else {
-            for(int i=0;i<readable;i++)
+        Lock<FastMutex> l(m);
+        for(;;)
+        {
+            if(readBusy==false)
             {
-                d[i]=buffer[get];
-                if(++get>=capacity) get=0;
+                if(size>0) break;
+                if(writeEnd==nullptr) return 0; //End of file
             }
-            size-=readable;
-            return readable;
+            cv.wait(l);
+        }
+        readable=min<size_t>(len,size);
+        copyOut(reinterpret_cast<char*>(data),readable);
+        //Writers only wait if the pipe is full
+        if(size==capacity)
+        {
+            cv.broadcast();
+            notify=true;
         }
+        size-=readable;
     }
+    if(notify) FileBase::notifyReadiness();
+    return readable;
 }
 
-off_t Pipe::lseek(off_t pos, int whence) { return -ESPIPE; }
+ssize_t Pipe::spliceTo(FileBase *out, size_t len)
+{
+    if(len==0) return 0;
+    ssize_t moved=0;
+    bool notify=false;
+    {
+        Lock<FastMutex> l(m);
+        //Writing to the same pipe would deadlock if the pipe is full
+        if(out==writeEnd) return -EINVAL;
+        for(;;)
+        {
+            if(readBusy==false)
+            {
+                if(size>0) break;
+                if(writeEnd==nullptr) return 0; //End of file
+            }
+            cv.wait(l);
+        }
+        //Writers only touch the free part of the buffer, and readBusy keeps
+        //away other readers, so the data can be accessed with the mutex
+        //unlocked, which is important as out->write() may take a long time
+        readBusy=true;
+        while(len>0 && size>0)
+        {
+            int n=min<size_t>(min(len,static_cast<size_t>(size)),capacity-get);
+            const char *p=buffer+get;
+            ssize_t result;
+            {
+                Unlock<FastMutex> u(l);
+                result=out->write(p,n);
+            }
+            if(result<=0)
+            {
+                if(moved==0) moved=result;
+                break;
+            }
+            get+=result;
+            if(get>=capacity) get-=capacity;
+            if(size==capacity) notify=true;
+            size-=result;
+            len-=result;
+            moved+=result;
+            if(result<n) break;
+        }
+        readBusy=false;
+        cv.broadcast();
+    }
+    if(notify) FileBase::notifyReadiness();
+    return moved;
+}
 
-int Pipe::fstat(struct stat *pstat) const
+ssize_t Pipe::spliceFrom(FileBase *in, size_t len)
 {
-    return -EFAULT; //TODO
+    if(len==0) return 0;
+    ssize_t result;
+    bool notify=false;
+    {
+        Lock<FastMutex> l(m);
+        //Reading from the same pipe would deadlock if the pipe is empty
+        if(in==readEnd) return -EINVAL;
+        for(;;)
+        {
+            if(readEnd==nullptr) return -EPIPE;
+            if(writeBusy==false && size<capacity) break;
+            cv.wait(l);
+        }
+        //Readers only touch the used part of the buffer, and writeBusy keeps
+        //away other writers. Only one read is done, as it may block
+        writeBusy=true;
+        int n=min<size_t>(min(len,static_cast<size_t>(capacity-size)),
+                          capacity-put);
+        char *p=buffer+put;
+        {
+            Unlock<FastMutex> u(l);
+            result=in->read(p,n);
+        }
+        writeBusy=false;
+        if(result>0)
+        {
+            put+=result;
+            if(put>=capacity) put-=capacity;
+            if(size==0) notify=true;
+            size+=result;
+        }
+        cv.broadcast();
+    }
+    if(notify) FileBase::notifyReadiness();
+    return result;
 }
 
-int Pipe::fcntl(int cmd, int opt)
+int Pipe::poll(int events, bool writeEnd)
 {
-    return -EFAULT; //TODO
+    Lock<FastMutex> l(m);
+    if(writeEnd)
+    {
+        if(readEnd==nullptr) return POLLERR;
+        return size<capacity ? events & (POLLOUT | POLLWRNORM) : 0;
+    } else {
+        int result=size>0 ? events & (POLLIN | POLLRDNORM) : 0;
+        if(this->writeEnd==nullptr) result|=POLLHUP;
+        return result;
+    }
+}
+
+int Pipe::setCapacity(int newCapacity)
+{
+    if(newCapacity>maxSize) return -EPERM;
+    if(newCapacity<minSize) newCapacity=minSize;
+    char *newBuffer=new char[newCapacity];
+    bool notify=false;
+    {
+        Lock<FastMutex> l(m);
+        while(readBusy || writeBusy) cv.wait(l);
+        if(size>newCapacity)
+        {
+            delete[] newBuffer;
+            return -EBUSY;
+        }
+        copyOut(newBuffer,size);
+        swap(buffer,newBuffer);
+        //If the pipe was full, writers can now proceed
+        if(size==capacity && newCapacity>capacity)
+        {
+            cv.broadcast();
+            notify=true;
+        }
+        capacity=newCapacity;
+        get=0;
+        put=size<capacity ? size : 0;
+    }
+    delete[] newBuffer;
+    if(notify) FileBase::notifyReadiness();
+    return newCapacity;
+}
+
+int Pipe::getCapacity()
+{
+    Lock<FastMutex> l(m);
+    return capacity;
+}
+
+void Pipe::close(bool writeEnd)
+{
+    {
+        Lock<FastMutex> l(m);
+        if(writeEnd) this->writeEnd=nullptr; else readEnd=nullptr;
+        cv.broadcast();
+    }
+    FileBase::notifyReadiness();
 }
 
 Pipe::~Pipe() { delete[] buffer; }
 
-bool Pipe::unconnected()
+Pipe::Pipe() : put(0), get(0), size(0), capacity(defaultSize),
+    buffer(new char[defaultSize]), readEnd(nullptr), writeEnd(nullptr),
+    readBusy(false), writeBusy(false) {}
+
+void Pipe::copyIn(const char *data, int len)
+{
+    int first=min(len,capacity-put);
+    memcpy(buffer+put,data,first);
+    memcpy(buffer,data+first,len-first);
+    put+=len;
+    if(put>=capacity) put-=capacity;
+}
+
+void Pipe::copyOut(char *data, int len)
+{
+    int first=min(len,capacity-get);
+    memcpy(data,buffer+get,first);
+    memcpy(data+first,buffer,len-first);
+    get+=len;
+    if(get>=capacity) get-=capacity;
+}
+
+//
+// class PipeEnd
+//
+
+PipeEnd::PipeEnd(intrusive_ref_ptr<Pipe> pipe, bool writeEnd)
+    : FileBase(intrusive_ref_ptr<FilesystemBase>(),writeEnd ? O_WRONLY : O_RDONLY),
+      pipe(pipe), writeEnd(writeEnd) {}
+
+ssize_t PipeEnd::write(const void *data, size_t len)
+{
+    if(writeEnd==false) return -EBADF;
+    return pipe->write(data,len);
+}
+
+ssize_t PipeEnd::read(void *data, size_t len)
+{
+    if(writeEnd) return -EBADF;
+    return pipe->read(data,len);
+}
+
+off_t PipeEnd::lseek(off_t pos, int whence) { return -ESPIPE; }
+
+int PipeEnd::fstat(struct stat *pstat) const
 {
-    //How many references does an unconnected pipe have? One in the file
-    //descriptor table. Then, since we check whether we are unconnected within
-    //either a read or write operation, either FileDescriptorTable::read or
-    //FileDescriptorTable::write hold a temporary reference to make sure a
-    //concurrent close doesn't lead to a dangling pointer in the middle of a
-    //syscall, bringing the reference count to 2. Finally, to get the reference
-    //count, we need to get the intrusive_shared_ptr first as a temporary through
-    //shared_from_this() and this adds to the reference count, reaching 3.
-    //This should be done with the mutex locked to prevent concurrent calls from
-    //not spotting that we are unconnected
-    return shared_from_this().use_count()<=3;
+    memset(pstat,0,sizeof(struct stat));
+    pstat->st_mode=S_IFIFO | 0600; //prw-------
+    pstat->st_nlink=1;
+    pstat->st_blksize=pipe->getCapacity();
+    return 0;
 }
 
+int PipeEnd::fcntl(int cmd, int opt)
+{
+    switch(cmd)
+    {
+        case F_SETPIPE_SZ:
+            return pipe->setCapacity(opt);
+        case F_GETPIPE_SZ:
+            return pipe->getCapacity();
+        default:
+            return FileBase::fcntl(cmd,opt);
+    }
+}
+
+int PipeEnd::poll(int events) { return pipe->poll(events,writeEnd); }
+
+ssize_t PipeEnd::spliceTo(FileBase *out, size_t len)
+{
+    if(writeEnd) return -EBADF;
+    return pipe->spliceTo(out,len);
+}
+
+ssize_t PipeEnd::spliceFrom(FileBase *in, size_t len)
+{
+    if(writeEnd==false) return -EBADF;
+    return pipe->spliceFrom(in,len);
+}
+
+PipeEnd::~PipeEnd() { pipe->close(writeEnd); }
+
 } //namespace miosix
 
 #endif //WITH_FILESYSTEM
@@ -27,32 +27,179 @@
 
 #pragma once
 
+#include <fcntl.h>
 #include "filesystem/file.h"
 #include "kernel/sync.h"
 #include "config/miosix_settings.h"
 
+// Same values as Linux, not provided by newlib
+#ifndef F_SETPIPE_SZ
+#define F_SETPIPE_SZ 1031 ///< fcntl() command to set the pipe capacity
+#define F_GETPIPE_SZ 1032 ///< fcntl() command to get the pipe capacity
+#endif //F_SETPIPE_SZ
+
+/**
+ * Move data between a pipe and another file descriptor without copying it to
+ * an intermediate user buffer. At least one of fdIn and fdOut must be a pipe.
+ * \param fdIn file descriptor to read from
+ * \param offIn must be nullptr, offsets are not supported
+ * \param fdOut file descriptor to write to
+ * \param offOut must be nullptr, offsets are not supported
+ * \param len max number of bytes to move
+ * \param flags ignored
+ * \return the number of bytes moved, 0 on end of file, or -1 on failure,
+ * setting errno
+ */
+extern "C" ssize_t splice(int fdIn, off_t *offIn, int fdOut, off_t *offOut,
+                          size_t len, unsigned int flags);
+
 #ifdef WITH_FILESYSTEM
 
 namespace miosix {
 
+class PipeEnd;
+
 /**
  * Pipe
- * This is an almost standard compliant pipe implementation. A pipe should in
- * theory have two separate file descriptors pointing to two file objects, one
- * for the read end and one for the write end. This pipe implementation is a
- * single file object that does both. This file object is aliased through
- * reference counting to both file descriptors, which can be used
- * interchangeably as read/write end. Code that uses those file descriptor in a
- * standard compliant way won't notice the difference.
+ * This class is the buffer shared by the two ends of a pipe. Each end is a
+ * separate file object (PipeEnd), so that when all file descriptors referring
+ * to the write end are closed readers see end of file, and when all those
+ * referring to the read end are closed writers get EPIPE.
+ * Data is moved in and out of the circular buffer with at most two memcpy per
+ * operation, and splice operations access the buffer directly.
  */
-class Pipe : public FileBase
+class Pipe : public IntrusiveRefCounted<Pipe>
 {
 public:
+    /**
+     * Create a new pipe
+     * \param readEnd the read end of the pipe will be stored here
+     * \param writeEnd the write end of the pipe will be stored here
+     */
+    static void create(intrusive_ref_ptr<FileBase>& readEnd,
+                       intrusive_ref_ptr<FileBase>& writeEnd);
+
+    /**
+     * Write data to the pipe, blocking until all data has been written
+     * \param data the data to write
+     * \param len the number of bytes to write
+     * \return the number of written characters, or a negative number in case
+     * of errors
+     */
+    ssize_t write(const void *data, size_t len);
+
+    /**
+     * Read data from the pipe, blocking until some data is available
+     * \param data buffer to store read data
+     * \param len the number of bytes to read
+     * \return the number of read characters, 0 if the write end was closed and
+     * no more data is available, or a negative number in case of errors
+     */
+    ssize_t read(void *data, size_t len);
+
+    /**
+     * Move data from the pipe to another file, passing to its write() member
+     * function a pointer into the pipe buffer. Blocks until some data is
+     * available in the pipe.
+     * \param out file where data is written
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, 0 if the write end was closed and no
+     * more data is available, or a negative number in case of errors
+     */
+    ssize_t spliceTo(FileBase *out, size_t len);
+
+    /**
+     * Move data from another file to the pipe, passing to its read() member
+     * function a pointer into the pipe buffer. Blocks until there is space
+     * in the pipe.
+     * \param in file where data is read
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, or a negative number in case of errors
+     */
+    ssize_t spliceFrom(FileBase *in, size_t len);
+
+    /**
+     * Check whether one end of the pipe is ready for I/O
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \param writeEnd true if the caller is the write end
+     * \return the requested events that are currently ready
+     */
+    int poll(int events, bool writeEnd);
+
+    /**
+     * Change the pipe capacity
+     * \param newCapacity new capacity in bytes, rounded up to minSize
+     * \return the new capacity, or a negative number in case of errors
+     */
+    int setCapacity(int newCapacity);
+
+    /**
+     * \return the pipe capacity in bytes
+     */
+    int getCapacity();
+
+    /**
+     * Called when one of the two ends of the pipe is closed, wakes up threads
+     * blocked on the other end
+     * \param writeEnd true if the write end was closed
+     */
+    void close(bool writeEnd);
+
+    /**
+     * Destructor
+     */
+    ~Pipe();
+
+    static const int defaultSize=256;  ///< Capacity of a newly created pipe
+    static const int minSize=16;       ///< Min capacity for F_SETPIPE_SZ
+    static const int maxSize=64*1024;  ///< Max capacity for F_SETPIPE_SZ
+
+private:
     /**
      * Constructor
      */
     Pipe();
 
+    /**
+     * Copy data into the circular buffer. Must be called with the mutex locked
+     * and enough free space in the buffer. Does not update size.
+     * \param data data to copy
+     * \param len number of bytes to copy
+     */
+    void copyIn(const char *data, int len);
+
+    /**
+     * Copy data out of the circular buffer. Must be called with the mutex
+     * locked and with at least len bytes in the buffer. Does not update size.
+     * \param data data is copied here
+     * \param len number of bytes to copy
+     */
+    void copyOut(char *data, int len);
+
+    FastMutex m;
+    ConditionVariable cv;
+    int put, get, size, capacity;
+    char *buffer;
+    PipeEnd *readEnd;  ///< Read end, or nullptr if closed
+    PipeEnd *writeEnd; ///< Write end, or nullptr if closed
+    /// True while a splice is accessing the buffer with the mutex unlocked.
+    /// Other readers (writers) and capacity changes have to wait.
+    bool readBusy, writeBusy;
+};
+
+/**
+ * One of the two ends of a pipe
+ */
+class PipeEnd : public FileBase
+{
+public:
+    /**
+     * Constructor
+     * \param pipe the pipe to which this file refers
+     * \param writeEnd true if this is the write end of the pipe
+     */
+    PipeEnd(intrusive_ref_ptr<Pipe> pipe, bool writeEnd);
+
     /**
      * Write data to the file, if the file supports writing.
      * \param data the data to write
@@ -89,7 +236,8 @@ public:
     virtual int fstat(struct stat *pstat) const;
 
     /**
-     * Perform various operations on a file descriptor
+     * Perform various operations on a file descriptor. In addition to the
+     * default ones, pipes support F_SETPIPE_SZ and F_GETPIPE_SZ
      * \param cmd specifies the operation to perform
      * \param opt optional argument that some operation require
      * \return the exact return value depends on CMD, -1 is returned on error
@@ -97,23 +245,36 @@ public:
     virtual int fcntl(int cmd, int opt);
 
     /**
-     * Destructor
+     * Check whether the file is ready for I/O, used to implement poll().
+     * \param events bitmask of requested events (POLLIN, POLLOUT, ...)
+     * \return the requested events that are currently ready
      */
-    ~Pipe();
+    virtual int poll(int events);
 
-private:
     /**
-     * \return true if there is only one file descriptor associated with the pipe
-     * Must be called with mutex locked
+     * Move data from this file to another one, used to implement splice().
+     * \param out file where data is written
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, or a negative number on failure
      */
-    bool unconnected();
+    virtual ssize_t spliceTo(FileBase *out, size_t len);
 
-    static const int defaultSize=256;
-    static const int pollTime=100000000; //100ms
-    FastMutex m;
-    ConditionVariable cv;
-    int put, get, size, capacity;
-    char *buffer;
+    /**
+     * Move data from another file to this one, used to implement splice().
+     * \param in file where data is read
+     * \param len max number of bytes to move
+     * \return the number of bytes moved, or a negative number on failure
+     */
+    virtual ssize_t spliceFrom(FileBase *in, size_t len);
+
+    /**
+     * Destructor
+     */
+    ~PipeEnd();
+
+private:
+    intrusive_ref_ptr<Pipe> pipe; ///< Buffer shared with the other end
+    const bool writeEnd;          ///< True if this is the write end
 };
 
 } //namespace miosix
@@ -0,0 +1,88 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include <time.h>
+#include <signal.h>
+
+#if __has_include(<poll.h>)
+#include <poll.h>
+#else //__has_include(<poll.h>)
+
+// The Miosix newlib does not provide poll.h, so the definitions are here.
+// Values are the same as Linux, and are part of the process syscall ABI
+
+#define POLLIN     0x0001 ///< Data available for reading
+#define POLLPRI    0x0002 ///< Urgent data available for reading
+#define POLLOUT    0x0004 ///< Writing will not block
+#define POLLERR    0x0008 ///< Error condition, only returned in revents
+#define POLLHUP    0x0010 ///< Other end hung up, only returned in revents
+#define POLLNVAL   0x0020 ///< Invalid fd, only returned in revents
+#define POLLRDNORM 0x0040 ///< Same as POLLIN
+#define POLLWRNORM 0x0100 ///< Same as POLLOUT
+
+typedef unsigned int nfds_t;
+
+struct pollfd
+{
+    int fd;        ///< File descriptor to poll, negative values are ignored
+    short events;  ///< Requested events
+    short revents; ///< Returned events
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif //__cplusplus
+
+/**
+ * Wait for one of a set of file descriptors to become ready for I/O
+ * \param fds array of file descriptors to wait for
+ * \param nfds number of elements in fds
+ * \param timeout timeout in milliseconds, negative means no timeout
+ * \return the number of file descriptors with nonzero revents, 0 on timeout,
+ * or -1 on failure, setting errno
+ */
+int poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
+/**
+ * Same as poll(), with a timespec timeout.
+ * \param fds array of file descriptors to wait for
+ * \param nfds number of elements in fds
+ * \param timeout relative timeout, nullptr means no timeout
+ * \param sigmask ignored, as Miosix has no signal support
+ * \return the number of file descriptors with nonzero revents, 0 on timeout,
+ * or -1 on failure, setting errno
+ */
+int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *timeout,
+          const sigset_t *sigmask);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
+
+#endif //__has_include(<poll.h>)
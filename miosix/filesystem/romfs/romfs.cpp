@@ -86,19 +86,6 @@ static void fillStatHelper(struct stat* pstat, const RomFsDirectoryEntry *entry,
     pstat->st_blocks=(pstat->st_size+512-1)/512;
 }
 
-/**
- * Compute address of next RomFsDirectoryEntry entry
- * \param entry current directory entry
- * \return pointer to next entry.
- * Note, if entry was the last one, the returned pointer is one past the last one
- */
-static const RomFsDirectoryEntry *nextEntry(const RomFsDirectoryEntry *entry)
-{
-    auto last=reinterpret_cast<unsigned int>(entry->name+strlen(entry->name)+1);
-    return reinterpret_cast<const RomFsDirectoryEntry *>(
-        (last+romFsStructAlignment-1) & (0-romFsStructAlignment));
-}
-
 /**
  * File class for MemoryMappedRomFs
  */
@@ -281,9 +268,12 @@ int MemoryMappedRomFsDirectory::getdents(void *dp, int len)
 //
 
 MemoryMappedRomFs::MemoryMappedRomFs(const void *baseAddress)
-    : base(reinterpret_cast<const char*>(baseAddress)), failed(false)
+    : base(reinterpret_cast<const char*>(baseAddress)), failed(false),
+      hashed(true)
 {
     auto header=ptr<const RomFsHeader*>(0);
+    if(strncmp(header->fsName,"RomFs 2.02",11)==0) return;
+    hashed=false; //Older images have no directory index
     if(strncmp(header->fsName,"RomFs 2.01",11)==0) return;
     errorLog("Unexpected FS version %s\n",header->fsName);
     failed=true;
@@ -348,19 +338,19 @@ const RomFsDirectoryEntry *MemoryMappedRomFs::findEntry(StringPart& name)
     while(auto element=pw.next())
     {
         if((fromLittleEndian16(entry->mode) & S_IFMT)!=S_IFDIR) return nullptr;
-        unsigned int inode=fromLittleEndian32(entry->inode);
-        const void *end=ptr(inode+fromLittleEndian32(entry->size));
-        entry=ptr<const RomFsDirectoryEntry *>(inode+sizeof(RomFsFirstEntry));
-        while(entry<end)
-        {
-            if(strcmp(element->c_str(),entry->name)==0) break;
-            entry=nextEntry(entry);
-        }
-        if(entry>=end) return nullptr; //Not found
+        entry=findInDirectory(entry,element->c_str());
+        if(entry==nullptr) return nullptr; //Not found
     }
     return entry;
 }
 
+const RomFsDirectoryEntry *MemoryMappedRomFs::findInDirectory(
+        const RomFsDirectoryEntry *dir, const char *name)
+{
+    return romFsFindInDirectory(base,dir,name,hashed,
+        [](unsigned int x) { return fromLittleEndian32(x); });
+}
+
 } //namespace miosix
 
 #endif //WITH_FILESYSTEM
@@ -147,8 +147,17 @@ private:
      */
     const RomFsDirectoryEntry *findEntry(StringPart& name);
 
+    /**
+     * \param dir directory entry of the directory to search
+     * \param name file/directory/symlink name
+     * \return the entry within dir with the given name if found, or nullptr
+     */
+    const RomFsDirectoryEntry *findInDirectory(const RomFsDirectoryEntry *dir,
+                                               const char *name);
+
     const char * const base;
     bool failed; ///< Failed to mount
+    bool hashed; ///< Directories have a hash index (RomFs 2.02)
 };
 
 } //namespace miosix
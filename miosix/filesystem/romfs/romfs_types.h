@@ -29,13 +29,15 @@
 
 #pragma once
 
+#include <cstring>
+
 /**
  * Filesystem header, stored @ offset 0 from the filesystem image start
  */
 struct RomFsHeader
 {
     char marker[6];            ///< 5 'w' characters, null terminated
-    char fsName[11];           ///< "RomFs 2.00", null terminated
+    char fsName[11];           ///< "RomFs 2.02", null terminated
     char osName[7];            ///< "Miosix", null terminated
     unsigned int imageSize;    ///< Size of the entire filesystem image
     unsigned int unused;       ///< Reserved for future use, set as 0 for now
@@ -61,6 +63,32 @@ struct __attribute__((packed)) RomFsDirectoryEntry
     char name[];              ///< File name, null teminated
 };
 
+/**
+ * Since "RomFs 2.02" every directory inode is followed by a hash index of its
+ * entries, placed at the first aligned offset after the last entry. The
+ * directory size does not include the index, so entries can still be walked
+ * linearly as in "RomFs 2.01" images
+ */
+struct RomFsDirectoryIndex
+{
+    unsigned int numBuckets;  ///< Number of buckets, power of 2
+    unsigned int buckets[];   ///< Entry offset from the directory inode, 0=empty
+};
+
+/**
+ * Hash function used by RomFsDirectoryIndex (32 bit FNV-1a). Buckets are
+ * searched with linear probing starting from hash & (numBuckets-1), and there
+ * is always at least one empty bucket
+ * \param name file name, null terminated
+ * \return the hash of the name
+ */
+inline unsigned int romFsHash(const char *name)
+{
+    unsigned int hash=2166136261u;
+    for(;*name;name++) hash=(hash^static_cast<unsigned char>(*name))*16777619u;
+    return hash;
+}
+
 // All alignments must be power of 2
 const unsigned int romFsStructAlignment=4; ///< Alignment of all structs
 const unsigned int romFsFileAlignment=8;   ///< Alignment of all file contents
@@ -69,3 +97,52 @@ const unsigned int romFsImageAlignment=8;  ///< Alignment of image start and end
 static_assert(sizeof(RomFsHeader)==32,"");
 static_assert(sizeof(RomFsFirstEntry)==4,"");
 static_assert(sizeof(RomFsDirectoryEntry)==14,"");
+static_assert(sizeof(RomFsDirectoryIndex)==4,"");
+
+/**
+ * Find an entry in a directory. Shared by the filesystem and the host tools,
+ * that can't use the kernel byte order conversion functions, so that it is
+ * passed as a parameter
+ * \param image pointer to the start of the filesystem image
+ * \param dir directory entry of the directory to search
+ * \param name file/directory/symlink name, null terminated
+ * \param hashed true if directories have a hash index (RomFs 2.02)
+ * \param fromLittleEndian converts a 32 bit field of the image to the host
+ * byte order
+ * \return the entry within dir with the given name if found, or nullptr
+ */
+template<typename F>
+inline const RomFsDirectoryEntry *romFsFindInDirectory(const char *image,
+        const RomFsDirectoryEntry *dir, const char *name, bool hashed,
+        F fromLittleEndian)
+{
+    auto entryAt=[image](unsigned int offset)
+    {
+        return reinterpret_cast<const RomFsDirectoryEntry *>(image+offset);
+    };
+    unsigned int inode=fromLittleEndian(dir->inode);
+    unsigned int last=inode+fromLittleEndian(dir->size);
+    if(hashed)
+    {
+        last=(last+romFsStructAlignment-1) & (0-romFsStructAlignment);
+        auto index=reinterpret_cast<const RomFsDirectoryIndex *>(image+last);
+        unsigned int mask=fromLittleEndian(index->numBuckets)-1;
+        for(unsigned int i=romFsHash(name);;i++)
+        {
+            unsigned int offset=fromLittleEndian(index->buckets[i & mask]);
+            if(offset==0) return nullptr; //Empty bucket, not found
+            auto entry=entryAt(inode+offset);
+            if(std::strcmp(name,entry->name)==0) return entry;
+        }
+    }
+    //Entries are aligned with respect to the image start
+    unsigned int offset=inode+sizeof(RomFsFirstEntry);
+    while(offset<last)
+    {
+        auto entry=entryAt(offset);
+        if(std::strcmp(name,entry->name)==0) return entry;
+        offset+=sizeof(RomFsDirectoryEntry)+std::strlen(entry->name)+1;
+        offset=(offset+romFsStructAlignment-1) & (0-romFsStructAlignment);
+    }
+    return nullptr;
+}
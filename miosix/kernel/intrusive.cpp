@@ -33,6 +33,9 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstdlib>
+#include <vector>
+#include <set>
 
 // Unused stubs as the test code only tests IntrusiveList
 inline int atomicSwap(volatile int*, int) { return 0; }
@@ -172,6 +175,111 @@ void IntrusiveListBase::fail()
 }
 #endif //INTRUSIVE_LIST_ERROR_CHECK
 
+//
+// class IntrusivePairingHeapBase
+//
+
+void IntrusivePairingHeapBase::push(IntrusivePairingHeapItem *item)
+{
+    #ifdef INTRUSIVE_LIST_ERROR_CHECK
+    if(item->child || item->next || item->prev || item==root) fail();
+    #endif //INTRUSIVE_LIST_ERROR_CHECK
+    if(empty()) root=item;
+    else root=meld(root,item);
+}
+
+void IntrusivePairingHeapBase::pop()
+{
+    #ifdef INTRUSIVE_LIST_ERROR_CHECK
+    if(root==nullptr || root->prev || root->next) fail();
+    #endif //INTRUSIVE_LIST_ERROR_CHECK
+    IntrusivePairingHeapItem *removedItem=root;
+    root=mergePairs(removedItem->child);
+    removedItem->child=nullptr;
+}
+
+void IntrusivePairingHeapBase::erase(IntrusivePairingHeapItem *item)
+{
+    #ifdef INTRUSIVE_LIST_ERROR_CHECK
+    if(root==nullptr || item==nullptr) fail();
+    if(item->prev==nullptr && item!=root) fail();
+    #endif //INTRUSIVE_LIST_ERROR_CHECK
+    if(item==root) return pop();
+    //Detach the subtree rooted at item from its parent and siblings
+    if(item->prev->child==item) item->prev->child=item->next;
+    else item->prev->next=item->next;
+    if(item->next!=nullptr) item->next->prev=item->prev;
+    item->prev=nullptr;
+    item->next=nullptr;
+    //Then reinsert the children of item
+    IntrusivePairingHeapItem *subtree=mergePairs(item->child);
+    item->child=nullptr;
+    if(subtree!=nullptr) root=meld(root,subtree);
+}
+
+IntrusivePairingHeapItem *IntrusivePairingHeapBase::meld(
+    IntrusivePairingHeapItem *a, IntrusivePairingHeapItem *b)
+{
+    if(less(b,a))
+    {
+        IntrusivePairingHeapItem *temp=a;
+        a=b;
+        b=temp;
+    }
+    //b becomes the leftmost child of a
+    b->prev=a;
+    b->next=a->child;
+    if(a->child!=nullptr) a->child->prev=b;
+    a->child=b;
+    return a;
+}
+
+IntrusivePairingHeapItem *IntrusivePairingHeapBase::mergePairs(
+    IntrusivePairingHeapItem *first)
+{
+    if(first==nullptr) return nullptr;
+    //First pass: meld pairs of siblings left to right, pushing the results in
+    //a stack linked through the next pointer
+    IntrusivePairingHeapItem *stack=nullptr;
+    while(first!=nullptr)
+    {
+        IntrusivePairingHeapItem *a=first;
+        IntrusivePairingHeapItem *b=a->next;
+        first= b!=nullptr ? b->next : nullptr;
+        a->prev=a->next=nullptr;
+        if(b!=nullptr)
+        {
+            b->prev=b->next=nullptr;
+            a=meld(a,b);
+        }
+        a->next=stack;
+        stack=a;
+    }
+    //Second pass: meld the stack right to left
+    IntrusivePairingHeapItem *result=stack;
+    stack=stack->next;
+    result->next=nullptr;
+    while(stack!=nullptr)
+    {
+        IntrusivePairingHeapItem *a=stack;
+        stack=stack->next;
+        a->next=nullptr;
+        result=meld(result,a);
+    }
+    return result;
+}
+
+#ifdef INTRUSIVE_LIST_ERROR_CHECK
+void IntrusivePairingHeapBase::fail()
+{
+    #ifndef TEST_ALGORITHM
+    errorHandler(UNEXPECTED);
+    #else //TEST_ALGORITHM
+    assert(false);
+    #endif //TEST_ALGORITHM
+}
+#endif //INTRUSIVE_LIST_ERROR_CHECK
+
 } //namespace miosix
 
 //Testsuite for IntrusiveList. Compile with:
@@ -299,6 +407,109 @@ void threeItemCheck(IntrusiveList<IntrusiveListItem>& list, IntrusiveListItem& a
     assert(c.next==nullptr);
 }
 
+class HeapItem : public IntrusivePairingHeapItem
+{
+public:
+    HeapItem() : key(0) {}
+    bool operator<(const HeapItem& rhs) const { return key<rhs.key; }
+    int key;
+};
+
+void emptyCheck(HeapItem& x)
+{
+    //Glass box check
+    assert(x.child==nullptr); assert(x.next==nullptr); assert(x.prev==nullptr);
+}
+
+void heapTest()
+{
+    IntrusivePairingHeap<HeapItem> heap;
+    assert(heap.empty());
+    HeapItem a,b,c;
+    a.key=1; b.key=2; c.key=3;
+
+    //Push / pop
+    heap.push(&b);
+    assert(heap.front()==&b);
+    heap.push(&c);
+    heap.push(&a);
+    assert(heap.front()==&a);
+    heap.pop();
+    emptyCheck(a);
+    assert(heap.front()==&b);
+    heap.pop();
+    emptyCheck(b);
+    assert(heap.front()==&c);
+    heap.pop();
+    emptyCheck(c);
+    assert(heap.empty());
+
+    //removeFast
+    assert(heap.removeFast(&a)==false); //Not present, heap empty
+    heap.push(&a);
+    assert(heap.removeFast(&b)==false); //Not present, heap not empty
+    assert(heap.removeFast(&a)==true);  //Present, only element
+    emptyCheck(a);
+    assert(heap.empty());
+    heap.push(&a);
+    heap.push(&b);
+    heap.push(&c);
+    assert(heap.removeFast(&b)==true);  //Present, not at the root
+    emptyCheck(b);
+    assert(heap.removeFast(&a)==true);  //Present, at the root
+    emptyCheck(a);
+    assert(heap.front()==&c);
+    assert(heap.removeFast(&c)==true);
+    assert(heap.empty());
+
+    //Randomized test against std::multiset
+    const int numItems=1000;
+    std::vector<HeapItem> items(numItems);
+    std::multiset<int> reference;
+    std::vector<bool> present(numItems,false);
+    srand(0);
+    for(int i=0;i<100000;i++)
+    {
+        int j=rand()%numItems;
+        switch(rand()%3)
+        {
+            case 0:
+                if(present[j]) break;
+                items[j].key=rand()%500;
+                heap.push(&items[j]);
+                reference.insert(items[j].key);
+                present[j]=true;
+                break;
+            case 1:
+                if(heap.empty()) break;
+                {
+                    HeapItem *x=heap.front();
+                    assert(x->key==*reference.begin());
+                    heap.pop();
+                    emptyCheck(*x);
+                    reference.erase(reference.begin());
+                    present[x-&items[0]]=false;
+                }
+                break;
+            case 2:
+                assert(heap.removeFast(&items[j])==present[j]);
+                emptyCheck(items[j]);
+                if(present[j]) reference.erase(reference.find(items[j].key));
+                present[j]=false;
+                break;
+        }
+        assert(heap.empty()==reference.empty());
+        if(!heap.empty()) assert(heap.front()->key==*reference.begin());
+    }
+    while(!heap.empty())
+    {
+        assert(heap.front()->key==*reference.begin());
+        heap.pop();
+        reference.erase(reference.begin());
+    }
+    assert(reference.empty());
+}
+
 int main()
 {
     IntrusiveListItem a,b,c;
@@ -405,6 +616,11 @@ int main()
     emptyCheck(list);
     emptyCheck(a);
 
+    //
+    // Testing IntrusivePairingHeap
+    //
+    heapTest();
+
     cout<<"Test passed"<<endl;
     return 0;
 }
@@ -865,4 +865,160 @@ public:
     bool empty() const { return IntrusiveListBase::empty(); }
 };
 
+//Forward declarations
+class IntrusivePairingHeapBase;
+template<typename T>
+class IntrusivePairingHeap;
+
+/**
+ * Base class from which all items to be put in an IntrusivePairingHeap must
+ * derive, contains the pointers that create the heap
+ */
+class IntrusivePairingHeapItem
+{
+private:
+    IntrusivePairingHeapItem *child=nullptr; ///< Leftmost child
+    IntrusivePairingHeapItem *next=nullptr;  ///< Right sibling
+    ///Left sibling, or parent if this is the leftmost child, nullptr if root
+    IntrusivePairingHeapItem *prev=nullptr;
+
+    friend class IntrusivePairingHeapBase;
+    template<typename T>
+    friend class IntrusivePairingHeap;
+};
+
+/**
+ * \internal
+ * Base class of IntrusivePairingHeap with the non-template-dependent part to
+ * improve code size when instantiationg multiple IntrusivePairingHeaps
+ */
+class IntrusivePairingHeapBase
+{
+protected:
+    /**
+     * Constructor
+     * \param less comparison function, returns true if the first item has to
+     * be extracted before the second
+     */
+    IntrusivePairingHeapBase(bool (*less)(const IntrusivePairingHeapItem*,
+        const IntrusivePairingHeapItem*)) : root(nullptr), less(less) {}
+
+    void push(IntrusivePairingHeapItem *item);
+
+    void pop();
+
+    void erase(IntrusivePairingHeapItem *item);
+
+    IntrusivePairingHeapItem *top() { return root; }
+
+    bool empty() const { return root==nullptr; }
+
+    bool contains(IntrusivePairingHeapItem *item) const
+    {
+        return item->prev!=nullptr || item==root;
+    }
+
+    #ifdef INTRUSIVE_LIST_ERROR_CHECK
+    static void fail();
+    #endif //INTRUSIVE_LIST_ERROR_CHECK
+
+private:
+    /**
+     * Meld two non empty heaps
+     * \return the root of the resulting heap
+     */
+    IntrusivePairingHeapItem *meld(IntrusivePairingHeapItem *a,
+                                   IntrusivePairingHeapItem *b);
+
+    /**
+     * Meld a list of sibling heaps with the two pass strategy
+     * \param first leftmost heap of the list, can be nullptr
+     * \return the root of the resulting heap
+     */
+    IntrusivePairingHeapItem *mergePairs(IntrusivePairingHeapItem *first);
+
+    IntrusivePairingHeapItem *root;
+    bool (*less)(const IntrusivePairingHeapItem*, const IntrusivePairingHeapItem*);
+};
+
+/**
+ * A min heap that only accepts objects that derive from
+ * IntrusivePairingHeapItem. Items are ordered using T::operator<
+ *
+ * Like IntrusiveList, this class never allocates memory and is a non-owning
+ * container, so the caller is responsible for managing the lifetime of the
+ * objects put in the heap.
+ *
+ * push() and top() are O(1), pop() and erase() are O(log n) amortized.
+ */
+template<typename T>
+class IntrusivePairingHeap : private IntrusivePairingHeapBase
+{
+public:
+    /**
+     * Constructor, produces an empty heap
+     */
+    IntrusivePairingHeap() : IntrusivePairingHeapBase(lessThan) {}
+
+    /**
+     * Disabled copy constructor and operator=
+     * Since intrusive heaps do not store objects by value, and an item can
+     * only belong to at most one heap, intrusive heaps are not copyable.
+     */
+    IntrusivePairingHeap(const IntrusivePairingHeap&)=delete;
+    IntrusivePairingHeap& operator=(const IntrusivePairingHeap&)=delete;
+
+    /**
+     * Adds item to the heap
+     * \param item item to add
+     */
+    void push(T *item) { IntrusivePairingHeapBase::push(item); }
+
+    /**
+     * Removes the smallest item of the heap. Heap must not be empty
+     */
+    void pop() { IntrusivePairingHeapBase::pop(); }
+
+    /**
+     * Removes an arbitrary item from the heap
+     * NOTE: can ONLY be called if you are sure the item to remove is either not
+     * in any heap (in this case, nothing is done) or is in the heap it is being
+     * removed from. Trying to remove an item that is present in another heap
+     * produces undefined bahavior.
+     * \param item item to remove, must not be nullptr
+     * \return true if the item was removed, false if the item was not present
+     * in the heap
+     */
+    bool removeFast(T *item)
+    {
+        if(IntrusivePairingHeapBase::contains(item)==false) return false;
+        IntrusivePairingHeapBase::erase(item);
+        return true;
+    }
+
+    /**
+     * \return a pointer to the smallest item. Heap must not be empty
+     */
+    T* front()
+    {
+        auto result=IntrusivePairingHeapBase::top();
+        #ifdef INTRUSIVE_LIST_ERROR_CHECK
+        if(result==nullptr) fail();
+        #endif //INTRUSIVE_LIST_ERROR_CHECK
+        return static_cast<T*>(result);
+    }
+
+    /**
+     * \return true if the heap is empty
+     */
+    bool empty() const { return IntrusivePairingHeapBase::empty(); }
+
+private:
+    static bool lessThan(const IntrusivePairingHeapItem *a,
+                         const IntrusivePairingHeapItem *b)
+    {
+        return *static_cast<const T*>(a) < *static_cast<const T*>(b);
+    }
+};
+
 } //namespace miosix
@@ -64,7 +64,7 @@ volatile Thread *runningThread=nullptr;///<\internal Thread currently running
 ///\internal True if there are threads in the DELETED status. Used by idle thread
 static volatile bool existDeleted=false;
 
-IntrusiveList<SleepData> sleepingList;///list of sleeping threads
+IntrusivePairingHeap<SleepData> sleepingList;///heap of sleeping threads
 
 ///\internal !=0 after pauseKernel(), ==0 after restartKernel()
 volatile int kernelRunning=0;
@@ -258,20 +258,14 @@ bool isKernelRunning()
 /**
  * \internal
  * Used by Thread::sleep() and pthread_cond_timedwait() to add a thread to
- * sleeping list. The list is sorted by the wakeupTime field to reduce time
- * required to wake threads during context switch.
+ * sleeping list. The list is a min heap on the wakeupTime field, so insertion
+ * takes constant time regardless of the number of sleeping threads, keeping
+ * the time spent with interrupts disabled short.
  * Interrupts must be disabled prior to calling this function.
  */
 static void IRQaddToSleepingList(SleepData *x)
 {
-    if(sleepingList.empty() || sleepingList.front()->wakeupTime>=x->wakeupTime)
-    {
-        sleepingList.push_front(x);
-    } else {
-        auto it=sleepingList.begin();
-        while(it!=sleepingList.end() && (*it)->wakeupTime<x->wakeupTime) ++it;
-        sleepingList.insert(it,x);
-    }
+    sleepingList.push(x);
 }
 
 /**
@@ -286,16 +280,17 @@ bool IRQwakeThreads(long long currentTime)
     if(sleepingList.empty()) return false; //If no item in list, return
     
     bool result=false;
-    //Since list is sorted, if we don't need to wake the first element
+    //Since the list is a min heap, if we don't need to wake the first element
     //we don't need to wake the other too
-    for(auto it=sleepingList.begin();it!=sleepingList.end();)
+    while(sleepingList.empty()==false)
     {
-        if(currentTime<(*it)->wakeupTime) break;
+        SleepData *d=sleepingList.front();
+        if(currentTime<d->wakeupTime) break;
         //Wake both threads doing absoluteSleep() and timedWait()
-        (*it)->thread->flags.IRQclearSleepAndWait();
-        if(const_cast<Thread*>(runningThread)->IRQgetPriority()<(*it)->thread->IRQgetPriority())
+        d->thread->flags.IRQclearSleepAndWait();
+        if(const_cast<Thread*>(runningThread)->IRQgetPriority()<d->thread->IRQgetPriority())
             result=true;
-        it=sleepingList.erase(it);
+        sleepingList.pop();
     }
     return result;
 }
@@ -506,7 +501,7 @@ void Thread::setPriority(Priority pr)
         while(walk!=nullptr)
         {
             if(walk->waiting.empty()==false)
-                pr=std::max(pr,walk->waiting.front()->PKgetPriority());
+                pr=std::max(pr,walk->waiting.front()->thread->PKgetPriority());
             walk=walk->next;
         }
     }
@@ -709,8 +704,8 @@ void Thread::setupUserspaceContext(unsigned int entry, int argc, void *argvSp,
 
 Thread::Thread(unsigned int *watermark, unsigned int stacksize,
                bool defaultReent) : schedData(), flags(this), savedPriority(0),
-               mutexLocked(nullptr), mutexWaiting(nullptr), watermark(watermark),
-               ctxsave(), stacksize(stacksize)
+               mutexLocked(nullptr), mutexWaiting(nullptr), mutexWaitData(this),
+               watermark(watermark), ctxsave(), stacksize(stacksize)
 {
     joinData.waitingForJoin=nullptr;
     if(defaultReent) cReentrancyData=_GLOBAL_REENT;
@@ -793,6 +788,11 @@ void Thread::threadLauncher(void *(*threadfunc)(void*), void *argv)
     #endif //__NO_EXCEPTIONS
     //Thread returned from its entry point, so delete it
 
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    //Must be done while the thread still exists and the kernel is running
+    SmallObjectHeap::flushCurrentThreadCache();
+    #endif //WITH_SMALL_OBJECT_HEAP
+
     //Since the thread is running, it cannot be in the sleepingList, so no need
     //to remove it from the list
     {
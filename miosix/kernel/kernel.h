@@ -31,6 +31,7 @@
 #include "interfaces/portability.h"
 #include "kernel/scheduler/sched_types.h"
 #include "stdlib_integration/libstdcpp_integration.h"
+#include "stdlib_integration/small_object_heap.h"
 #include "intrusive.h"
 #include "cpu_time_counter_types.h"
 
@@ -443,6 +444,26 @@ class ConditionVariable;
 class ProcessBase;
 #endif //WITH_PROCESSES
 
+/**
+ * \internal
+ * This class is used to make a heap of threads waiting to lock a Mutex, sorted
+ * so that the highest priority thread is extracted first. An instance is
+ * embedded in every thread, as a thread can wait on at most one Mutex, so
+ * that blocking on a Mutex never allocates memory.
+ * It is used by the kernel, and should not be used by end users.
+ */
+class MutexWaitData : public IntrusivePairingHeapItem
+{
+public:
+    MutexWaitData(Thread *thread) : thread(thread) {}
+
+    ///\internal Higher priority threads are extracted first
+    inline bool operator<(const MutexWaitData& rhs) const;
+
+    ///\internal Thread that is waiting
+    Thread *thread;
+};
+
 /**
  * This class represents a thread. It has methods for creating, deleting and
  * handling threads.<br>It has private constructor and destructor, since memory
@@ -1204,6 +1225,8 @@ private:
     Mutex *mutexLocked;
     ///If the thread is waiting on a Mutex, mutexWaiting points to that Mutex
     Mutex *mutexWaiting;
+    ///Used to put the thread in the heap of threads waiting on mutexWaiting
+    MutexWaitData mutexWaitData;
     unsigned int *watermark;///< pointer to watermark area
     unsigned int ctxsave[CTXSAVE_SIZE];///< Holds cpu registers during ctxswitch
     unsigned int stacksize;///< Contains stack size
@@ -1219,6 +1242,10 @@ private:
     /// Per-thread instance of data to make the C and C++ libraries thread safe.
     struct _reent *cReentrancyData;
     CppReentrancyData cppReentrancyData;
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    ///Per-thread cache of the small object heap
+    SmallObjectHeapCache heapCache;
+    #endif //WITH_SMALL_OBJECT_HEAP
     #ifdef WITH_PROCESSES
     ///Process to which this thread belongs. Kernel threads point to a special
     ///ProcessBase that represents the kernel.
@@ -1258,19 +1285,34 @@ private:
     //Needs access to timeCounterData
     friend class CPUTimeCounter;
     #endif //WITH_CPU_TIME_COUNTER
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    //Needs access to heapCache
+    friend class SmallObjectHeapAccessor;
+    #endif //WITH_SMALL_OBJECT_HEAP
 };
 
+inline bool MutexWaitData::operator<(const MutexWaitData& rhs) const
+{
+    return rhs.thread->PKgetPriority().mutexLessOp(thread->PKgetPriority());
+}
+
 /**
  * \internal
- * This class is used to make a list of sleeping threads.
+ * This class is used to make a heap of sleeping threads.
  * It is used by the kernel, and should not be used by end users.
  */
-class SleepData : public IntrusiveListItem
+class SleepData : public IntrusivePairingHeapItem
 {
 public:
     SleepData(Thread *thread, long long wakeupTime)
         : thread(thread), wakeupTime(wakeupTime) {}
 
+    ///\internal Sleeping threads are sorted by wakeup time
+    bool operator<(const SleepData& rhs) const
+    {
+        return wakeupTime<rhs.wakeupTime;
+    }
+
     ///\internal Thread that is sleeping
     Thread *thread;
     
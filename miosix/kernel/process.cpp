@@ -51,7 +51,7 @@ namespace miosix {
 /**
  * Used to check if a pointer passed from userspace is aligned
  */
-static bool aligned(void *x) { return (reinterpret_cast<unsigned>(x) & 0b11)==0; }
+static bool aligned(const void *x) { return (reinterpret_cast<unsigned>(x) & 0b11)==0; }
 
 /**
  * Validate that a string array parameter, such as the one passed to the execve
@@ -855,6 +855,60 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
                 break;
             }
 
+            case Syscall::FUTEX:
+            {
+                auto addr=reinterpret_cast<int*>(sp.getParameter(0));
+                int op=sp.getParameter(1);
+                int val=sp.getParameter(2);
+                if(mpu.withinForWriting(addr,sizeof(int)) && aligned(addr))
+                {
+                    switch(op)
+                    {
+                        case FUTEX_WAIT:
+                            sp.setParameter(0,futexWait(addr,val));
+                            break;
+                        case FUTEX_WAKE:
+                            sp.setParameter(0,futexWake(addr,val));
+                            break;
+                        default:
+                            sp.setParameter(0,-EINVAL);
+                    }
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
+            case Syscall::POLL:
+            {
+                auto fds=reinterpret_cast<struct pollfd*>(sp.getParameter(0));
+                unsigned int nfds=sp.getParameter(1);
+                auto ts=reinterpret_cast<const struct timespec*>(sp.getParameter(2));
+                long long timeout=-1;
+                if(ts)
+                {
+                    if(mpu.withinForReading(ts,sizeof(struct timespec))==false
+                        || aligned(ts)==false)
+                    {
+                        sp.setParameter(0,-EFAULT);
+                        break;
+                    }
+                    if(ts->tv_sec<0 || ts->tv_nsec<0 || ts->tv_nsec>=1000000000)
+                    {
+                        sp.setParameter(0,-EINVAL);
+                        break;
+                    }
+                    timeout=static_cast<long long>(ts->tv_sec)*1000000000LL
+                           +ts->tv_nsec;
+                }
+                if(nfds>MAX_OPEN_FILES) sp.setParameter(0,-EINVAL);
+                else if(nfds==0 || (aligned(fds) &&
+                        mpu.withinForWriting(fds,nfds*sizeof(struct pollfd))))
+                {
+                    int result=fileTable.poll(fds,nfds,timeout);
+                    sp.setParameter(0,result);
+                } else sp.setParameter(0,-EFAULT);
+                break;
+            }
+
             default:
                 exitCode=SIGSYS; //Bad syscall
                 #ifdef WITH_ERRLOG
@@ -868,6 +922,43 @@ Process::SvcResult Process::handleSvc(miosix_private::SyscallParameters sp)
     return Resume;
 }
 
+int Process::futexWait(int *addr, int val)
+{
+    FutexWaitToken token(Thread::getCurrentThread(),addr);
+    FastInterruptDisableLock dLock;
+    //Userspace can't run while we hold the lock, so if the futex word still
+    //holds the expected value no futexWake can be missed
+    if(*addr!=val) return -EAGAIN;
+    futexList.push_back(&token);
+    Thread::IRQenableIrqAndWait(dLock);
+    if(token.thread) futexList.removeFast(&token); //Spurious wakeup
+    return 0;
+}
+
+int Process::futexWake(int *addr, int n)
+{
+    int woken=0;
+    bool hppw=false;
+    {
+        FastInterruptDisableLock dLock;
+        auto it=futexList.begin();
+        while(it!=futexList.end() && woken<n)
+        {
+            FutexWaitToken *token=*it;
+            if(token->addr!=addr) { ++it; continue; }
+            it=futexList.erase(it);
+            Thread *t=token->thread;
+            token->thread=nullptr;
+            t->IRQwakeup();
+            if(t->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+                hppw=true;
+            woken++;
+        }
+    }
+    if(hppw) Thread::yield();
+    return woken;
+}
+
 pid_t Process::getNewPid()
 {
     auto& p=Processes::instance();
@@ -212,6 +212,25 @@ private:
      * terminated
      */
     SvcResult handleSvc(miosix_private::SyscallParameters sp);
+
+    /**
+     * Block the calling thread on a futex, unless the futex word has already
+     * changed. The comparison and the insertion in the wait list are atomic
+     * with respect to futexWake(), so no wakeup can be lost.
+     * \param addr futex word, must have been validated against the MPU
+     * \param val expected value of the futex word
+     * \return 0 if the thread was woken (spurious wakeups are possible), or
+     * -EAGAIN if *addr!=val
+     */
+    int futexWait(int *addr, int val);
+
+    /**
+     * Wake threads blocked on a futex, in FIFO order
+     * \param addr futex word
+     * \param n maximum number of threads to wake
+     * \return the number of threads woken
+     */
+    int futexWake(int *addr, int n);
     
     /**
      * \return an unique pid that is not zero and is not already in use in the
@@ -236,6 +255,20 @@ private:
     ///wait on this condition variable
     ConditionVariable waiting;
     bool zombie; ///< True for terminated not yet joined processes
+
+    /**
+     * A thread blocked in a FUTEX_WAIT syscall
+     */
+    class FutexWaitToken : public IntrusiveListItem
+    {
+    public:
+        FutexWaitToken(Thread *thread, int *addr) : thread(thread), addr(addr) {}
+        Thread *thread; ///< Waiting thread, nullptr once woken
+        int *addr;      ///< Futex word the thread is waiting on
+    };
+    ///Threads of this process waiting on a futex. A single list is enough as
+    ///the number of threads in a process is expected to be small
+    IntrusiveList<FutexWaitToken> futexList;
     short int exitCode; ///< Contains the exit code
     
     //Needs access to fault,mpu
@@ -397,6 +430,28 @@ enum class Syscall
     MOUNT     = 50,
     UMOUNT    = 51,
     MKFS      = 52, //Moving filesystem creation code to kernel
+
+    // Synchronization syscalls
+    // Futex. Parameters are the address of a 4 byte aligned int within the
+    // process memory, the operation (FUTEX_WAIT or FUTEX_WAKE) and a value.
+    // FUTEX_WAIT blocks if the int still equals value, FUTEX_WAKE wakes up to
+    // value threads. Used to implement userspace mutexes and condition
+    // variables whose uncontended path does not need a syscall.
+    FUTEX     = 53,
+
+    // I/O multiplexing syscalls
+    // Parameters are the same as ppoll() without sigmask, the timeout is a
+    // pointer to a relative timespec, or nullptr to wait forever
+    POLL      = 54,
+};
+
+/**
+ * Operations of the FUTEX syscall
+ */
+enum FutexOp
+{
+    FUTEX_WAIT = 0,
+    FUTEX_WAKE = 1
 };
 
 } //namespace miosix
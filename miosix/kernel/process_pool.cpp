@@ -28,6 +28,7 @@
 #include "process_pool.h"
 #include <stdexcept>
 #include <cstring>
+#include <algorithm>
 
 using namespace std;
 
@@ -46,7 +47,10 @@ ProcessPool& ProcessPool::instance()
         reinterpret_cast<unsigned int>(&_process_pool_start));
     return pool;
     #else //TEST_ALLOC
-    static ProcessPool pool(reinterpret_cast<unsigned int*>(0x20008000),96*1024);
+    //The pool memory is now written to, as it holds the free lists. Mimic a
+    //96KB pool at 0x20008000, aligned to 32KB but not to 64KB
+    alignas(64*1024) static unsigned int memory[160*1024/sizeof(unsigned int)];
+    static ProcessPool pool(memory+32*1024/sizeof(unsigned int),96*1024);
     return pool;
     #endif //TEST_ALLOC
 }
@@ -60,29 +64,24 @@ unsigned int *ProcessPool::allocate(unsigned int size)
     if((size & (size - 1)) || size>poolSize || size<blockSize)
             throw runtime_error("");
     
-    unsigned int offset=0;
-    if(reinterpret_cast<unsigned int>(poolBase) % size)
-        offset=size-(reinterpret_cast<unsigned int>(poolBase) % size);
-    unsigned int startBit=offset/blockSize;
-    unsigned int sizeBit=size/blockSize;
-
-    for(unsigned int i=startBit;i<=poolSize/blockSize;i+=sizeBit)
+    unsigned int order=__builtin_ctz(size)-blockBits;
+    //Smallest non empty free list that can satisfy the request
+    unsigned int candidates=freeMask & ~((1u<<order)-1);
+    if(candidates==0) throw bad_alloc();
+    unsigned int current=__builtin_ctz(candidates);
+    FreeBlock *block=freeLists[current];
+    unsigned int i=(reinterpret_cast<unsigned int*>(block)-poolBase)
+                  /(blockSize/sizeof(unsigned int));
+    removeFree(i,current);
+    //Split the block, giving back the upper halves
+    while(current>order)
     {
-        bool notEmpty=false;
-        for(unsigned int j=0;j<sizeBit;j++)
-        {
-            if(testBit(i+j)==0) continue;
-            notEmpty=true;
-            break;
-        }
-        if(notEmpty) continue;
-        
-        for(unsigned int j=0;j<sizeBit;j++) setBit(i+j);
-        unsigned int *result=poolBase+i*blockSize/sizeof(unsigned int);
-        allocatedBlocks[result]=size;
-        return result;
+        current--;
+        pushFree(i+(1<<current),current);
     }
-    throw bad_alloc();
+    orders[i]=headFlag | allocatedFlag | order;
+    allocatedBlocks++;
+    return poolBase+i*(blockSize/sizeof(unsigned int));
 }
 
 void ProcessPool::deallocate(unsigned int *ptr)
@@ -90,31 +89,195 @@ void ProcessPool::deallocate(unsigned int *ptr)
     #ifndef TEST_ALLOC
     miosix::Lock<miosix::FastMutex> l(mutex);
     #endif //TEST_ALLOC
-    map<unsigned int*, unsigned int>::iterator it= allocatedBlocks.find(ptr);
-    if(it==allocatedBlocks.end())throw runtime_error("");
-    unsigned int size =(it->second)/blockSize;
-    unsigned int firstBit=(reinterpret_cast<unsigned int>(ptr)-
-                           reinterpret_cast<unsigned int>(poolBase))/blockSize;
-    for(unsigned int i=firstBit;i<firstBit+size;i++) clearBit(i);
-    allocatedBlocks.erase(it);
+    if(ptr<poolBase || ptr>=poolBase+poolSize/sizeof(unsigned int))
+        throw runtime_error("");
+    unsigned int offset=ptr-poolBase;
+    if(offset % (blockSize/sizeof(unsigned int))) throw runtime_error("");
+    unsigned int i=offset/(blockSize/sizeof(unsigned int));
+    if((orders[i] & (headFlag | allocatedFlag))!=(headFlag | allocatedFlag))
+        throw runtime_error("");
+    unsigned int order=orders[i] & orderMask;
+    allocatedBlocks--;
+    //Coalesce with the buddy as long as it is a free block of the same order.
+    //Buddies are computed on absolute addresses, as blocks are size-aligned
+    for(;;)
+    {
+        unsigned int buddy=((baseUnit+i) ^ (1<<order))-baseUnit;
+        if(buddy>=numBlocks || buddy+(1<<order)>numBlocks) break;
+        if(orders[buddy]!=(headFlag | order)) break;
+        removeFree(buddy,order);
+        if(buddy<i) swap(i,buddy);
+        orders[buddy]=0;
+        order++;
+    }
+    pushFree(i,order);
+}
+
+ProcessPoolStats ProcessPool::getStats()
+{
+    #ifndef TEST_ALLOC
+    miosix::Lock<miosix::FastMutex> l(mutex);
+    #endif //TEST_ALLOC
+    ProcessPoolStats result;
+    result.poolSize=poolSize;
+    result.freeSize=freeSize;
+    result.largestFreeBlock=freeMask ? blockSize<<(31-__builtin_clz(freeMask)) : 0;
+    result.freeBlocks=freeBlocks;
+    result.allocatedBlocks=allocatedBlocks;
+    return result;
+}
+
+void ProcessPool::pushFree(unsigned int i, unsigned int order)
+{
+    FreeBlock *block=node(i);
+    block->prev=nullptr;
+    block->next=freeLists[order];
+    if(block->next) block->next->prev=block;
+    freeLists[order]=block;
+    freeMask|=1<<order;
+    orders[i]=headFlag | order;
+    freeSize+=blockSize<<order;
+    freeBlocks++;
+}
+
+void ProcessPool::removeFree(unsigned int i, unsigned int order)
+{
+    FreeBlock *block=node(i);
+    if(block->prev) block->prev->next=block->next;
+    else freeLists[order]=block->next;
+    if(block->next) block->next->prev=block->prev;
+    if(freeLists[order]==nullptr) freeMask&=~(1<<order);
+    freeSize-=blockSize<<order;
+    freeBlocks--;
 }
 
 ProcessPool::ProcessPool(unsigned int *poolBase, unsigned int poolSize)
-    : poolBase(poolBase), poolSize(poolSize)
+    : poolBase(poolBase), poolSize(poolSize), freeMask(0), freeSize(0),
+      freeBlocks(0), allocatedBlocks(0)
 {
-    int numBytes=poolSize/blockSize/8;
-    bitmap=new unsigned int[numBytes/sizeof(unsigned int)];
-    memset(bitmap,0,numBytes);
+    numBlocks=poolSize/blockSize;
+    baseUnit=reinterpret_cast<unsigned int>(poolBase)/blockSize;
+    orders=new unsigned char[numBlocks];
+    memset(orders,0,numBlocks);
+    for(unsigned int j=0;j<numOrders;j++) freeLists[j]=nullptr;
+    //Split the pool in the largest blocks that are aligned to their size
+    for(unsigned int i=0;i<numBlocks;)
+    {
+        unsigned int order=0;
+        while(order+1<numOrders && ((baseUnit+i) & ((2<<order)-1))==0 &&
+              i+(2<<order)<=numBlocks) order++;
+        pushFree(i,order);
+        i+=1<<order;
+    }
 }
 
 ProcessPool::~ProcessPool()
 {
-    delete[] bitmap;
+    delete[] orders;
 }
 
 } //namespace miosix
 
 #ifdef TEST_ALLOC
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+/**
+ * Print fragmentation statistics
+ */
+static void printStats(miosix::ProcessPool& pool)
+{
+    using namespace std;
+    miosix::ProcessPoolStats s=pool.getStats();
+    cout<<"free "<<s.freeSize<<"/"<<s.poolSize<<" in "<<s.freeBlocks
+        <<" blocks, largest free block "<<s.largestFreeBlock<<", "
+        <<s.allocatedBlocks<<" allocated blocks"<<endl;
+}
+
+/**
+ * Randomized stress test. Allocates and frees blocks of random size checking
+ * alignment, that blocks don't overlap and that memory fully coalesces back
+ * \param iterations number of random operations
+ */
+static void stress(miosix::ProcessPool& pool, unsigned int iterations)
+{
+    using namespace std;
+    using namespace miosix;
+    struct Block { unsigned int *ptr; unsigned int size; };
+    vector<Block> blocks;
+    unsigned int failures=0;
+    const ProcessPoolStats initial=pool.getStats();
+    auto check=[](bool x, const char *msg)
+    {
+        if(x) return;
+        cout<<"Stress test failed: "<<msg<<endl;
+        exit(1);
+    };
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        if(blocks.empty() || rand()%2)
+        {
+            unsigned int size=ProcessPool::blockSize<<(rand()%6);
+            try {
+                unsigned int *p=pool.allocate(size);
+                check(reinterpret_cast<unsigned long>(p) % size==0,"alignment");
+                //Tag every word, overlapping blocks would overwrite the tags
+                for(unsigned int j=0;j<size/sizeof(unsigned int);j++) p[j]=i;
+                blocks.push_back({p,size});
+            } catch(bad_alloc&) {
+                failures++;
+            }
+        } else {
+            unsigned int idx=rand()%blocks.size();
+            Block b=blocks[idx];
+            for(unsigned int j=0;j<b.size/sizeof(unsigned int);j++)
+                check(b.ptr[j]==b.ptr[0],"overlap");
+            pool.deallocate(b.ptr);
+            blocks[idx]=blocks.back();
+            blocks.pop_back();
+        }
+    }
+    printStats(pool);
+    for(auto& b : blocks) pool.deallocate(b.ptr);
+    ProcessPoolStats final=pool.getStats();
+    check(final.freeSize==initial.freeSize,"leak");
+    check(final.freeBlocks==initial.freeBlocks,"incomplete coalescing");
+    cout<<"Stress test passed, "<<failures<<" allocations out of memory"<<endl;
+}
+
+/**
+ * Throughput benchmark, keeps a working set of live blocks and replaces one
+ * at random at each iteration
+ * \param iterations number of allocate/deallocate pairs
+ */
+static void benchmark(miosix::ProcessPool& pool, unsigned int iterations)
+{
+    using namespace std;
+    using namespace miosix;
+    const unsigned int working=16;
+    vector<unsigned int*> blocks(working,nullptr);
+    vector<unsigned int> sizes;
+    for(unsigned int i=0;i<iterations;i++) sizes.push_back(rand()%5);
+    auto start=chrono::steady_clock::now();
+    for(unsigned int i=0;i<iterations;i++)
+    {
+        unsigned int idx=i%working;
+        if(blocks[idx]) pool.deallocate(blocks[idx]);
+        try {
+            blocks[idx]=pool.allocate(ProcessPool::blockSize<<sizes[i]);
+        } catch(bad_alloc&) {
+            blocks[idx]=nullptr;
+        }
+    }
+    auto end=chrono::steady_clock::now();
+    printStats(pool);
+    for(auto p : blocks) if(p) pool.deallocate(p);
+    auto ns=chrono::duration_cast<chrono::nanoseconds>(end-start).count();
+    cout<<iterations<<" allocate/deallocate pairs, "<<ns/iterations
+        <<"ns per pair"<<endl;
+}
+
 //g++ -m32 -o pp -DTEST_ALLOC -DWITH_PROCESSES process_pool.cpp && ./pp
 int main()
 {
@@ -122,11 +285,11 @@ int main()
     ProcessPool& pool=ProcessPool::instance();
     while(1)
     {
-        cout<<"a<size(exponent)>|d<addr>"<<endl;
-        unsigned int param;
+        cout<<"a<size(exponent)>|d<addr>|s<iterations>|b<iterations>|f"<<endl;
+        unsigned long param;
         char op;
         string line;
-        getline(cin,line);
+        if(!getline(cin,line)) return 0;
         stringstream ss(line);
         ss>>op;
         switch(op)
@@ -149,6 +312,17 @@ int main()
                 }
                 pool.printAllocatedBlocks();
                 break;
+            case 's':
+                ss>>dec>>param;
+                stress(pool,param);
+                break;
+            case 'b':
+                ss>>dec>>param;
+                benchmark(pool,param);
+                break;
+            case 'f':
+                printStats(pool);
+                break;
             default:
                 cout<<"Incorrect option"<<endl;
                 break;
@@ -28,8 +28,6 @@
 #ifndef PROCESS_POOL
 #define PROCESS_POOL
 
-#include <map>
-
 #ifndef TEST_ALLOC
 #include <miosix.h>
 #else //TEST_ALLOC
@@ -42,9 +40,27 @@
 
 namespace miosix {
 
+/**
+ * Fragmentation statistics of the process pool
+ */
+struct ProcessPoolStats
+{
+    unsigned int poolSize;         ///< Size of the pool, in bytes
+    unsigned int freeSize;         ///< Sum of the size of all free blocks
+    unsigned int largestFreeBlock; ///< Largest allocation that would succeed
+    unsigned int freeBlocks;       ///< Number of free blocks
+    unsigned int allocatedBlocks;  ///< Number of allocated blocks
+};
+
 /**
  * This class allows to handle a memory area reserved for the allocation of
  * processes' images. This memory area is called process pool.
+ *
+ * It is a buddy allocator: free blocks are kept in one list per order, and
+ * freeing a block coalesces it with its buddy when that is free too, so both
+ * allocate and deallocate are O(log n). The free list links are stored inside
+ * the free blocks themselves, and the only other metadata is one byte per
+ * blockSize unit recording the order of the block starting there.
  */
 class ProcessPool
 {
@@ -74,6 +90,11 @@ public:
      * \throws runtime_error if the pointer is invalid
      */
     void deallocate(unsigned int *ptr);
+
+    /**
+     * \return fragmentation statistics of the process pool
+     */
+    ProcessPoolStats getStats();
     
     #ifdef TEST_ALLOC
     /**
@@ -82,28 +103,14 @@ public:
     void printAllocatedBlocks()
     {
         using namespace std;
-        map<unsigned int*, unsigned int>::iterator it;
         cout<<endl;
-        for(it=allocatedBlocks.begin();it!=allocatedBlocks.end();it++)
-            cout <<"block of size " << it->second
-                 << " allocated @ " << it->first<<endl;
-        
-        cout<<"Bitmap:"<<endl;
-        const int SHIFT = 8 * sizeof(unsigned int);
-        const unsigned int MASK = 1 << (SHIFT-1);
-        int bitarray[32];
-        for(int i=0; i<(poolSize/blockSize)/(sizeof(unsigned int)*8);i++)
-        {   
-            int value=bitmap[i];
-            for ( int j = 0; j < SHIFT; j++ ) 
-            {
-                bitarray[31-j]= ( value & MASK ? 1 : 0 );
-                value <<= 1;
-            }
-            for(int j=0;j<32;j++)
-                cout<<bitarray[j];
-            cout << endl;
-        }  
+        for(unsigned int i=0;i<numBlocks;i++)
+        {
+            if(orders[i]==0) continue;
+            cout<<"block of size "<<(blockSize<<(orders[i] & orderMask))
+                <<(orders[i] & allocatedFlag ? " allocated @ " : " free @ ")
+                <<poolBase+i*blockSize/sizeof(unsigned int)<<endl;
+        }
     }
     #endif //TEST_ALLOC
     
@@ -119,7 +126,8 @@ private:
     
     /**
      * Constructor.
-     * \param poolBase address of the start of the process pool.
+     * \param poolBase address of the start of the process pool. Must be
+     * aligned to blockSize
      * \param poolSize size of the process pool. Must be a multiple of blockSize
      */
     ProcessPool(unsigned int *poolBase, unsigned int poolSize);
@@ -128,40 +136,59 @@ private:
      * Destructor
      */
     ~ProcessPool();
-    
+
     /**
-     * \param bit bit to test, from 0 to poolSize/blockSize
-     * \return true if the bit is set
+     * Free list node, stored at the beginning of each free block
      */
-    bool testBit(unsigned int bit)
+    struct FreeBlock
     {
-        return (bitmap[bit/(sizeof(unsigned int)*8)] &
-            1<<(bit % (sizeof(unsigned int)*8))) ? true : false;
-    }
-    
+        FreeBlock *next;
+        FreeBlock *prev;
+    };
+
     /**
-     * \param bit bit to set, from 0 to poolSize/blockSize
+     * \param i index of a blockSize unit within the pool
+     * \return the free list node of the block starting at that unit
      */
-    void setBit(unsigned int bit)
+    FreeBlock *node(unsigned int i)
     {
-        bitmap[(bit/(sizeof(unsigned int)*8))] |= 
-            1<<(bit % (sizeof(unsigned int)*8));
+        return reinterpret_cast<FreeBlock*>(poolBase+i*(blockSize/sizeof(unsigned int)));
     }
-    
+
     /**
-     * \param bit bit to clear, from 0 to poolSize/blockSize
+     * \param i index of the first unit of a free block
+     * \param order order of the block, its size is blockSize<<order
      */
-    void clearBit(unsigned int bit)
-    {
-        bitmap[bit/(sizeof(unsigned int)*8)] &= 
-            ~(1<<(bit % (sizeof(unsigned int)*8)));
-    }
-    
-    unsigned int *bitmap;   ///< Pointer to the status of the allocator
-    unsigned int *poolBase; ///< Base address of the entire pool
-    unsigned int poolSize;  ///< Size of the pool, in bytes
-    ///Lists all allocated blocks, allows to retrieve their sizes
-    std::map<unsigned int*,unsigned int> allocatedBlocks;
+    void pushFree(unsigned int i, unsigned int order);
+
+    /**
+     * \param i index of the first unit of a free block that is in the free
+     * list of the given order
+     * \param order order of the block
+     */
+    void removeFree(unsigned int i, unsigned int order);
+
+    ///Number of possible orders, block sizes go from blockSize to 2GB
+    static const unsigned int numOrders=32-blockBits;
+    ///Bits of orders[] that hold the block order
+    static const unsigned char orderMask=0x3f;
+    ///Set in orders[] if the block is allocated
+    static const unsigned char allocatedFlag=0x40;
+    ///Set in orders[] for the first unit of every block, free or allocated
+    static const unsigned char headFlag=0x80;
+
+    unsigned int *poolBase;      ///< Base address of the entire pool
+    unsigned int poolSize;       ///< Size of the pool, in bytes
+    unsigned int numBlocks;      ///< Size of the pool, in blockSize units
+    unsigned int baseUnit;       ///< Address of poolBase, in blockSize units
+    ///For each blockSize unit, headFlag|allocatedFlag|order if a block
+    ///starts there, 0 otherwise
+    unsigned char *orders;
+    FreeBlock *freeLists[numOrders]; ///< Free lists, one per order
+    unsigned int freeMask;       ///< Bit n set if freeLists[n] is not empty
+    unsigned int freeSize;       ///< Free bytes, for statistics
+    unsigned int freeBlocks;     ///< Number of free blocks, for statistics
+    unsigned int allocatedBlocks;///< Number of allocated blocks, for statistics
     #ifndef TEST_ALLOC
     miosix::FastMutex mutex; ///< Mutex to guard concurrent access
     #endif //TEST_ALLOC
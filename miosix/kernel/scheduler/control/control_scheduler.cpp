@@ -40,7 +40,7 @@ namespace miosix {
 //These are defined in kernel.cpp
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
-extern IntrusiveList<SleepData> sleepingList;
+extern IntrusivePairingHeap<SleepData> sleepingList;
 
 //Internal
 static long long burstStart=0;
@@ -40,7 +40,7 @@ namespace miosix {
 //These are defined in kernel.cpp
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
-extern IntrusiveList<SleepData> sleepingList;
+extern IntrusivePairingHeap<SleepData> sleepingList;
 
 //Static members
 static long long nextPreemption=numeric_limits<long long>::max();
@@ -37,7 +37,7 @@ namespace miosix {
 //These are defined in kernel.cpp
 extern volatile Thread *runningThread;
 extern volatile int kernelRunning;
-extern IntrusiveList<SleepData> sleepingList;
+extern IntrusivePairingHeap<SleepData> sleepingList;
 
 //Internal data
 static long long nextPeriodicPreemption=std::numeric_limits<long long>::max();
@@ -58,6 +58,12 @@ bool PriorityScheduler::PKaddThread(Thread *thread,
         thread->schedData.next=threadList[priority.get()]->schedData.next;
         threadList[priority.get()]->schedData.next=thread;
     }
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    //Not a FastInterruptDisableLock as this is also called before the kernel
+    //is started, when interrupts must remain disabled
+    InterruptDisableLock dLock;
+    if(thread->flags.isReady()) IRQaddToReadyQueue(thread);
+    #endif //SCHED_PRIORITY_READY_QUEUE
     return true;
 }
 
@@ -141,8 +147,20 @@ void PriorityScheduler::PKsetPriority(Thread *thread,
         PrioritySchedulerPriority newPriority)
 {
     PrioritySchedulerPriority oldPriority=thread->PKgetPriority();
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    {
+        //The ready queue is also modified by interrupts, pausing the kernel
+        //is not enough
+        FastInterruptDisableLock dLock;
+        bool ready=thread->schedData.readyNext!=nullptr;
+        if(ready) IRQremoveFromReadyQueue(thread);
+        thread->schedData.priority=newPriority;
+        if(ready) IRQaddToReadyQueue(thread);
+    }
+    #else //SCHED_PRIORITY_READY_QUEUE
     //First set priority to the new value
     thread->schedData.priority=newPriority;
+    #endif //SCHED_PRIORITY_READY_QUEUE
     //Then remove the thread from its old list
     if(threadList[oldPriority.get()]==thread)
     {
@@ -225,6 +243,38 @@ void PriorityScheduler::IRQfindNextThread()
     #ifdef WITH_CPU_TIME_COUNTER
     Thread *prev=const_cast<Thread*>(runningThread);
     #endif // WITH_CPU_TIME_COUNTER
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    if(readyBitmap!=0)
+    {
+        //The highest priority with at least one READY thread
+        int i=31-__builtin_clz(readyBitmap);
+        Thread *temp=readyList[i];
+        runningThread=temp;
+        #ifdef WITH_PROCESSES
+        if(const_cast<Thread*>(runningThread)->flags.isInUserspace()==false)
+        {
+            ctxsave=runningThread->ctxsave;
+            MPUConfiguration::IRQdisable();
+        } else {
+            ctxsave=runningThread->userCtxsave;
+            //A kernel thread is never in userspace, so the cast is safe
+            static_cast<Process*>(runningThread->proc)->mpu.IRQenable();
+        }
+        #else //WITH_PROCESSES
+        ctxsave=temp->ctxsave;
+        #endif //WITH_PROCESSES
+        //Rotate to next thread so that next time a different thread of the
+        //same priority, if available, will be chosen first
+        readyList[i]=temp->schedData.readyNext;
+        #ifndef WITH_CPU_TIME_COUNTER
+        IRQsetNextPreemption(false);
+        #else //WITH_CPU_TIME_COUNTER
+        auto t=IRQsetNextPreemption(false);
+        IRQprofileContextSwitch(prev->timeCounterData,temp->timeCounterData,t);
+        #endif //WITH_CPU_TIME_COUNTER
+        return;
+    }
+    #else //SCHED_PRIORITY_READY_QUEUE
     for(int i=PRIORITY_MAX-1;i>=0;i--)
     {
         if(threadList[i]==nullptr) continue;
@@ -262,6 +312,7 @@ void PriorityScheduler::IRQfindNextThread()
             if(temp==threadList[i]->schedData.next) break;
         }
     }
+    #endif //SCHED_PRIORITY_READY_QUEUE
     //No thread found, run the idle thread
     runningThread=idle;
     ctxsave=idle->ctxsave;
@@ -276,7 +327,54 @@ void PriorityScheduler::IRQfindNextThread()
     #endif //WITH_CPU_TIME_COUNTER
 }
 
+#ifdef SCHED_PRIORITY_READY_QUEUE
+void PriorityScheduler::IRQaddToReadyQueue(Thread *t)
+{
+    if(t->schedData.readyNext!=nullptr) return; //Already in the ready queue
+    short int i=t->schedData.priority.get();
+    Thread *head=readyList[i];
+    if(head==nullptr)
+    {
+        readyList[i]=t;
+        t->schedData.readyNext=t;//Circular list
+        t->schedData.readyPrev=t;
+        readyBitmap|=1u<<i;
+    } else {
+        //Insert at the tail, that is just before the head
+        Thread *tail=head->schedData.readyPrev;
+        t->schedData.readyNext=head;
+        t->schedData.readyPrev=tail;
+        tail->schedData.readyNext=t;
+        head->schedData.readyPrev=t;
+    }
+}
+
+void PriorityScheduler::IRQremoveFromReadyQueue(Thread *t)
+{
+    Thread *next=t->schedData.readyNext;
+    if(next==nullptr) return; //Not in the ready queue
+    short int i=t->schedData.priority.get();
+    if(next==t)
+    {
+        //Only one element in the list
+        readyList[i]=nullptr;
+        readyBitmap&=~(1u<<i);
+    } else {
+        Thread *prev=t->schedData.readyPrev;
+        prev->schedData.readyNext=next;
+        next->schedData.readyPrev=prev;
+        if(readyList[i]==t) readyList[i]=next;
+    }
+    t->schedData.readyNext=nullptr;
+    t->schedData.readyPrev=nullptr;
+}
+#endif //SCHED_PRIORITY_READY_QUEUE
+
 Thread *PriorityScheduler::threadList[PRIORITY_MAX]={nullptr};
+#ifdef SCHED_PRIORITY_READY_QUEUE
+Thread *PriorityScheduler::readyList[PRIORITY_MAX]={nullptr};
+unsigned int PriorityScheduler::readyBitmap=0;
+#endif //SCHED_PRIORITY_READY_QUEUE
 Thread *PriorityScheduler::idle=nullptr;
 
 } //namespace miosix
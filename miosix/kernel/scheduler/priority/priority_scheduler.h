@@ -35,6 +35,10 @@
 
 namespace miosix {
 
+#ifdef SCHED_PRIORITY_READY_QUEUE
+static_assert(PRIORITY_MAX<=32,"The ready queue bitmap supports at most 32 priorities");
+#endif //SCHED_PRIORITY_READY_QUEUE
+
 /**
  * \internal
  * Priority scheduler.
@@ -111,7 +115,13 @@ public:
      * its running status. For example when a thread become sleeping, waiting,
      * deleted or if it exits the sleeping or waiting status
      */
-    static void IRQwaitStatusHook(Thread* t) {}
+    static void IRQwaitStatusHook(Thread* t)
+    {
+        #ifdef SCHED_PRIORITY_READY_QUEUE
+        if(t->flags.isReady()) IRQaddToReadyQueue(t);
+        else IRQremoveFromReadyQueue(t);
+        #endif //SCHED_PRIORITY_READY_QUEUE
+    }
 
     /**
      * \internal
@@ -137,10 +147,40 @@ public:
 
 private:
 
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    /**
+     * \internal
+     * Add a thread at the tail of the ready queue of its priority.
+     * Does nothing if the thread is already in the ready queue.
+     * Can only be called with interrupts disabled or within an interrupt.
+     * \param t thread to add
+     */
+    static void IRQaddToReadyQueue(Thread *t);
+
+    /**
+     * \internal
+     * Remove a thread from the ready queue of its priority.
+     * Does nothing if the thread is not in the ready queue.
+     * Can only be called with interrupts disabled or within an interrupt.
+     * \param t thread to remove
+     */
+    static void IRQremoveFromReadyQueue(Thread *t);
+    #endif //SCHED_PRIORITY_READY_QUEUE
+
     ///\internal Vector of lists of threads, there's one list for each priority
     ///Each list s a circular list.
     static Thread *threadList[PRIORITY_MAX];
 
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    ///\internal Vector of lists of READY threads, there's one list for each
+    ///priority. Each list is a circular doubly linked list, whose head is the
+    ///next thread to run at that priority
+    static Thread *readyList[PRIORITY_MAX];
+
+    ///\internal Bit i is set if readyList[i] is not empty
+    static unsigned int readyBitmap;
+    #endif //SCHED_PRIORITY_READY_QUEUE
+
     ///\internal idle thread
     static Thread *idle;
 };
@@ -130,6 +130,12 @@ public:
     ///list to the new priority list.
     PrioritySchedulerPriority priority;
     Thread *next;///<Pointer to next thread of the same priority. CIRCULAR list
+    #ifdef SCHED_PRIORITY_READY_QUEUE
+    ///Pointer to next READY thread of the same priority. CIRCULAR list.
+    ///nullptr if the thread is not in the ready queue
+    Thread *readyNext=nullptr;
+    Thread *readyPrev=nullptr;///<Pointer to previous READY thread
+    #endif //SCHED_PRIORITY_READY_QUEUE
 };
 
 } //namespace miosix
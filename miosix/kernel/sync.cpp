@@ -35,17 +35,6 @@ using namespace std;
 
 namespace miosix {
 
-/**
- * Helper lambda to sort threads in a min heap to implement priority inheritance
- * \param lhs first thread to compare
- * \param rhs second thread to compare
- * \return true if lhs->getPriority() < rhs->getPriority()
- */
-static auto PKlowerPriority=[](Thread *lhs, Thread *rhs)
-{
-    return lhs->PKgetPriority().mutexLessOp(rhs->PKgetPriority());
-};
-
 //
 // class FastMutex
 //
@@ -99,23 +88,26 @@ void Mutex::PKlock(PauseKernelLock& dLock)
     }
 
     //Add thread to mutex' waiting queue
-    waiting.push_back(p);
-    push_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-
-    //Handle priority inheritance
     if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
     p->mutexWaiting=this;
-    if(owner->PKgetPriority().mutexLessOp(p->PKgetPriority()))
+    waiting.push(&p->mutexWaitData);
+
+    //Handle priority inheritance
+    Thread *walk=owner;
+    while(walk->PKgetPriority().mutexLessOp(p->PKgetPriority()))
     {
-        Thread *walk=owner;
-        for(;;)
+        Mutex *m=walk->mutexWaiting;
+        if(m==nullptr)
         {
             Scheduler::PKsetPriority(walk,p->PKgetPriority());
-            if(walk->mutexWaiting==nullptr) break;
-            make_heap(walk->mutexWaiting->waiting.begin(),
-                      walk->mutexWaiting->waiting.end(),PKlowerPriority);
-            walk=walk->mutexWaiting->owner;
+            break;
         }
+        //The heap of the mutex walk is waiting on is sorted by priority, so
+        //walk needs to be removed while its priority changes
+        m->waiting.removeFast(&walk->mutexWaitData);
+        Scheduler::PKsetPriority(walk,p->PKgetPriority());
+        m->waiting.push(&walk->mutexWaitData);
+        walk=m->owner;
     }
 
     //The while is necessary to protect against spurious wakeups
@@ -151,23 +143,26 @@ void Mutex::PKlockToDepth(PauseKernelLock& dLock, unsigned int depth)
     }
 
     //Add thread to mutex' waiting queue
-    waiting.push_back(p);
-    push_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-
-    //Handle priority inheritance
     if(p->mutexWaiting!=nullptr) errorHandler(UNEXPECTED);
     p->mutexWaiting=this;
-    if(owner->PKgetPriority().mutexLessOp(p->PKgetPriority()))
+    waiting.push(&p->mutexWaitData);
+
+    //Handle priority inheritance
+    Thread *walk=owner;
+    while(walk->PKgetPriority().mutexLessOp(p->PKgetPriority()))
     {
-        Thread *walk=owner;
-        for(;;)
+        Mutex *m=walk->mutexWaiting;
+        if(m==nullptr)
         {
             Scheduler::PKsetPriority(walk,p->PKgetPriority());
-            if(walk->mutexWaiting==nullptr) break;
-            make_heap(walk->mutexWaiting->waiting.begin(),
-                      walk->mutexWaiting->waiting.end(),PKlowerPriority);
-            walk=walk->mutexWaiting->owner;
+            break;
         }
+        //The heap of the mutex walk is waiting on is sorted by priority, so
+        //walk needs to be removed while its priority changes
+        m->waiting.removeFast(&walk->mutexWaitData);
+        Scheduler::PKsetPriority(walk,p->PKgetPriority());
+        m->waiting.push(&walk->mutexWaitData);
+        walk=m->owner;
     }
 
     //The while is necessary to protect against spurious wakeups
@@ -241,8 +236,8 @@ bool Mutex::PKunlock(PauseKernelLock& dLock)
         while(walk!=nullptr)
         {
             if(walk->waiting.empty()==false)
-                if(pr.mutexLessOp(walk->waiting.front()->PKgetPriority()))
-                    pr=walk->waiting.front()->PKgetPriority();
+                if(pr.mutexLessOp(walk->waiting.front()->thread->PKgetPriority()))
+                    pr=walk->waiting.front()->thread->PKgetPriority();
             walk=walk->next;
         }
         if(pr!=owner->PKgetPriority()) Scheduler::PKsetPriority(owner,pr);
@@ -252,9 +247,8 @@ bool Mutex::PKunlock(PauseKernelLock& dLock)
     if(waiting.empty()==false)
     {
         //There is at least another thread waiting
-        owner=waiting.front();
-        pop_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-        waiting.pop_back();
+        owner=waiting.front()->thread;
+        waiting.pop();
         if(owner->mutexWaiting!=this) errorHandler(UNEXPECTED);
         owner->mutexWaiting=nullptr;
         owner->PKwakeup();
@@ -264,12 +258,11 @@ bool Mutex::PKunlock(PauseKernelLock& dLock)
         owner->mutexLocked=this;
         //Handle priority inheritance of new owner
         if(waiting.empty()==false &&
-                owner->PKgetPriority().mutexLessOp(waiting.front()->PKgetPriority()))
-                Scheduler::PKsetPriority(owner,waiting.front()->PKgetPriority());
+                owner->PKgetPriority().mutexLessOp(waiting.front()->thread->PKgetPriority()))
+                Scheduler::PKsetPriority(owner,waiting.front()->thread->PKgetPriority());
         return p->PKgetPriority().mutexLessOp(owner->PKgetPriority());
     } else {
         owner=nullptr; //No threads waiting
-        std::vector<Thread *>().swap(waiting); //Save some RAM
         return false;
     }
 }
@@ -312,8 +305,8 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
         while(walk!=nullptr)
         {
             if(walk->waiting.empty()==false)
-                if(pr.mutexLessOp(walk->waiting.front()->PKgetPriority()))
-                    pr=walk->waiting.front()->PKgetPriority();
+                if(pr.mutexLessOp(walk->waiting.front()->thread->PKgetPriority()))
+                    pr=walk->waiting.front()->thread->PKgetPriority();
             walk=walk->next;
         }
         if(pr!=owner->PKgetPriority()) Scheduler::PKsetPriority(owner,pr);
@@ -323,9 +316,8 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
     if(waiting.empty()==false)
     {
         //There is at least another thread waiting
-        owner=waiting.front();
-        pop_heap(waiting.begin(),waiting.end(),PKlowerPriority);
-        waiting.pop_back();
+        owner=waiting.front()->thread;
+        waiting.pop();
         if(owner->mutexWaiting!=this) errorHandler(UNEXPECTED);
         owner->mutexWaiting=nullptr;
         owner->PKwakeup();
@@ -335,11 +327,10 @@ unsigned int Mutex::PKunlockAllDepthLevels(PauseKernelLock& dLock)
         owner->mutexLocked=this;
         //Handle priority inheritance of new owner
         if(waiting.empty()==false &&
-                owner->PKgetPriority().mutexLessOp(waiting.front()->PKgetPriority()))
-                Scheduler::PKsetPriority(owner,waiting.front()->PKgetPriority());
+                owner->PKgetPriority().mutexLessOp(waiting.front()->thread->PKgetPriority()))
+                Scheduler::PKsetPriority(owner,waiting.front()->thread->PKgetPriority());
     } else {
         owner=nullptr; //No threads waiting
-        std::vector<Thread *>().swap(waiting); //Save some RAM
     }
     
     if(recursiveDepth<0) return 0;
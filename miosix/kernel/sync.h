@@ -252,8 +252,8 @@ private:
     /// thread that owns this mutex. This field is necessary to make the list.
     Mutex *next;
 
-    /// Waiting thread are stored in this min-heap, sorted by priority
-    std::vector<Thread *> waiting;
+    /// Waiting thread are stored in this heap, sorted by priority
+    IntrusivePairingHeap<MutexWaitData> waiting;
 
     /// Used to hold nesting depth for recursive mutexes, -1 if not recursive
     int recursiveDepth;
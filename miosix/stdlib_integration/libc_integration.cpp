@@ -40,6 +40,8 @@
 #include "config/miosix_settings.h"
 //// Filesystem
 #include "filesystem/file_access.h"
+#include "filesystem/poll.h"
+#include "filesystem/pipe/pipe.h"
 //// Console
 #include "kernel/logging.h"
 //// kernel interface
@@ -1025,6 +1027,56 @@ int pipe(int fds[2])
     #endif //WITH_FILESYSTEM
 }
 
+ssize_t splice(int fdIn, off_t *offIn, int fdOut, off_t *offOut, size_t len,
+               unsigned int flags)
+{
+    #ifdef WITH_FILESYSTEM
+
+    if(offIn || offOut)
+    {
+        miosix::getReent()->_errno=EINVAL; //Offsets not supported
+        return -1;
+    }
+    ssize_t result=miosix::getFileDescriptorTable().splice(fdIn,fdOut,len);
+    if(result>=0) return result;
+    miosix::getReent()->_errno=-result;
+    return -1;
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=ENOSYS;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+int ppoll(struct pollfd *fds, nfds_t nfds, const struct timespec *timeout,
+          const sigset_t *sigmask)
+{
+    #ifdef WITH_FILESYSTEM
+
+    //sigmask is ignored, as there are no signals
+    long long t=-1;
+    if(timeout) t=static_cast<long long>(timeout->tv_sec)*1000000000LL
+                 +timeout->tv_nsec;
+    int result=miosix::getFileDescriptorTable().poll(fds,nfds,t);
+    if(result>=0) return result;
+    miosix::getReent()->_errno=-result;
+    return -1;
+
+    #else //WITH_FILESYSTEM
+    miosix::getReent()->_errno=ENOSYS;
+    return -1;
+    #endif //WITH_FILESYSTEM
+}
+
+int poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+    if(timeout<0) return ppoll(fds,nfds,nullptr,nullptr);
+    struct timespec t;
+    t.tv_sec=timeout/1000;
+    t.tv_nsec=(timeout%1000)*1000000;
+    return ppoll(fds,nfds,&t,nullptr);
+}
+
 /*
  * Time API in Miosix
  * ==================
@@ -30,6 +30,7 @@
 #include <unistd.h>
 #include <cxxabi.h>
 #include <thread>
+#include <new>
 //// Settings
 #include "config/miosix_settings.h"
 //// Console
@@ -48,6 +49,19 @@ using namespace std;
 #warning: TODO: FIX __gthread_key_t in libstdc++/include/std/memory_resource
 #endif
 
+#ifdef WITH_SMALL_OBJECT_HEAP
+static inline void *allocMemory(size_t size)
+{
+    return miosix::SmallObjectHeap::allocate(size);
+}
+
+static inline void freeMemory(void *p) { miosix::SmallObjectHeap::deallocate(p); }
+#else //WITH_SMALL_OBJECT_HEAP
+static inline void *allocMemory(size_t size) { return malloc(size); }
+
+static inline void freeMemory(void *p) { free(p); }
+#endif //WITH_SMALL_OBJECT_HEAP
+
 #ifdef __NO_EXCEPTIONS
 /*
  * If not using exceptions, ovverride the default new, delete with
@@ -55,32 +69,32 @@ using namespace std;
  */
 void *operator new(size_t size) noexcept
 {
-    return malloc(size);
+    return allocMemory(size);
 }
 
 void *operator new(size_t size, const std::nothrow_t&) noexcept
 {
-    return malloc(size);
+    return allocMemory(size);
 }
 
 void *operator new[](size_t size) noexcept
 {
-    return malloc(size);
+    return allocMemory(size);
 }
 
 void *operator new[](size_t size, const std::nothrow_t&) noexcept
 {
-    return malloc(size);
+    return allocMemory(size);
 }
 
 void operator delete(void *p) noexcept
 {
-    free(p);
+    freeMemory(p);
 }
 
 void operator delete[](void *p) noexcept
 {
-    free(p);
+    freeMemory(p);
 }
 
 /**
@@ -151,6 +165,55 @@ extern "C" void __cxa_throw_bad_array_new_length() { exit(1); }
 
 #endif //__NO_EXCEPTIONS
 
+#if defined(WITH_SMALL_OBJECT_HEAP) && !defined(__NO_EXCEPTIONS)
+/*
+ * Route C++ allocations through the small object heap
+ */
+void *operator new(size_t size)
+{
+    void *result=allocMemory(size);
+    if(result==nullptr) throw std::bad_alloc();
+    return result;
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return allocMemory(size);
+}
+
+void *operator new[](size_t size)
+{
+    void *result=allocMemory(size);
+    if(result==nullptr) throw std::bad_alloc();
+    return result;
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocMemory(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    freeMemory(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    freeMemory(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    freeMemory(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    freeMemory(p);
+}
+#endif //defined(WITH_SMALL_OBJECT_HEAP) && !defined(__NO_EXCEPTIONS)
+
 namespace miosix {
 
 class CppReentrancyAccessor
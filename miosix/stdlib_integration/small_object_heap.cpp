@@ -0,0 +1,261 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "small_object_heap.h"
+#include <cstdlib>
+#include "kernel/kernel.h"
+#include "kernel/sync.h"
+
+#ifdef WITH_SMALL_OBJECT_HEAP
+
+namespace miosix {
+
+static_assert(SMALL_OBJECT_HEAP_SIZE % 512==0,"");
+
+///Size of a span, the unit in which memory is assigned to a size class
+static const unsigned int spanSize=512;
+///Number of spans
+static const unsigned int numSpans=SMALL_OBJECT_HEAP_SIZE/spanSize;
+///Largest object served by the small object heap
+static const unsigned int maxSmallSize=256;
+///Objects moved from the shared free lists to a thread cache at once
+static const unsigned int batchSize=8;
+///Max number of objects in a thread cache per class, above this a thread
+///cache is trimmed down to cacheMax-batchSize
+static const unsigned int cacheMax=2*batchSize;
+
+///Object size of each class, all multiple of 8 to preserve alignment
+static const unsigned short classSize[SMALL_OBJECT_CLASSES]=
+{
+    8, 16, 24, 32, 48, 64, 96, 128, 192, 256
+};
+
+///Maps (size+7)/8 to the smallest class that can hold it
+static const unsigned char sizeToClass[maxSmallSize/8+1]=
+{
+    0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+    8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9
+};
+
+///Memory area of the small object heap
+static char __attribute__((aligned(8))) arena[SMALL_OBJECT_HEAP_SIZE];
+///For each span, the class it has been assigned to
+static unsigned char spanClass[numSpans];
+///Number of spans already assigned to a class
+static unsigned int usedSpans=0;
+///Shared free lists, one per class, guarded by heapMutex
+static void *sharedList[SMALL_OBJECT_CLASSES];
+///Length of shared free lists
+static unsigned int sharedCount[SMALL_OBJECT_CLASSES];
+///Number of spans assigned to each class
+static unsigned int classSpans[SMALL_OBJECT_CLASSES];
+///Guards the shared free lists and the span assignment
+static FastMutex heapMutex;
+///Objects freed while the kernel was paused, guarded by disabling interrupts
+static void *deferredList=nullptr;
+///Number of objects in deferredList, per class
+static unsigned int deferredCount[SMALL_OBJECT_CLASSES];
+
+/**
+ * Free objects are singly linked through their first word
+ */
+static inline void*& nextOf(void *p) { return *reinterpret_cast<void**>(p); }
+
+/**
+ * \param p a pointer to memory in the arena
+ * \return the class of the object
+ */
+static inline unsigned int classOf(void *p)
+{
+    return spanClass[(reinterpret_cast<char*>(p)-arena)/spanSize];
+}
+
+/**
+ * \param p a pointer
+ * \return true if the pointer is within the small object heap
+ */
+static inline bool inArena(void *p)
+{
+    return p>=arena && p<arena+SMALL_OBJECT_HEAP_SIZE;
+}
+
+/**
+ * Move the objects freed while the kernel was paused to the shared free lists.
+ * Must be called with heapMutex locked
+ */
+static void drainDeferred()
+{
+    void *list;
+    {
+        FastInterruptDisableLock dLock;
+        list=deferredList;
+        deferredList=nullptr;
+        for(unsigned int i=0;i<SMALL_OBJECT_CLASSES;i++) deferredCount[i]=0;
+    }
+    while(list)
+    {
+        void *p=list;
+        list=nextOf(p);
+        unsigned int c=classOf(p);
+        nextOf(p)=sharedList[c];
+        sharedList[c]=p;
+        sharedCount[c]++;
+    }
+}
+
+/**
+ * \internal
+ * Needs to access the private members of SmallObjectHeapCache and Thread
+ */
+class SmallObjectHeapAccessor
+{
+public:
+    static SmallObjectHeapCache& currentCache()
+    {
+        return Thread::getCurrentThread()->heapCache;
+    }
+};
+
+void *SmallObjectHeap::allocate(unsigned int size)
+{
+    if(size>maxSmallSize || isKernelRunning()==false) return malloc(size);
+    unsigned int c=sizeToClass[(size+7)/8];
+    SmallObjectHeapCache& cache=SmallObjectHeapAccessor::currentCache();
+    if(cache.freeList[c]==nullptr)
+    {
+        Lock<FastMutex> l(heapMutex);
+        if(refill(cache,c)==false) return malloc(size);
+    }
+    void *result=cache.freeList[c];
+    cache.freeList[c]=nextOf(result);
+    cache.count[c]--;
+    return result;
+}
+
+void SmallObjectHeap::deallocate(void *ptr)
+{
+    if(inArena(ptr)==false)
+    {
+        free(ptr);
+        return;
+    }
+    unsigned int c=classOf(ptr);
+    if(isKernelRunning()==false)
+    {
+        FastInterruptDisableLock dLock;
+        nextOf(ptr)=deferredList;
+        deferredList=ptr;
+        deferredCount[c]++;
+        return;
+    }
+    SmallObjectHeapCache& cache=SmallObjectHeapAccessor::currentCache();
+    nextOf(ptr)=cache.freeList[c];
+    cache.freeList[c]=ptr;
+    if(++cache.count[c]<=cacheMax) return;
+    //Cache full, give a batch back
+    Lock<FastMutex> l(heapMutex);
+    for(unsigned int i=0;i<batchSize;i++)
+    {
+        void *p=cache.freeList[c];
+        cache.freeList[c]=nextOf(p);
+        nextOf(p)=sharedList[c];
+        sharedList[c]=p;
+    }
+    cache.count[c]-=batchSize;
+    sharedCount[c]+=batchSize;
+}
+
+void SmallObjectHeap::flushCurrentThreadCache()
+{
+    SmallObjectHeapCache& cache=SmallObjectHeapAccessor::currentCache();
+    Lock<FastMutex> l(heapMutex);
+    for(unsigned int c=0;c<SMALL_OBJECT_CLASSES;c++)
+    {
+        while(cache.freeList[c])
+        {
+            void *p=cache.freeList[c];
+            cache.freeList[c]=nextOf(p);
+            nextOf(p)=sharedList[c];
+            sharedList[c]=p;
+        }
+        sharedCount[c]+=cache.count[c];
+        cache.count[c]=0;
+    }
+}
+
+SmallObjectClassStats SmallObjectHeap::getStats(unsigned int sizeClass)
+{
+    SmallObjectClassStats result;
+    if(sizeClass>=SMALL_OBJECT_CLASSES)
+    {
+        result.size=result.capacity=result.free=result.held=0;
+        return result;
+    }
+    Lock<FastMutex> l(heapMutex);
+    FastInterruptDisableLock dLock;
+    result.size=classSize[sizeClass];
+    result.capacity=classSpans[sizeClass]*(spanSize/classSize[sizeClass]);
+    result.free=sharedCount[sizeClass]+deferredCount[sizeClass];
+    result.held=result.capacity-result.free;
+    return result;
+}
+
+bool SmallObjectHeap::refill(SmallObjectHeapCache& cache, unsigned int c)
+{
+    if(sharedList[c]==nullptr) drainDeferred();
+    if(sharedList[c]==nullptr)
+    {
+        //Assign a new span to the class
+        if(usedSpans>=numSpans) return false;
+        unsigned int span=usedSpans++;
+        spanClass[span]=c;
+        classSpans[c]++;
+        char *base=arena+span*spanSize;
+        unsigned int n=spanSize/classSize[c];
+        for(unsigned int i=0;i<n;i++)
+        {
+            void *p=base+i*classSize[c];
+            nextOf(p)=sharedList[c];
+            sharedList[c]=p;
+        }
+        sharedCount[c]+=n;
+    }
+    for(unsigned int i=0;i<batchSize && sharedList[c];i++)
+    {
+        void *p=sharedList[c];
+        sharedList[c]=nextOf(p);
+        nextOf(p)=cache.freeList[c];
+        cache.freeList[c]=p;
+        cache.count[c]++;
+        sharedCount[c]--;
+    }
+    return true;
+}
+
+} //namespace miosix
+
+#endif //WITH_SMALL_OBJECT_HEAP
@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#pragma once
+
+#include "config/miosix_settings.h"
+
+#ifdef WITH_SMALL_OBJECT_HEAP
+
+namespace miosix {
+
+/**
+ * \internal
+ * Number of size classes of the small object heap, see SmallObjectHeap
+ */
+const unsigned int SMALL_OBJECT_CLASSES=10;
+
+/**
+ * \internal
+ * Per-thread cache of free objects of the small object heap. An instance is
+ * embedded in every thread, and it is only accessed by the thread itself, so
+ * allocations that hit the cache need no locking at all.
+ */
+class SmallObjectHeapCache
+{
+public:
+    SmallObjectHeapCache()
+    {
+        for(unsigned int i=0;i<SMALL_OBJECT_CLASSES;i++)
+        {
+            freeList[i]=nullptr;
+            count[i]=0;
+        }
+    }
+
+private:
+    SmallObjectHeapCache(const SmallObjectHeapCache&)=delete;
+    SmallObjectHeapCache& operator=(const SmallObjectHeapCache&)=delete;
+
+    void *freeList[SMALL_OBJECT_CLASSES];      ///< Free objects, one list per class
+    unsigned char count[SMALL_OBJECT_CLASSES]; ///< Length of each list
+
+    friend class SmallObjectHeap;
+};
+
+/**
+ * Usage statistics of a size class of the small object heap
+ */
+struct SmallObjectClassStats
+{
+    unsigned int size;     ///< Object size of this class
+    unsigned int capacity; ///< Objects in the spans assigned to this class
+    unsigned int free;     ///< Objects in the shared free list
+    unsigned int held;     ///< Objects held by threads, in use or cached
+};
+
+/**
+ * Heap for small C++ objects, enabled by WITH_SMALL_OBJECT_HEAP in
+ * miosix_settings.h.
+ *
+ * Objects up to 256 bytes are rounded up to one of SMALL_OBJECT_CLASSES size
+ * classes, and served from a dedicated memory area divided in 512 byte spans,
+ * each assigned to a single class when first needed. Each thread keeps a small
+ * cache of free objects per class, so most allocations and deallocations touch
+ * no shared state. Caches are refilled and trimmed in batches from shared free
+ * lists protected by a FastMutex, which only blocks threads that are actually
+ * allocating at the same time, instead of pausing the kernel like malloc.
+ *
+ * Allocations that don't fit are forwarded to malloc, as are allocations done
+ * while the kernel is paused or not started, as it would not be possible to
+ * lock the mutex. For the same reason, objects freed while the kernel is
+ * paused are put in a list protected by disabling interrupts, and returned to
+ * the shared free lists at the next refill.
+ */
+class SmallObjectHeap
+{
+public:
+    /**
+     * Allocate memory
+     * \param size size of the requested memory
+     * \return the allocated memory, or nullptr if out of memory
+     */
+    static void *allocate(unsigned int size);
+
+    /**
+     * Deallocate memory allocated with allocate()
+     * \param ptr pointer to deallocate, can be nullptr
+     */
+    static void deallocate(void *ptr);
+
+    /**
+     * Return the objects cached by the calling thread to the shared free
+     * lists. Called when a thread terminates.
+     */
+    static void flushCurrentThreadCache();
+
+    /**
+     * \param sizeClass a size class, from 0 to SMALL_OBJECT_CLASSES-1
+     * \return usage statistics of the size class
+     */
+    static SmallObjectClassStats getStats(unsigned int sizeClass);
+
+private:
+    SmallObjectHeap()=delete;
+
+    /**
+     * Refill a thread cache with a batch of objects. Must be called with the
+     * heap mutex locked
+     * \param cache thread cache
+     * \param c size class
+     * \return false if the small object heap has no memory left for the class
+     */
+    static bool refill(SmallObjectHeapCache& cache, unsigned int c);
+};
+
+} //namespace miosix
+
+#endif //WITH_SMALL_OBJECT_HEAP
@@ -65,6 +65,16 @@ void MemoryProfiling::print()
             curFreeStack,absFreeStack,
             heapSize,heapSize-curFreeHeap,heapSize-absFreeHeap,
             curFreeHeap,absFreeHeap);
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    iprintf("Small object heap statistics.\n"
+            "Size: %u\n"
+            "Class Capacity Free Held\n",SMALL_OBJECT_HEAP_SIZE);
+    for(unsigned int i=0;i<SMALL_OBJECT_CLASSES;i++)
+    {
+        SmallObjectClassStats s=getSmallObjectStats(i);
+        iprintf("%5u %8u %4u %4u\n",s.size,s.capacity,s.free,s.held);
+    }
+    #endif //WITH_SMALL_OBJECT_HEAP
 }
 
 unsigned int MemoryProfiling::getStackSize()
@@ -131,6 +141,13 @@ unsigned int MemoryProfiling::getCurrentFreeHeap()
     return getHeapSize()-mallocData.uordblks;
 }
 
+#ifdef WITH_SMALL_OBJECT_HEAP
+SmallObjectClassStats MemoryProfiling::getSmallObjectStats(unsigned int sizeClass)
+{
+    return SmallObjectHeap::getStats(sizeClass);
+}
+#endif //WITH_SMALL_OBJECT_HEAP
+
 /**
  * \internal
  * used by memDump
@@ -34,6 +34,7 @@
 #define UTIL_H
 
 #include "kernel/cpu_time_counter.h"
+#include "stdlib_integration/small_object_heap.h"
 #include <vector>
 
 namespace miosix {
@@ -99,6 +100,16 @@ public:
      */
     static unsigned int getCurrentFreeHeap();
 
+    #ifdef WITH_SMALL_OBJECT_HEAP
+    /**
+     * \param sizeClass a size class of the small object heap, from 0 to
+     * SMALL_OBJECT_CLASSES-1
+     * \return usage of the size class. The small object heap is a separate
+     * memory area, so it is not accounted in the heap functions above.
+     */
+    static SmallObjectClassStats getSmallObjectStats(unsigned int sizeClass);
+    #endif //WITH_SMALL_OBJECT_HEAP
+
 private:
     //All member functions static, disallow creating instances
     MemoryProfiling();
@@ -196,14 +196,25 @@ void DisplayErOledm024::doSetBrightness(int brt)
 
 void DisplayErOledm024::update()
 {
-    cmd(0x21); cmd(0); cmd(127);
-    cmd(0x22); cmd(0); cmd(7);
-    dc::high();
-    cs::low();
-    for(int i=0;i<fbSize;i++) spi1sendOnly(backbuffer[i]);
-    spi1waitCompletion();
-    cs::high();
-    delayUs(1);
+    //Every byte is a column of 8 pixels of a page, so send whole pages
+    for(int i=0;i<dirty.size();i++)
+    {
+        short x1=dirty[i].p1.x(), x2=dirty[i].p2.x();
+        short page1=dirty[i].p1.y()/8, page2=dirty[i].p2.y()/8;
+        cmd(0x21); cmd(x1); cmd(x2);
+        cmd(0x22); cmd(page1); cmd(page2);
+        dc::high();
+        cs::low();
+        for(short page=page1;page<=page2;page++)
+        {
+            const unsigned char *row=backbuffer+page*width;
+            for(short x=x1;x<=x2;x++) spi1sendOnly(row[x]);
+        }
+        spi1waitCompletion();
+        cs::high();
+        delayUs(1);
+    }
+    dirty.clear();
 }
 
 } //namespace mxgui
@@ -183,21 +183,29 @@ void DisplayErOledm028::doSetBrightness(int brt)
 
 void DisplayErOledm028::update()
 {
-    static const unsigned char xStart=28;
-    static const unsigned char xEnd=91;
-    static const unsigned char yStart=0;
-    static const unsigned char yEnd=63;
-    
-    cmd(0x15); data(xStart); data(xEnd);
-    cmd(0x75); data(yStart); data(yEnd);
-    cmd(0x5c);
+    static const unsigned char xStart=28; //Column of the leftmost pixels
 
-    dc::high();
-    cs::low();
-    for(int i=0;i<fbSize;i++) spi3sendOnly(backbuffer[i]);
-    spi3waitCompletion();
-    cs::high();
-    delayUs(1);
+    //Columns are 4 pixels, that is 2 bytes, wide, so send whole columns
+    for(int i=0;i<dirty.size();i++)
+    {
+        short column1=dirty[i].p1.x()/4, column2=dirty[i].p2.x()/4;
+        short y1=dirty[i].p1.y(), y2=dirty[i].p2.y();
+        cmd(0x15); data(xStart+column1); data(xStart+column2);
+        cmd(0x75); data(y1); data(y2);
+        cmd(0x5c);
+
+        dc::high();
+        cs::low();
+        for(short y=y1;y<=y2;y++)
+        {
+            const unsigned char *row=backbuffer+y*width/2;
+            for(short x=2*column1;x<2*column2+2;x++) spi3sendOnly(row[x]);
+        }
+        spi3waitCompletion();
+        cs::high();
+        delayUs(1);
+    }
+    dirty.clear();
 }
 
 } //namespace mxgui
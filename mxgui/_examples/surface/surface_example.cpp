@@ -0,0 +1,51 @@
+
+#include <entry.h>
+#include <display.h>
+#include <surface.h>
+#include <level2/simple_plot.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+using namespace mxgui;
+
+/*
+ * Like the plot example, but the plot and a label are drawn off-screen and
+ * then copied to the display with a single blit, so that the display never
+ * shows a partially drawn plot. The surface needs 2 bytes per pixel of RAM.
+ */
+
+ENTRY()
+{
+    int i=0;
+    vector<float> data1;
+    vector<float> data2;
+
+    vector<Dataset> dataset;
+    dataset.push_back(Dataset(data1,red));
+    dataset.push_back(Dataset(data2,green));
+
+    Display& display=DisplayManager::instance().getDisplay();
+    Surface surface(200,120);
+    SimplePlot plot(Point(0,0),Point(199,99));
+
+    for(;;i+=2)
+    {
+        {
+            DrawingContext sdc(surface);
+            plot.draw(sdc,dataset);
+            char text[32];
+            snprintf(text,sizeof(text),"Samples: %d",i/2);
+            sdc.clear(Point(0,100),Point(199,119),black);
+            sdc.write(Point(0,104),text);
+        }
+        {
+            DrawingContext dc(display);
+            surface.blit(dc,Point(20,40));
+        }
+        data1.push_back(20*(1+0.05*i)*sin(0.1*i));
+        data2.push_back(20*(1+0.05*i));
+        usleep(100000);
+    }
+}
@@ -0,0 +1,96 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Losslessly re-encodes a jpeg image adding restart markers, so that
+ * JpegImage can start decoding from the restart interval closest to the
+ * requested scanline, instead of from the beginning of the image. The DCT
+ * coefficients are copied as they are, so the image does not change.
+ * Progressive images are converted to baseline, that JpegImage supports.
+ */
+
+#include <cstdio>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <boost/program_options.hpp>
+#include <jpeglib.h>
+
+using namespace std;
+using namespace boost::program_options;
+
+int main(int argc, char *argv[])
+{
+    //Check args
+    options_description desc("JpegRestart utility v1.00\n"
+        "Designed by TFT : Terraneo Federico Technologies\nOptions");
+    desc.add_options()
+        ("help", "Prints this.")
+        ("in", value<string>(), "Input jpeg file (required)")
+        ("out", value<string>(), "Output jpeg file (required)")
+        ("rows", value<int>()->default_value(1),
+            "Restart interval in rows of MCUs, smaller is faster to seek but"
+            " makes the file larger")
+    ;
+
+    variables_map vm;
+    store(parse_command_line(argc,argv,desc),vm);
+    notify(vm);
+
+    if(vm.count("help") || (!vm.count("in")) || (!vm.count("out")))
+    {
+        cerr<<desc<<endl;
+        return 1;
+    }
+    int rows=vm["rows"].as<int>();
+    if(rows<1 || rows>65535) throw runtime_error("Invalid restart interval");
+
+    FILE *in=fopen(vm["in"].as<string>().c_str(),"rb");
+    if(in==NULL) throw runtime_error("Can't open input file");
+    jpeg_decompress_struct src;
+    jpeg_error_mgr srcErr;
+    src.err=jpeg_std_error(&srcErr);
+    jpeg_create_decompress(&src);
+    jpeg_stdio_src(&src,in);
+    jpeg_read_header(&src,TRUE);
+    jvirt_barray_ptr *coefficients=jpeg_read_coefficients(&src);
+
+    FILE *out=fopen(vm["out"].as<string>().c_str(),"wb");
+    if(out==NULL) throw runtime_error("Can't open output file");
+    jpeg_compress_struct dst;
+    jpeg_error_mgr dstErr;
+    dst.err=jpeg_std_error(&dstErr);
+    jpeg_create_compress(&dst);
+    jpeg_stdio_dest(&dst,out);
+    jpeg_copy_critical_parameters(&src,&dst);
+    dst.restart_in_rows=rows;
+    //Optimized Huffman tables partly compensate for the size of the markers
+    dst.optimize_coding=TRUE;
+    jpeg_write_coefficients(&dst,coefficients);
+
+    jpeg_finish_compress(&dst);
+    jpeg_destroy_compress(&dst);
+    jpeg_finish_decompress(&src);
+    jpeg_destroy_decompress(&src);
+    fclose(out);
+    fclose(in);
+
+    cout<<"Image size "<<src.image_width<<"x"<<src.image_height
+        <<", restart interval "<<rows<<" rows of MCUs"<<endl;
+    return 0;
+}
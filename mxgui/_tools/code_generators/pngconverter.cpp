@@ -217,6 +217,85 @@ void ImageWriter16bit::writePixel(int x, int y, ofstream& out,
     if(outImage) outImage->set_pixel(x,y,rgb_pixel(r,g,b));
 }
 
+//
+// class  ImageWriter16bitRle
+//
+
+void ImageWriter16bitRle::write(ofstream& out, image<rgb_pixel> *outImage)
+{
+    //The header written by the caller is followed by a padding short and by
+    //the offset of every line, then by the compressed lines
+    vector<vector<unsigned short>> lines;
+    for(int y=0;y<img.get_height();y++)
+    {
+        vector<unsigned short> line;
+        for(int x=0;x<img.get_width();x++)
+        {
+            rgb_pixel pix=img.get_pixel(x,y);
+            unsigned int r=(pix.red & (31<<3))>>3;
+            unsigned int g=(pix.green & (63<<2))>>2;
+            unsigned int b=(pix.blue & (31<<3))>>3;
+            line.push_back(r<<(5+6) | g<<5 | b);
+            if(outImage) outImage->set_pixel(x,y,rgb_pixel(r,g,b));
+        }
+        lines.push_back(compressLine(line));
+    }
+    unsigned short padding=0;
+    out.write(reinterpret_cast<char*>(&padding),2);
+    unsigned int offset=4*sizeof(unsigned short)+4*lines.size();
+    for(auto& line : lines)
+    {
+        //Little endian
+        char o[4]={char(offset),char(offset>>8),char(offset>>16),char(offset>>24)};
+        out.write(o,4);
+        offset+=2*line.size();
+    }
+    for(auto& line : lines)
+    {
+        for(unsigned short s : line)
+        {
+            s=toLittleEndian(s);
+            out.write(reinterpret_cast<char*>(&s),2);
+        }
+    }
+}
+
+vector<unsigned short> ImageWriter16bitRle::compressLine(
+        const vector<unsigned short>& line)
+{
+    //Runs are at most 32768 pixels. Runs of three or more equal pixels are
+    //repeated, shorter ones are cheaper as part of a run of pixels to copy
+    const int maxRun=0x8000;
+    vector<unsigned short> result;
+    int literalStart=-1; //Start of the run of pixels to copy, if any
+    auto flushLiteral=[&](int end)
+    {
+        if(literalStart<0) return;
+        result.push_back(end-literalStart-1);
+        result.insert(result.end(),line.begin()+literalStart,line.begin()+end);
+        literalStart=-1;
+    };
+    int n=line.size();
+    for(int i=0;i<n;)
+    {
+        int run=1;
+        while(i+run<n && run<maxRun && line[i+run]==line[i]) run++;
+        if(run>=3)
+        {
+            flushLiteral(i);
+            result.push_back(0x8000 | (run-1));
+            result.push_back(line[i]);
+            i+=run;
+        } else {
+            if(literalStart<0) literalStart=i;
+            i++;
+            if(i-literalStart==maxRun) flushLiteral(i);
+        }
+    }
+    flushLiteral(n);
+    return result;
+}
+
 //
 // class  ImageWriter18bit
 //
@@ -249,7 +328,7 @@ void ImageWriter24bit::writePixel(int x, int y, ofstream& out,
 int main(int argc, char *argv[])
 {
     //Check args
-    options_description desc("PngConverter utility v1.22\n"
+    options_description desc("PngConverter utility v1.23\n"
         "Designed by TFT : Terraneo Federico Technologies\nOptions");
     desc.add_options()
         ("help", "Prints this.")
@@ -258,6 +337,10 @@ int main(int argc, char *argv[])
         ("out", value<string>(), "Output png file for validation")
         ("outdir", value<string>(), "Directory where to generate files (default is src dir)")
         ("binary", "Generate a binary file instead of a .cpp/.h file")
+        ("file", value<string>(), "Name of the binary file (default is the "
+            "input file name without extension)")
+        ("rle", "Compress a 16 bit binary file with run length encoding,"
+            " that saves space but prevents drawing it in place from RomFs")
     ;
 
     variables_map vm;
@@ -329,9 +412,15 @@ int main(int argc, char *argv[])
 
     //Convert image, step 1 (make .cpp file)
     const bool binary=vm.count("binary");
-    ofstream file(binary ? filename.c_str() : cppFilename.c_str(),ios::binary);
+    const bool rle=vm.count("rle");
+    if(rle && (binary==false || pixDepth!=_16))
+        throw runtime_error("Run length encoding requires --binary and 16 bits");
+    if(rle) pixDepthInt|=0x100;
+    string binFilename=vm.count("file") ? vm["file"].as<string>() : filename;
+    ofstream file(binary ? binFilename.c_str() : cppFilename.c_str(),ios::binary);
     if(!file.good())
-        throw(runtime_error(string("Can't open file: ")+cppFilename));
+        throw(runtime_error(string("Can't open file: ")+
+            (binary ? binFilename : cppFilename)));
 
     bool outRequested=false;
     image<rgb_pixel> outImage;
@@ -362,7 +451,9 @@ int main(int argc, char *argv[])
         file.write(reinterpret_cast<char*>(&header),sizeof(header));
     }
 
-    shared_ptr<ImageWriter> imgw=ImageWriter::fromPixDepth(img,binary,pixDepth);
+    shared_ptr<ImageWriter> imgw;
+    if(rle) imgw=make_shared<ImageWriter16bitRle>(img);
+    else imgw=ImageWriter::fromPixDepth(img,binary,pixDepth);
     imgw->write(file, outRequested ? &outImage : 0);
 
     if(!binary)
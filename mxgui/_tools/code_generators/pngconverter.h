@@ -5,6 +5,7 @@
 #include <string>
 #include <ostream>
 #include <memory>
+#include <vector>
 #include "libs/png++/png.hpp"
 
 /**
@@ -180,6 +181,37 @@ protected:
             png::image<png::rgb_pixel> *outImage, png::rgb_pixel pix);
 };
 
+/**
+ * Class to produce 16 bit per pixel binary images compressed with run length
+ * encoding, in the format read by mxgui's RawImage
+ */
+class ImageWriter16bitRle : public ImageWriter16bit
+{
+public:
+    /**
+     * Constructor
+     * \param img source image
+     */
+    ImageWriter16bitRle(png::image<png::rgb_pixel>& img)
+            : ImageWriter16bit(img, true) {}
+
+    /**
+     * Lines are compressed one at a time, and preceded by a table with the
+     * offset of each of them, so this format has a different writing algorithm
+     */
+    virtual void write(std::ofstream& out,
+            png::image<png::rgb_pixel> *outImage=0);
+
+private:
+    /**
+     * Compress a line
+     * \param line pixels of the line
+     * \return the compressed line
+     */
+    static std::vector<unsigned short> compressLine(
+            const std::vector<unsigned short>& line);
+};
+
 /**
  * Class to produce 18 bit per pixel images
  */
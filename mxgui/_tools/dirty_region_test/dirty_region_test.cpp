@@ -0,0 +1,280 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host test of the dirty region tracking of the framebuffer display drivers.
+ * Random drawing operations are done on DisplayGeneric1BPP and
+ * DisplayGeneric4BPP, whose update() copies only the dirty region to an
+ * emulated display memory with the same granularity as the real display
+ * controllers, and the display memory must always match the backbuffer.
+ * Also prints the bytes sent to redraw a small label, versus the whole screen.
+ * Usage: dirty_region_test
+ * Returns 0 if all tests pass.
+ */
+
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include "display_generic_1bpp.h"
+#include "display_generic_4bpp.h"
+
+using namespace std;
+using namespace mxgui;
+
+namespace mxgui {
+void registerDisplayHook(DisplayManager& dm) {}
+} //namespace mxgui
+
+/**
+ * 1 bit per pixel display, whose memory is organized in pages of 8 rows like
+ * the SSD1306
+ */
+class Display1BPP : public DisplayGeneric1BPP
+{
+public:
+    Display1BPP() : DisplayGeneric1BPP(128,64), memory(fbSize,0), sent(0) {}
+
+    void doTurnOn() override {}
+    void doTurnOff() override {}
+    void doSetBrightness(int brt) override {}
+
+    void update() override
+    {
+        for(int i=0;i<dirty.size();i++)
+        {
+            short x1=dirty[i].p1.x(), x2=dirty[i].p2.x();
+            for(short page=dirty[i].p1.y()/8;page<=dirty[i].p2.y()/8;page++)
+                for(short x=x1;x<=x2;x++)
+                {
+                    memory[page*width+x]=backbuffer[page*width+x];
+                    sent++;
+                }
+        }
+        dirty.clear();
+    }
+
+    bool check() const
+    {
+        return memcmp(memory.data(),backbuffer,fbSize)==0 && dirty.empty();
+    }
+
+    int dirtyRects() const { return dirty.size(); }
+
+    vector<unsigned char> memory;
+    int sent; ///< Bytes sent to the display memory
+};
+
+/**
+ * 4 bit per pixel display, whose memory is organized in columns of 4 pixels
+ * like the SSD1322
+ */
+class Display4BPP : public DisplayGeneric4BPP
+{
+public:
+    Display4BPP() : DisplayGeneric4BPP(256,64), memory(fbSize,0), sent(0) {}
+
+    void doTurnOn() override {}
+    void doTurnOff() override {}
+    void doSetBrightness(int brt) override {}
+
+    void update() override
+    {
+        for(int i=0;i<dirty.size();i++)
+        {
+            short column1=dirty[i].p1.x()/4, column2=dirty[i].p2.x()/4;
+            for(short y=dirty[i].p1.y();y<=dirty[i].p2.y();y++)
+                for(short x=2*column1;x<2*column2+2;x++)
+                {
+                    memory[y*width/2+x]=backbuffer[y*width/2+x];
+                    sent++;
+                }
+        }
+        dirty.clear();
+    }
+
+    bool check() const
+    {
+        return memcmp(memory.data(),backbuffer,fbSize)==0 && dirty.empty();
+    }
+
+    int dirtyRects() const { return dirty.size(); }
+
+    vector<unsigned char> memory;
+    int sent; ///< Bytes sent to the display memory
+};
+
+static bool pass=true;
+
+/**
+ * Report the result of a test
+ */
+static void check(const char *name, bool result)
+{
+    cout<<name<<": "<<(result ? "PASS" : "FAIL")<<endl;
+    pass&=result;
+}
+
+static unsigned int seed=1;
+
+/**
+ * \return a pseudorandom number from 0 to n-1
+ */
+static int random(int n)
+{
+    seed=seed*1103515245+12345;
+    return (seed>>16)%n;
+}
+
+/**
+ * Draw randomly on a display, checking after every update() that the display
+ * memory matches the backbuffer
+ */
+template<typename D>
+static bool randomDrawing(D& display)
+{
+    const short w=display.getWidth(), h=display.getHeight();
+    display.clear(0);
+    display.update();
+    bool ok=display.check();
+    for(int i=0;i<2000;i++)
+    {
+        Point a(random(w),random(h)), b(random(w),random(h));
+        Point p1(min(a.x(),b.x()),min(a.y(),b.y()));
+        Point p2(max(a.x(),b.x()),max(a.y(),b.y()));
+        Color c=random(16);
+        switch(random(7))
+        {
+            case 0: display.clear(p1,Point(p1.x()+random(8),p1.y()+random(8)),c);
+                break;
+            case 1: display.beginPixel(); display.setPixel(a,c); break;
+            case 2: display.line(a,b,c); break;
+            case 3: display.line(a,Point(b.x(),a.y()),c); break;
+            case 4: display.line(a,Point(a.x(),b.y()),c); break;
+            case 5: display.write(a,"Hello"); break;
+            case 6:
+            {
+                Color *line=display.getScanLineBuffer();
+                short length=random(w-a.x())+1;
+                for(short x=0;x<length;x++) line[x]=random(16);
+                display.scanLineBuffer(a,length);
+                break;
+            }
+        }
+        ok&=display.dirtyRects()<=DirtyRegion::maxRects;
+        if(random(4)==0)
+        {
+            display.update();
+            ok&=display.check();
+        }
+    }
+    display.update();
+    return ok && display.check();
+}
+
+/**
+ * \return the bytes sent to update a small label on a display
+ */
+template<typename D>
+static int labelUpdate(D& display)
+{
+    display.clear(0);
+    display.write(Point(0,0),"Temperature");
+    display.update();
+    display.sent=0;
+    display.clear(Point(80,20),Point(99,31),0);
+    display.write(Point(80,20),"42");
+    display.update();
+    return display.check() ? display.sent : -1;
+}
+
+/**
+ * Check that all the pixels added to a region are in one of its rectangles
+ */
+static bool regionCoversPixels()
+{
+    const int w=64, h=64;
+    bool ok=true;
+    for(int iteration=0;iteration<200;iteration++)
+    {
+        DirtyRegion region;
+        vector<bool> added(w*h,false);
+        int n=random(10)+1;
+        for(int i=0;i<n;i++)
+        {
+            short x=random(w), y=random(h);
+            short x2=min(w-1,x+random(16)), y2=min(h-1,y+random(16));
+            if(random(3)==0) { x2=x; y2=y; }
+            region.add(Point(x,y),Point(x2,y2));
+            for(int yy=y;yy<=y2;yy++)
+                for(int xx=x;xx<=x2;xx++) added[yy*w+xx]=true;
+        }
+        ok&=region.size()>0 && region.size()<=DirtyRegion::maxRects;
+        for(int y=0;y<h;y++)
+            for(int x=0;x<w;x++)
+            {
+                if(added[y*w+x]==false) continue;
+                bool covered=false;
+                for(int i=0;i<region.size();i++)
+                {
+                    const DirtyRegion::Rect& r=region[i];
+                    covered|=x>=r.p1.x() && x<=r.p2.x()
+                          && y>=r.p1.y() && y<=r.p2.y();
+                }
+                ok&=covered;
+            }
+    }
+    //Rectangles that cost nothing to merge are merged
+    DirtyRegion region;
+    for(short y=10;y<20;y++) region.add(Point(5,y),Point(30,y));
+    region.add(Point(8,12),Point(9,13));
+    ok&=region.size()==1 && region.area()==26*10;
+    region.add(Point(50,50));
+    ok&=region.size()==2;
+    region.clear();
+    ok&=region.empty();
+    return ok;
+}
+
+int main()
+{
+    check("region covers pixels",regionCoversPixels());
+    Display1BPP display1;
+    check("1bpp random drawing",randomDrawing(display1));
+    Display4BPP display4;
+    check("4bpp random drawing",randomDrawing(display4));
+
+    int sent1=labelUpdate(display1);
+    int sent4=labelUpdate(display4);
+    cout<<"Label update: 1bpp "<<sent1<<" bytes instead of "
+        <<display1.memory.size()<<", 4bpp "<<sent4<<" bytes instead of "
+        <<display4.memory.size()<<endl;
+    check("label update",sent1>0 && sent4>0
+        && sent1*10<static_cast<int>(display1.memory.size())
+        && sent4*10<static_cast<int>(display4.memory.size()));
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,360 @@
+/***************************************************************************
+ *   Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016 by Terraneo Federico *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host test of text drawing. Strings are written on a surface with all the
+ * kinds of font, clipped and not clipped, and compared with a reference
+ * rendered one pixel at a time from the font data. The time to draw the
+ * strings of the benchmark example is also reported, compared with writing
+ * them one pixel at a time through a pixel iterator, together with the
+ * number of transfers a display on a bus would see.
+ * Usage: font_test
+ * Returns 0 if all tests pass.
+ */
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include "surface.h"
+#include "misc_inst.h"
+
+using namespace std;
+using namespace mxgui;
+
+namespace mxgui {
+void registerDisplayHook(DisplayManager& dm) {}
+} //namespace mxgui
+
+static bool pass=true;
+
+/**
+ * Report the result of a test
+ */
+static void check(const string& name, bool result)
+{
+    cout<<name<<": "<<(result ? "PASS" : "FAIL")<<endl;
+    pass&=result;
+}
+
+/**
+ * Read one pixel of a glyph from the font data
+ * \return the value of pixel y of column i of glyph c, 0 to 3 for
+ * antialiased fonts, 0 or 1 otherwise
+ */
+static int glyphPixel(const Font& f, unsigned char c, int i, int y)
+{
+    int index= f.isFixedWidth() ? c*f.getWidth()+i : f.getOffset()[c]+i;
+    unsigned long long column;
+    if(f.getDataSize()==16)
+        column=reinterpret_cast<const unsigned short*>(f.getData())[index];
+    else if(f.getDataSize()==32)
+        column=reinterpret_cast<const unsigned int*>(f.getData())[index];
+    else column=reinterpret_cast<const unsigned long long*>(f.getData())[index];
+    if(f.isAntialiased()) return (column>>(2*y)) & 3;
+    return (column>>y) & 1 ? 3 : 0;
+}
+
+/**
+ * Draw a string one pixel at a time from the font data, only within the
+ * clipping rectangle a,b
+ */
+static void reference(vector<Color>& pixels, short width, const Font& f,
+        Point p, Point a, Point b, const char *s, const Color colors[4])
+{
+    short x=p.x();
+    for(;*s;s++)
+    {
+        unsigned char c=*s;
+        if(c<f.getStartChar() || c>f.getEndChar()) c=0;
+        else c-=f.getStartChar();
+        int w= f.isFixedWidth() ? f.getWidth() : f.getWidths()[c];
+        for(int i=0;i<w;i++,x++)
+            for(int y=0;y<f.getHeight();y++)
+            {
+                if(x<a.x() || x>b.x() || p.y()+y<a.y() || p.y()+y>b.y())
+                    continue;
+                pixels[x+(p.y()+y)*width]=colors[glyphPixel(f,c,i,y)];
+            }
+    }
+}
+
+/**
+ * Draw a string on a surface and on a reference, and compare them
+ * \param clipped if true draw the string with clippedWrite within a,b
+ * \return true if they are equal
+ */
+static bool compare(const Font& f, Point p, const char *s, bool clipped,
+        Point a, Point b, short width)
+{
+    const short height=48;
+    Color colors[4];
+    Font::generatePalette(colors,0xf800,0x001f);
+    Surface surface(width,height);
+    surface.clear(black);
+    {
+        DrawingContext dc(surface);
+        dc.setFont(f);
+        dc.setTextColor(colors[3],colors[0]);
+        if(clipped) dc.clippedWrite(p,a,b,s);
+        else dc.write(p,s);
+    }
+    vector<Color> pixels(width*height,black);
+    //Not clipped text is drawn only if it fits vertically
+    if(clipped || p.y()+f.getHeight()<=height)
+    {
+        Point surfaceEnd(width-1,height-1);
+        if(clipped==false) b=surfaceEnd;
+        reference(pixels,width,f,p,a,b,s,colors);
+    }
+    return equal(pixels.begin(),pixels.end(),surface.getPixels());
+}
+
+static bool compare(const Font& f, Point p, const char *s, short width=320)
+{
+    return compare(f,p,s,false,Point(0,0),Point(0,0),width);
+}
+
+static bool compare(const Font& f, Point p, Point a, Point b, const char *s)
+{
+    return compare(f,p,s,true,a,b,320);
+}
+
+//Synthetic fonts with pseudorandom data, to test the heights that are not
+//used by the fonts in the library
+static unsigned long long data64[96*13];
+static unsigned int data32[96*13];
+static unsigned short data16[96*13];
+static unsigned char widths[96];
+static unsigned short offsets[96];
+
+static void fillSyntheticFonts()
+{
+    unsigned int seed=12345;
+    for(auto& d : data64)
+    {
+        d=seed=seed*1103515245+12345;
+        d=d<<32 | (seed=seed*1103515245+12345);
+    }
+    for(auto& d : data32) d=seed=seed*1103515245+12345;
+    for(auto& d : data16) d=seed=seed*1103515245+12345;
+    unsigned short offset=0;
+    for(int i=0;i<96;i++)
+    {
+        //Character '!' has zero width
+        widths[i]= i==1 ? 0 : 1+i%13;
+        offsets[i]=offset;
+        offset+=widths[i];
+    }
+}
+
+/**
+ * Write a string one pixel at a time through a pixel iterator, as the text
+ * drawing functions did before writing scanlines
+ */
+template<typename U, int bpp>
+static void perPixelWrite(Surface& surface, const Font& f, Point p,
+        short length, const Color colors[4], const char *s)
+{
+    const U *fontData=reinterpret_cast<const U*>(f.getData());
+    auto it=surface.begin(p,Point(p.x()+length-1,p.y()+f.getHeight()-1),DR);
+    for(;*s;s++)
+    {
+        unsigned char c=*s-f.getStartChar();
+        int w= f.isFixedWidth() ? f.getWidth() : f.getWidths()[c];
+        int index= f.isFixedWidth() ? c*w : f.getOffset()[c];
+        for(int i=0;i<w;i++)
+        {
+            U column=fontData[index+i];
+            for(int j=0;j<f.getHeight();j++)
+            {
+                if(bpp==2) *it=colors[column & 0x3];
+                else if(column & 0x1) *it=colors[3];
+                else *it=colors[0];
+                column>>=bpp;
+            }
+        }
+    }
+}
+
+/**
+ * Fill a screen with the strings of the benchmark example
+ * \param perPixel if true write through a pixel iterator
+ * \return the time in microseconds to write the whole screen once
+ */
+static double timeText(const Font& f, const char *s, bool perPixel)
+{
+    const short width=240, height=320;
+    const int iterations=200;
+    Surface surface(width,height);
+    DrawingContext dc(surface);
+    dc.setFont(f);
+    dc.setTextColor(red,black);
+    Color colors[4];
+    Font::generatePalette(colors,red,black);
+    short length=f.calculateLength(s);
+    //The minimum of many runs is reported, as the host is not idle
+    double result=1e9;
+    for(int i=0;i<iterations;i++)
+    {
+        auto start=chrono::steady_clock::now();
+        for(short y=0;y+f.getHeight()<=height;y+=f.getHeight())
+        {
+            Point p(0,y);
+            if(perPixel==false) dc.write(p,s);
+            else if(f.getDataSize()==16)
+                perPixelWrite<unsigned short,1>(surface,f,p,length,colors,s);
+            else perPixelWrite<unsigned int,2>(surface,f,p,length,colors,s);
+        }
+        auto d=chrono::steady_clock::now()-start;
+        result=min(result,chrono::duration_cast<chrono::nanoseconds>(d).count()/1e3);
+    }
+    return result;
+}
+
+/**
+ * Surface counting the scanline transfers, as a display on a bus would see
+ * them. The text drawing functions are called directly on it, so that
+ * scanLineBuffer() is not reached through the Display base class
+ */
+class BusSurface : public Surface
+{
+public:
+    BusSurface(short width, short height) : Surface(width,height) {}
+
+    void scanLineBuffer(Point p, unsigned short length) override
+    {
+        transfers++;
+        pixels+=length;
+        Surface::scanLineBuffer(p,length);
+    }
+
+    int transfers=0; ///< Number of scanLineBuffer() calls
+    int pixels=0;    ///< Total pixels transferred
+};
+
+/**
+ * Report the bus transfers to write a string, compared with writing it one
+ * pixel at a time, that is one transfer per pixel on the CPU
+ */
+static void busTransfers(const string& name, const Font& f, const char *s)
+{
+    BusSurface surface(240,320);
+    Color colors[4];
+    Font::generatePalette(colors,red,black);
+    f.draw(surface,colors,Point(0,0),s);
+    short length=min<int>(f.calculateLength(s),surface.getWidth());
+    cout<<"Line of "<<name<<" text: "<<length*f.getHeight()
+        <<" pixel writes one at a time, "<<surface.transfers
+        <<" transfers of "<<surface.pixels<<" pixels by scanlines"<<endl;
+}
+
+int main()
+{
+    const char monospace[]="012345678901234567890123456789";
+    const char variable[]="abcdefghijklmnopqrtstuvwxyz0123456789%$! '&/";
+    check("Monospace",compare(miscFixed,Point(3,5),monospace));
+    check("Variable width",compare(tahoma,Point(0,0),variable));
+    check("Truncated at the margin",compare(tahoma,Point(250,7),variable));
+    check("Chars out of range",compare(miscFixed,Point(1,1),"\x01\xff~ a"));
+    string longString(100,'W');
+    check("Longer than a chunk",compare(miscFixed,Point(9,2),
+            longString.c_str(),800));
+    check("Longer than a chunk, truncated",compare(tahoma,Point(9,2),
+            longString.c_str(),500));
+    check("Empty string",compare(tahoma,Point(0,0),""));
+    check("Below the bottom margin",compare(miscFixed,Point(0,40),monospace));
+
+    fillSyntheticFonts();
+    const char text[]="The quick brown fox!! jumps over the lazy dog";
+    for(int h : {1,7,8,9,16})
+    {
+        Font f16(' ','~',h,11,16,false,data16);
+        Font v16(' ','~',h,16,false,widths,offsets,data16);
+        check("16 bit, height "+to_string(h),compare(f16,Point(1,2),text)
+                && compare(v16,Point(2,1),text));
+    }
+    for(int h : {17,20,24,31,32})
+    {
+        Font f32(' ','~',h,7,32,false,data32);
+        Font v32(' ','~',h,32,false,widths,offsets,data32);
+        check("32 bit, height "+to_string(h),compare(f32,Point(1,2),text)
+                && compare(v32,Point(2,1),text));
+    }
+
+    for(int h : {1,4,5,15,16})
+    {
+        Font v32(' ','~',h,32,true,widths,offsets,data32);
+        check("32 bit antialiased, height "+to_string(h),
+                compare(v32,Point(2,1),text));
+    }
+    for(int h : {17,21,32})
+    {
+        Font v64(' ','~',h,64,true,widths,offsets,data64);
+        check("64 bit antialiased, height "+to_string(h),
+                compare(v64,Point(2,1),text));
+    }
+    check("Antialiased",compare(droid11,Point(3,5),variable)
+            && compare(droid21,Point(0,20),variable));
+
+    const Font f32(' ','~',20,7,32,false,data32);
+    const Font v64(' ','~',21,64,true,widths,offsets,data64);
+    vector<pair<string,const Font*>> fonts={{"monospace",&miscFixed},
+        {"variable width",&tahoma},{"32 bit antialiased",&droid11},
+        {"64 bit antialiased",&droid21},{"32 bit monospace",&f32},
+        {"64 bit synthetic",&v64}};
+    for(auto& it : fonts)
+    {
+        const Font *f=it.second;
+        const string& name=it.first;
+        check("Clipped, "+name,compare(*f,Point(10,3),Point(15,5),
+                Point(200,17),text));
+        check("Clipped on all sides, "+name,compare(*f,Point(-7,-4),
+                Point(3,2),Point(60,12),text));
+        check("Clipped past the string end, "+name,compare(*f,Point(1,1),
+                Point(0,0),Point(319,47),"W!"));
+        check("Clipped out, "+name,compare(*f,Point(10,10),Point(0,0),
+                Point(9,47),text));
+    }
+
+    cout<<fixed<<setprecision(1);
+    for(auto& it : fonts)
+    {
+        //The fonts of the benchmark example
+        if(it.second==&f32 || it.second==&v64 || it.second==&droid21) continue;
+        double pixel=timeText(*it.second,it.second==&miscFixed ? monospace
+                                                               : variable,true);
+        double span=timeText(*it.second,it.second==&miscFixed ? monospace
+                                                              : variable,false);
+        cout<<"Screen of "<<it.first<<" text: "<<pixel<<"us per pixel, "
+            <<span<<"us by scanlines"<<endl;
+        busTransfers(it.first,*it.second,it.second==&miscFixed ? monospace
+                                                               : variable);
+    }
+    return pass ? 0 : 1;
+}
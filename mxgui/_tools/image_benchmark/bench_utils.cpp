@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cmath>
+#include "bench_utils.h"
+
+using namespace std;
+using namespace mxgui;
+
+double elapsedUs(chrono::steady_clock::time_point start)
+{
+    auto end=chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(end-start).count()/1000.0;
+}
+
+double psnr(const vector<Color>& a, const vector<Color>& b)
+{
+    double squaredError=0;
+    for(size_t i=0;i<a.size();i++)
+    {
+        int dr=((a[i]>>11)-(b[i]>>11))<<3;
+        int dg=(((a[i]>>5) & 0x3f)-((b[i]>>5) & 0x3f))<<2;
+        int db=((a[i] & 0x1f)-(b[i] & 0x1f))<<3;
+        squaredError+=dr*dr+dg*dg+db*db;
+    }
+    if(squaredError==0) return INFINITY;
+    return 10*log10(255.0*255.0*a.size()*3/squaredError);
+}
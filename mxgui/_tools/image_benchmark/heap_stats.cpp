@@ -0,0 +1,79 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+#include "heap_stats.h"
+
+using namespace std;
+
+size_t heapInUse=0;
+size_t heapPeak=0;
+size_t allocations=0;
+
+/// Allocations are prefixed by their size, padded to keep alignment
+static const size_t prefix=alignof(max_align_t);
+
+void *operator new(size_t size)
+{
+    char *p=reinterpret_cast<char*>(malloc(size+prefix));
+    if(p==nullptr) throw bad_alloc();
+    *reinterpret_cast<size_t*>(p)=size;
+    heapInUse+=size;
+    heapPeak=max(heapPeak,heapInUse);
+    allocations++;
+    return p+prefix;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const nothrow_t&) noexcept
+{
+    try { return operator new(size); } catch(bad_alloc&) { return nullptr; }
+}
+void *operator new[](size_t size, const nothrow_t&) noexcept
+{
+    return operator new(size,nothrow);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if(ptr==nullptr) return;
+    char *p=reinterpret_cast<char*>(ptr)-prefix;
+    heapInUse-=*reinterpret_cast<size_t*>(p);
+    free(p);
+}
+
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { operator delete(ptr); }
+
+void resetHeapStats()
+{
+    heapPeak=heapInUse;
+    allocations=0;
+}
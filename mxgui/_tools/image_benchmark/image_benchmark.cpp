@@ -0,0 +1,190 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host benchmark of the mxgui image decoders. Images are decoded through the
+ * ImageBase::getScanLine() interface into an in-memory framebuffer, so no
+ * display is needed.
+ * For every image reports the time to open it, the time to decode all its
+ * scanlines, the time to get only the last scanline, as when drawing a
+ * clipped image, and the peak heap memory used while doing so. A hash of the
+ * decoded pixels is also printed, to check that an optimization did not
+ * change the output when comparing with image_benchmark_reference.
+ * A summary of the throughput of every format is printed at the end.
+ * The format is selected by the file extension as in image_conformance_test,
+ * and names starting with resource: are opened as ResourceImage.
+ * Usage: image_benchmark <image> ...
+ * Returns 0 if all images were decoded.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <map>
+#include "jpeg_image.h"
+#include "tga_image.h"
+#include "raw_image.h"
+#include "resource_image.h"
+#include "heap_stats.h"
+#include "bench_utils.h"
+
+using namespace std;
+using namespace mxgui;
+
+/**
+ * Decode all scanlines of an image
+ * \param framebuffer the decoded pixels are stored here, its size must be
+ * the number of pixels of the image
+ * \return false on failure
+ */
+static bool decode(const ImageBase& img, vector<Color>& framebuffer)
+{
+    int width=img.getWidth();
+    for(short y=0;y<img.getHeight();y++)
+        if(img.getScanLine(Point(0,y),&framebuffer[y*width],width)==false)
+            return false;
+    return true;
+}
+
+/**
+ * Statistics of all the images of a format
+ */
+struct FormatStats
+{
+    int images=0;
+    double pixels=0;
+    double decodeTime=0; ///< In microseconds
+    size_t peakHeap=0;
+    size_t allocations=0;
+};
+
+static map<string,FormatStats> formatStats;
+
+/**
+ * Benchmark an image
+ * \param filename image file name, as given on the command line
+ * \param name name to pass to the image constructor
+ * \param format image format, for the summary
+ * \return false if the image could not be decoded
+ */
+template<typename Image>
+static bool benchmark(const string& filename, const char *name,
+                      const string& format)
+{
+    const int openIterations=20;
+    size_t base=heapInUse;
+    resetHeapStats();
+    auto start=chrono::steady_clock::now();
+    for(int i=0;i<openIterations;i++) Image img(name);
+    double openTime=elapsedUs(start)/openIterations;
+    size_t openPeak=heapPeak-base;
+
+    Image img(name);
+    if(img.getWidth()<=0 || img.getHeight()<=0)
+    {
+        cout<<filename<<": failed to open"<<endl;
+        return false;
+    }
+    //The framebuffer is allocated before resetting the heap statistics
+    //so that only the memory used by the decoder is accounted
+    vector<Color> framebuffer(img.getWidth()*img.getHeight());
+    //Decoding the first time may allocate buffers that are then reused
+    const int decodeIterations=5;
+    resetHeapStats();
+    bool ok=decode(img,framebuffer);
+    size_t decodePeak=heapPeak-base-framebuffer.size()*sizeof(Color);
+    size_t decodeAllocations=allocations;
+    start=chrono::steady_clock::now();
+    for(int i=0;i<decodeIterations && ok;i++) ok=decode(img,framebuffer);
+    double decodeTime=elapsedUs(start)/decodeIterations;
+    unsigned int hash=2166136261u; //FNV-1a
+    for(Color c : framebuffer) hash=(hash^c)*16777619u;
+
+    //Random access, from a freshly opened image
+    double lastLineTime=0;
+    {
+        Image last(name);
+        vector<Color> line(last.getWidth());
+        start=chrono::steady_clock::now();
+        last.getScanLine(Point(0,last.getHeight()-1),line.data(),line.size());
+        lastLineTime=elapsedUs(start);
+    }
+
+    cout<<filename<<" ("<<img.getWidth()<<"x"<<img.getHeight()<<")"
+        <<(ok ? "" : " DECODE FAILED")<<endl<<fixed<<setprecision(1)
+        <<"  open   "<<setw(10)<<openTime<<"us, peak heap "<<openPeak<<endl
+        <<"  decode "<<setw(10)<<decodeTime<<"us, peak heap "<<decodePeak
+        <<", "<<decodeAllocations<<" allocations, "
+        <<static_cast<int>(img.getHeight()*1e6/decodeTime)<<" rows/s"<<endl
+        <<"  last scanline "<<setw(3)<<lastLineTime<<"us"<<endl
+        <<"  pixel hash "<<hex<<hash<<dec<<endl;
+
+    FormatStats& stats=formatStats[format];
+    stats.images++;
+    stats.pixels+=framebuffer.size();
+    stats.decodeTime+=decodeTime;
+    stats.peakHeap=max(stats.peakHeap,max(openPeak,decodePeak));
+    stats.allocations+=decodeAllocations;
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<2)
+    {
+        cerr<<"usage: image_benchmark <image> ..."<<endl;
+        return 1;
+    }
+    bool ok=true;
+    const string resource="resource:";
+    for(int i=1;i<argc;i++)
+    {
+        string filename=argv[i];
+        string extension=filename.substr(filename.find_last_of('.')+1);
+        if(filename.compare(0,resource.size(),resource)==0)
+            ok&=benchmark<ResourceImage>(filename,
+                filename.c_str()+resource.size(),"resource");
+        else if(extension=="tga")
+            ok&=benchmark<TgaImage>(filename,filename.c_str(),"tga");
+        else if(extension=="raw" || extension=="rle")
+            ok&=benchmark<RawImage>(filename,filename.c_str(),"raw");
+        else ok&=benchmark<JpegImage>(filename,filename.c_str(),"jpeg");
+    }
+
+    cout<<"Summary"<<endl;
+    for(auto& it : formatStats)
+    {
+        const FormatStats& stats=it.second;
+        cout<<"  "<<setw(8)<<left<<it.first<<right<<setw(3)<<stats.images
+            <<" images, "<<setw(7)<<setprecision(2)
+            <<stats.pixels/stats.decodeTime<<" Mpixel/s, peak heap "
+            <<stats.peakHeap<<", "<<stats.allocations<<" allocations"<<endl;
+    }
+    return ok ? 0 : 1;
+}
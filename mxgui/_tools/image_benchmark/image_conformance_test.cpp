@@ -0,0 +1,182 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Conformance test of the mxgui image decoders. The image is decoded through
+ * the ImageBase::getScanLine() interface into an in-memory framebuffer, that
+ * is compared with a reference decode stored as a png file, converted to
+ * RGB565. Lossless formats must match exactly, lossy ones must have a PSNR
+ * above the given threshold. The image is then read again as partial
+ * scanlines in reverse order, as when drawing a clipped image, that must
+ * match the framebuffer.
+ * The format is selected by the file extension: .jpg (JpegImage), .tga
+ * (TgaImage), .raw and .rle (RawImage). Names starting with resource: are
+ * opened as ResourceImage, that looks for them in the resource directory of
+ * the working directory.
+ * Usage: image_conformance_test <image> <reference.png> [min PSNR in dB]
+ * Returns 0 if the test passes.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <string>
+#include <iostream>
+#include <iomanip>
+#include <png.h>
+#include "jpeg_image.h"
+#include "tga_image.h"
+#include "raw_image.h"
+#include "resource_image.h"
+#include "bench_utils.h"
+
+using namespace std;
+using namespace mxgui;
+
+/**
+ * \param name image file name
+ * \return the image, of the class that handles its format
+ */
+static unique_ptr<ImageBase> openImage(const string& name)
+{
+    const string resource="resource:";
+    if(name.compare(0,resource.size(),resource)==0)
+        return unique_ptr<ImageBase>(
+            new ResourceImage(name.substr(resource.size()).c_str()));
+    string extension=name.substr(name.find_last_of('.')+1);
+    if(extension=="jpg")
+        return unique_ptr<ImageBase>(new JpegImage(name));
+    if(extension=="tga")
+        return unique_ptr<ImageBase>(new TgaImage(name.c_str()));
+    if(extension=="raw" || extension=="rle")
+        return unique_ptr<ImageBase>(new RawImage(name.c_str()));
+    return nullptr;
+}
+
+/**
+ * Load the reference png image, converting it to RGB565 like pngconverter
+ * \param filename png file name
+ * \param pixels pixels are returned here
+ * \param width image width is returned here
+ * \param height image height is returned here
+ * \return false on failure
+ */
+static bool loadReference(const char *filename, vector<Color>& pixels,
+                          int& width, int& height)
+{
+    png_image png={};
+    png.version=PNG_IMAGE_VERSION;
+    if(png_image_begin_read_from_file(&png,filename)==0) return false;
+    png.format=PNG_FORMAT_RGB;
+    vector<unsigned char> rgb(PNG_IMAGE_SIZE(png));
+    if(png_image_finish_read(&png,nullptr,rgb.data(),0,nullptr)==0) return false;
+    width=png.width;
+    height=png.height;
+    pixels.resize(width*height);
+    for(size_t i=0;i<pixels.size();i++)
+    {
+        const unsigned char *p=&rgb[3*i];
+        pixels[i]=(p[0] & 0xf8)<<8 | (p[1] & 0xfc)<<3 | p[2]>>3;
+    }
+    return true;
+}
+
+/**
+ * Read the image as partial scanlines, from the last to the first, and
+ * compare them with the framebuffer
+ * \return the number of pixels that differ, or -1 if a read failed
+ */
+static int checkPartialScanlines(const ImageBase& img,
+                                 const vector<Color>& framebuffer)
+{
+    int width=img.getWidth();
+    vector<Color> line(width);
+    int mismatches=0;
+    srand(0);
+    for(int y=img.getHeight()-1;y>=0;y--)
+    {
+        int x=rand()%width;
+        int length=1+rand()%(width-x);
+        if(img.getScanLine(Point(x,y),line.data(),length)==false) return -1;
+        for(int i=0;i<length;i++)
+            if(line[i]!=framebuffer[y*width+x+i]) mismatches++;
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<3)
+    {
+        cerr<<"usage: image_conformance_test <image> <reference.png> "
+              "[min PSNR in dB]"<<endl;
+        return 1;
+    }
+    bool exact=argc<4;
+    double minPsnr=exact ? INFINITY : atof(argv[3]);
+
+    vector<Color> reference;
+    int width, height;
+    if(loadReference(argv[2],reference,width,height)==false)
+    {
+        cout<<argv[2]<<": can't load reference"<<endl;
+        return 1;
+    }
+    unique_ptr<ImageBase> img=openImage(argv[1]);
+    if(!img || img->getWidth()!=width || img->getHeight()!=height)
+    {
+        cout<<argv[1]<<": failed to open or wrong size"<<endl;
+        return 1;
+    }
+
+    vector<Color> framebuffer(width*height);
+    for(int y=0;y<height;y++)
+    {
+        if(img->getScanLine(Point(0,y),&framebuffer[y*width],width)==false)
+        {
+            cout<<argv[1]<<": decode failed at line "<<y<<endl;
+            return 1;
+        }
+    }
+    int mismatches=0;
+    for(size_t i=0;i<framebuffer.size();i++)
+        if(framebuffer[i]!=reference[i]) mismatches++;
+    double quality=psnr(framebuffer,reference);
+    int partialMismatches=checkPartialScanlines(*img,framebuffer);
+
+    bool pass=(exact ? mismatches==0 : quality>=minPsnr) &&
+              partialMismatches==0;
+    cout<<argv[1]<<" ("<<width<<"x"<<height<<") "<<(pass ? "PASS" : "FAIL")
+        <<": "<<mismatches<<" pixels differ from the reference, PSNR "
+        <<fixed<<setprecision(2)<<quality<<"dB";
+    if(partialMismatches<0) cout<<", partial scanline read failed";
+    else if(partialMismatches>0)
+        cout<<", "<<partialMismatches<<" pixels differ in partial scanlines";
+    cout<<endl;
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Compares the output of JpegImage with the one of libjpeg.
+ * The integer inverse DCTs and the color conversion follow the libjpeg ones,
+ * so the output must match exactly the one of libjpeg configured with the
+ * same inverse DCT. For all inverse DCTs the PSNR with respect to the libjpeg
+ * float decoder is reported, and must be above a threshold.
+ * Images are decoded at full size and at all the reduced scales, that must
+ * match libjpeg decoding with the same scale_denom.
+ * Images are also decoded with scanlines requested out of order, and when
+ * more than one image is given, all of them are decoded concurrently from
+ * different threads. Both must give the same result as a sequential decode.
+ * Usage: jpeg_reference_test <file.jpg> ...
+ * Returns 0 if all tests pass.
+ */
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <jpeglib.h>
+#include "jpeg_image.h"
+#include "bench_utils.h"
+
+using namespace std;
+using namespace mxgui;
+
+#if defined(MXGUI_JPEG_IDCT_ISLOW)
+static const char idctName[]="islow";
+static const J_DCT_METHOD idctMethod=JDCT_ISLOW;
+static const bool bitExact=true;
+#elif defined(MXGUI_JPEG_IDCT_IFAST)
+static const char idctName[]="ifast";
+static const J_DCT_METHOD idctMethod=JDCT_IFAST;
+static const bool bitExact=true;
+#else
+static const char idctName[]="float";
+static const J_DCT_METHOD idctMethod=JDCT_FLOAT;
+static const bool bitExact=false;
+#endif
+
+/// Minimum PSNR in dB with respect to the libjpeg float decoder. The test
+/// images are RGB565, so the PSNR is computed on RGB565 channels
+static const double minPsnr=30.0;
+
+/**
+ * Decode an image with libjpeg
+ * \param filename image file name
+ * \param method inverse DCT to use
+ * \param scale the image is decoded at 1/scale of its size
+ * \param pixels decoded pixels are returned here, as RGB565
+ * \param width image width is returned here
+ * \param height image height is returned here
+ * \return decode time in microseconds, or -1 on failure
+ */
+static double libjpegDecode(const char *filename, J_DCT_METHOD method,
+        int scale, vector<Color>& pixels, int& width, int& height)
+{
+    FILE *f=fopen(filename,"rb");
+    if(f==nullptr) return -1;
+    auto start=chrono::steady_clock::now();
+    jpeg_decompress_struct cinfo;
+    jpeg_error_mgr jerr;
+    cinfo.err=jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo,f);
+    jpeg_read_header(&cinfo,TRUE);
+    cinfo.out_color_space=JCS_RGB;
+    cinfo.dct_method=method;
+    cinfo.do_fancy_upsampling=FALSE;
+    cinfo.scale_num=1;
+    cinfo.scale_denom=scale;
+    jpeg_start_decompress(&cinfo);
+    width=cinfo.output_width;
+    height=cinfo.output_height;
+    pixels.resize(width*height);
+    vector<unsigned char> row(width*3);
+    while(cinfo.output_scanline<cinfo.output_height)
+    {
+        Color *out=&pixels[cinfo.output_scanline*width];
+        unsigned char *p=row.data();
+        jpeg_read_scanlines(&cinfo,&p,1);
+        for(int x=0;x<width;x++,p+=3)
+            out[x]=((p[0] & 0xf8)<<8) | ((p[1] & 0xfc)<<3) | (p[2]>>3);
+    }
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    double result=elapsedUs(start);
+    fclose(f);
+    return result;
+}
+
+/**
+ * Decode an image with JpegImage
+ * \param filename image file name
+ * \param pixels decoded pixels are returned here
+ * \param scale the image is decoded at 1/scale of its size
+ * \return decode time in microseconds, or -1 on failure
+ */
+static double mxguiDecode(const char *filename, vector<Color>& pixels,
+        int scale=1)
+{
+    auto start=chrono::steady_clock::now();
+    JpegImage img(filename,scale);
+    if(img.getWidth()<=0 || img.getHeight()<=0) return -1;
+    const int width=img.getWidth();
+    pixels.resize(width*img.getHeight());
+    for(short y=0;y<img.getHeight();y++)
+        if(img.getScanLine(Point(0,y),&pixels[y*width],width)==false)
+            return -1;
+    return elapsedUs(start);
+}
+
+/**
+ * Decode an image with JpegImage requesting the scanlines from the last one,
+ * and in two halves, to test that the decoder does not depend on them being
+ * requested in order
+ * \param filename image file name
+ * \param scale the image is decoded at 1/scale of its size
+ * \param pixels decoded pixels are returned here
+ * \return false on failure
+ */
+static bool mxguiDecodeOutOfOrder(const char *filename, int scale,
+        vector<Color>& pixels)
+{
+    JpegImage img(filename,scale);
+    if(img.getWidth()<=0 || img.getHeight()<=0) return false;
+    const int width=img.getWidth();
+    const int half=width/2;
+    pixels.resize(width*img.getHeight());
+    for(short y=img.getHeight()-1;y>=0;y--)
+    {
+        Color *line=&pixels[y*width];
+        if(img.getScanLine(Point(half,y),line+half,width-half)==false)
+            return false;
+        if(img.getScanLine(Point(0,y),line,half)==false) return false;
+    }
+    return true;
+}
+
+/**
+ * Decode images concurrently, one thread per image
+ * \param filenames image file names
+ * \return true if the result is the same as decoding them sequentially
+ */
+static bool testConcurrentDecode(const vector<const char*>& filenames)
+{
+    const size_t n=filenames.size();
+    vector<vector<Color>> sequential(n), concurrent(n);
+    for(size_t i=0;i<n;i++) mxguiDecode(filenames[i],sequential[i]);
+    vector<thread> threads;
+    for(size_t i=0;i<n;i++)
+        threads.emplace_back([&,i]{ mxguiDecode(filenames[i],concurrent[i]); });
+    for(auto& t : threads) t.join();
+    bool pass=concurrent==sequential;
+    cout<<"Concurrent decode of "<<n<<" images "<<(pass ? "PASS" : "FAIL")
+        <<endl;
+    return pass;
+}
+
+/**
+ * Test an image
+ * \param filename image file name
+ * \param scale the image is decoded at 1/scale of its size
+ * \return true if the test passed
+ */
+static bool testImage(const char *filename, int scale)
+{
+    vector<Color> ours, exact, reference;
+    int width, height;
+    double ourTime=mxguiDecode(filename,ours,scale);
+    double exactTime=libjpegDecode(filename,idctMethod,scale,exact,width,height);
+    libjpegDecode(filename,JDCT_FLOAT,scale,reference,width,height);
+    if(ourTime<0 || exactTime<0 || ours.size()!=exact.size())
+    {
+        cout<<filename<<": decode failed"<<endl;
+        return false;
+    }
+
+    int mismatches=0;
+    for(size_t i=0;i<ours.size();i++) if(ours[i]!=exact[i]) mismatches++;
+    double quality=psnr(ours,reference);
+    vector<Color> outOfOrder;
+    bool outOfOrderPass=mxguiDecodeOutOfOrder(filename,scale,outOfOrder)
+                     && outOfOrder==ours;
+    bool pass=(bitExact==false || mismatches==0) && quality>=minPsnr
+           && outOfOrderPass;
+
+    cout<<filename<<" ("<<width<<"x"<<height<<" at 1/"<<scale<<") "
+        <<(pass ? "PASS" : "FAIL")
+        <<endl<<fixed<<setprecision(2)
+        <<"  "<<mismatches<<" pixels differ from libjpeg "<<idctName
+        <<", PSNR "<<quality<<"dB from libjpeg float"<<endl<<setprecision(1)
+        <<"  decode "<<ourTime<<"us, libjpeg "<<idctName<<" "<<exactTime
+        <<"us"<<endl
+        <<"  out of order decode "<<(outOfOrderPass ? "matches" : "DIFFERS")
+        <<endl;
+    return pass;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<2)
+    {
+        cerr<<"usage: jpeg_reference_test <file.jpg> ..."<<endl;
+        return 1;
+    }
+    // The libjpeg-turbo SIMD code is not guaranteed to be bit exact with the
+    // reference C implementation, which is the one JpegImage follows
+    setenv("JSIMD_FORCENONE","1",1);
+    cout<<"Inverse DCT: "<<idctName<<endl;
+    bool pass=true;
+    for(int i=1;i<argc;i++)
+        for(int scale : {1,2,4,8}) pass&=testImage(argv[i],scale);
+    if(argc>2) pass&=testConcurrentDecode(vector<const char*>(argv+1,argv+argc));
+    return pass ? 0 : 1;
+}
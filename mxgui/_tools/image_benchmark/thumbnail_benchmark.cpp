@@ -0,0 +1,186 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host benchmark of thumbnail generation from JPEG images. For every image
+ * and scale compares decoding at reduced size with the JpegImage scale
+ * option, against decoding at full size and then averaging the pixels down
+ * to the same size, as was needed without it. Reports the time taken, that
+ * includes opening the image, the peak heap memory, and the PSNR between the
+ * two thumbnails.
+ * Usage: thumbnail_benchmark <file.jpg> ...
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "jpeg_image.h"
+#include "heap_stats.h"
+#include "bench_utils.h"
+
+using namespace std;
+using namespace mxgui;
+
+/**
+ * Make a thumbnail decoding the image at reduced size
+ * \param filename image file name
+ * \param scale the thumbnail is 1/scale of the image size
+ * \param thumbnail pixels are returned here
+ * \return false on failure
+ */
+static bool scaledThumbnail(const string& filename, int scale,
+        vector<Color>& thumbnail)
+{
+    JpegImage img(filename,scale);
+    if(img.getWidth()<=0 || img.getHeight()<=0) return false;
+    const int width=img.getWidth();
+    thumbnail.resize(width*img.getHeight());
+    for(short y=0;y<img.getHeight();y++)
+        if(img.getScanLine(Point(0,y),&thumbnail[y*width],width)==false)
+            return false;
+    return true;
+}
+
+/**
+ * Make a thumbnail decoding the image at full size, and averaging each
+ * scale x scale square of pixels
+ * \param filename image file name
+ * \param scale the thumbnail is 1/scale of the image size
+ * \param thumbnail pixels are returned here
+ * \return false on failure
+ */
+static bool downscaledThumbnail(const string& filename, int scale,
+        vector<Color>& thumbnail)
+{
+    JpegImage img(filename);
+    if(img.getWidth()<=0 || img.getHeight()<=0) return false;
+    const int width=img.getWidth();
+    const int height=img.getHeight();
+    const int tWidth=(width+scale-1)/scale;
+    const int tHeight=(height+scale-1)/scale;
+    thumbnail.resize(tWidth*tHeight);
+    vector<Color> line(width);
+    vector<unsigned int> r(tWidth), g(tWidth), b(tWidth);
+    for(int ty=0;ty<tHeight;ty++)
+    {
+        fill(r.begin(),r.end(),0);
+        fill(g.begin(),g.end(),0);
+        fill(b.begin(),b.end(),0);
+        const int lines=min(scale,height-ty*scale);
+        for(int y=ty*scale;y<ty*scale+lines;y++)
+        {
+            if(img.getScanLine(Point(0,y),line.data(),width)==false)
+                return false;
+            for(int x=0;x<width;x++)
+            {
+                r[x/scale]+=line[x]>>11;
+                g[x/scale]+=(line[x]>>5) & 0x3f;
+                b[x/scale]+=line[x] & 0x1f;
+            }
+        }
+        for(int tx=0;tx<tWidth;tx++)
+        {
+            const unsigned int n=lines*min(scale,width-tx*scale);
+            thumbnail[ty*tWidth+tx]=((r[tx]+n/2)/n)<<11
+                                   | ((g[tx]+n/2)/n)<<5
+                                   | ((b[tx]+n/2)/n);
+        }
+    }
+    return true;
+}
+
+/**
+ * Time a thumbnail generation function
+ * \param make thumbnail generation function
+ * \param filename image file name
+ * \param scale the thumbnail is 1/scale of the image size
+ * \param thumbnail pixels are returned here
+ * \param time average time in microseconds is returned here
+ * \param peak peak heap memory is returned here
+ * \return false on failure
+ */
+static bool benchmark(bool (*make)(const string&, int, vector<Color>&),
+        const string& filename, int scale, vector<Color>& thumbnail,
+        double& time, size_t& peak)
+{
+    const int iterations=5;
+    size_t base=heapInUse;
+    resetHeapStats();
+    if(make(filename,scale,thumbnail)==false) return false;
+    //The thumbnail itself is not counted
+    peak=heapPeak-base-thumbnail.size()*sizeof(Color);
+    vector<Color> temp;
+    auto start=chrono::steady_clock::now();
+    for(int i=0;i<iterations;i++) make(filename,scale,temp);
+    time=elapsedUs(start)/iterations;
+    return true;
+}
+
+/**
+ * Benchmark thumbnails of a JPEG image
+ * \param filename image file name
+ */
+static void benchmarkThumbnails(const string& filename)
+{
+    cout<<filename<<endl<<fixed;
+    for(int scale : {2,4,8})
+    {
+        vector<Color> scaled, downscaled;
+        double scaledTime, downscaledTime;
+        size_t scaledPeak, downscaledPeak;
+        if(!benchmark(scaledThumbnail,filename,scale,scaled,scaledTime,
+                scaledPeak) ||
+           !benchmark(downscaledThumbnail,filename,scale,downscaled,
+                downscaledTime,downscaledPeak) ||
+           scaled.size()!=downscaled.size())
+        {
+            cout<<"  1/"<<scale<<" FAILED"<<endl;
+            continue;
+        }
+        cout<<setprecision(1)
+            <<"  1/"<<scale<<" scaled decode "<<setw(9)<<scaledTime
+            <<"us, peak heap "<<scaledPeak<<endl
+            <<"      full decode and downscale "<<setw(9)<<downscaledTime
+            <<"us, peak heap "<<downscaledPeak<<endl
+            <<setprecision(2)<<"      speedup "<<downscaledTime/scaledTime
+            <<", PSNR between them "<<psnr(scaled,downscaled)<<"dB"<<endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc<2)
+    {
+        cerr<<"usage: thumbnail_benchmark <file.jpg> ..."<<endl;
+        return 1;
+    }
+    for(int i=1;i<argc;i++) benchmarkThumbnails(argv[i]);
+    return 0;
+}
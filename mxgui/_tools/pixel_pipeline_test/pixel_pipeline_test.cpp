@@ -0,0 +1,220 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host test of PixelPipeline. A mock PixelBus emulates the memory of a MIPI
+ * DCS display controller, so that what is drawn can be checked, and checks
+ * that the pipeline uses the bus correctly: no command is sent while a
+ * transfer is in progress, and the pixels being sent are not modified before
+ * the transfer completes. Transfers complete only when wait() is called, as
+ * if the bus was infinitely slow.
+ * Usage: pixel_pipeline_test
+ * Returns 0 if all tests pass.
+ */
+
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include "pixel_pipeline.h"
+
+using namespace std;
+using namespace mxgui;
+
+/**
+ * Mock bus, with the memory of a display controller
+ */
+class MockBus : public PixelBus
+{
+public:
+    MockBus(int width, int height)
+        : width(width), height(height), memory(width*height,0) {}
+
+    void sendCommand(unsigned char cmd, const unsigned char *args,
+                     int len) override
+    {
+        if(inProgress) errors++;
+        commands++;
+        if(len!=4) return;
+        int start=args[0]<<8 | args[1];
+        int end=args[2]<<8 | args[3];
+        if(cmd==PixelPipeline::columnAddress) { x1=start; x2=end; }
+        if(cmd==PixelPipeline::pageAddress) { y1=start; y2=end; }
+    }
+
+    void startPixels(unsigned char cmd, const Color *pixels,
+                     unsigned int length, bool repeat) override
+    {
+        if(inProgress || cmd!=PixelPipeline::memoryWrite) errors++;
+        inProgress=true;
+        transfers++;
+        this->pixels=pixels;
+        this->repeat=repeat;
+        //Remember what was to be sent, to check it is not modified
+        sent.assign(pixels,pixels+(repeat ? 1 : length));
+        this->length=length;
+    }
+
+    void wait() override
+    {
+        if(!inProgress) return;
+        inProgress=false;
+        if(memcmp(sent.data(),pixels,sent.size()*sizeof(Color))!=0) errors++;
+        //Write the memory like the controller, filling the window row by row
+        int x=x1, y=y1;
+        for(unsigned int i=0;i<length;i++)
+        {
+            if(x<0 || x>=width || y<0 || y>=height)
+            {
+                errors++;
+                return;
+            }
+            memory[y*width+x]=sent[repeat ? 0 : i];
+            if(++x>x2) { x=x1; y++; }
+        }
+    }
+
+    Color pixel(int x, int y) const { return memory[y*width+x]; }
+
+    int width, height;
+    vector<Color> memory;
+    int x1=0, x2=0, y1=0, y2=0;  ///< Current window
+    bool inProgress=false;       ///< A transfer was started and not waited
+    const Color *pixels=nullptr; ///< Pixels of the transfer in progress
+    unsigned int length=0;
+    bool repeat=false;
+    vector<Color> sent;          ///< Copy of the pixels to send
+    int errors=0;                ///< Misuses of the bus
+    int commands=0;
+    int transfers=0;
+};
+
+static bool pass=true;
+
+/**
+ * Report the result of a test
+ */
+static void check(const char *name, bool result)
+{
+    cout<<name<<": "<<(result ? "PASS" : "FAIL")<<endl;
+    pass&=result;
+}
+
+/**
+ * \return a color that depends on the pixel coordinates
+ */
+static Color pattern(int x, int y) { return x*31+y*1021; }
+
+int main()
+{
+    const int width=240, height=320;
+
+    //Filling the screen, in one transfer
+    {
+        MockBus bus(width,height);
+        PixelPipeline pipeline(bus,width);
+        pipeline.fill(Point(0,0),Point(width-1,height-1),0xf800);
+        bool ok=bus.inProgress; //Must not wait for the transfer
+        pipeline.fence();
+        for(int i=0;i<width*height;i++) ok&=bus.memory[i]==0xf800;
+        check("fill",ok && bus.errors==0 && bus.transfers==1);
+    }
+
+    //Rendering scanlines while the previous one is sent
+    {
+        MockBus bus(width,height);
+        PixelPipeline pipeline(bus,width);
+        bool ok=true;
+        Color *previous=nullptr;
+        for(int y=0;y<height;y++)
+        {
+            Color *line=pipeline.getScanLineBuffer();
+            //Double buffered, the buffer being sent is not returned
+            if(line==previous) ok=false;
+            for(int x=0;x<width;x++) line[x]=pattern(x,y);
+            pipeline.scanLineBuffer(Point(0,y),width);
+            ok&=bus.inProgress;
+            previous=line;
+        }
+        pipeline.fence();
+        for(int y=0;y<height;y++)
+            for(int x=0;x<width;x++) ok&=bus.pixel(x,y)==pattern(x,y);
+        check("scanLineBuffer",ok && bus.errors==0);
+    }
+
+    //Partial scanlines from a caller buffer, that is reused immediately
+    {
+        MockBus bus(width,height);
+        PixelPipeline pipeline(bus,width);
+        Color line[width];
+        for(int y=10;y<20;y++)
+        {
+            for(int x=0;x<100;x++) line[x]=pattern(x+50,y);
+            pipeline.scanLine(Point(50,y),line,100);
+        }
+        memset(line,0,sizeof(line));
+        pipeline.fence();
+        bool ok=true;
+        for(int y=0;y<height;y++)
+            for(int x=0;x<width;x++)
+            {
+                bool inside=y>=10 && y<20 && x>=50 && x<150;
+                ok&=bus.pixel(x,y)==(inside ? pattern(x,y) : 0);
+            }
+        check("scanLine",ok && bus.errors==0);
+    }
+
+    //Commands wait for the transfer in progress
+    {
+        MockBus bus(width,height);
+        PixelPipeline pipeline(bus,width);
+        vector<Color> image(32*16);
+        for(int i=0;i<32*16;i++) image[i]=pattern(i%32,i/32);
+        pipeline.write(Point(8,8),Point(39,23),image.data(),image.size());
+        unsigned char arg=0x08;
+        pipeline.command(0x36,&arg,1);
+        bool ok=!bus.inProgress;
+        for(int i=0;i<32*16;i++)
+            ok&=bus.pixel(8+i%32,8+i/32)==pattern(i%32,i/32);
+        check("write and command",ok && bus.errors==0);
+    }
+
+    //The mock detects a buffer modified while being sent, by rendering
+    //through the pointer to the previous buffer instead of the new one
+    {
+        MockBus bus(width,height);
+        PixelPipeline pipeline(bus,width);
+        Color *line=pipeline.getScanLineBuffer();
+        pipeline.scanLineBuffer(Point(0,0),width);
+        pipeline.getScanLineBuffer();
+        for(int x=0;x<width;x++) line[x]=1;
+        pipeline.scanLineBuffer(Point(0,1),width);
+        pipeline.fence();
+        check("misuse detected",bus.errors>0);
+    }
+
+    return pass ? 0 : 1;
+}
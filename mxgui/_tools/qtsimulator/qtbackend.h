@@ -78,6 +78,24 @@ public:
      */
     void *getData() { return &data[0][0]; }
 
+    /**
+     * Copy a rectangle of the framebuffer to an image with the same format
+     * \param dest pixel data of the image
+     * \param stride distance in bytes between the rows of the image
+     * \param x1 leftmost column to copy
+     * \param y1 topmost row to copy
+     * \param x2 rightmost column to copy
+     * \param y2 bottom row to copy
+     * \return the number of bytes copied
+     */
+    int copyRect(void *dest, int stride, int x1, int y1, int x2, int y2) const
+    {
+        int length=(x2-x1+1)*sizeof(T);
+        unsigned char *d=reinterpret_cast<unsigned char*>(dest)+x1*sizeof(T);
+        for(int y=y1;y<=y2;y++) std::memcpy(d+y*stride,&data[y][x1],length);
+        return length*(y2-y1+1);
+    }
+
 private:
     ///Pixel data, stored as [M][N] because matches QImage's representation
     T data[M][N];
@@ -143,6 +161,26 @@ public:
      */
     void *getData() { return &data[0][0]; }
 
+    /**
+     * Copy a rectangle of the framebuffer to an image with the same format.
+     * Whole bytes are copied, so up to 7 pixels around the rectangle are
+     * copied too
+     * \param dest pixel data of the image
+     * \param stride distance in bytes between the rows of the image
+     * \param x1 leftmost column to copy
+     * \param y1 topmost row to copy
+     * \param x2 rightmost column to copy
+     * \param y2 bottom row to copy
+     * \return the number of bytes copied
+     */
+    int copyRect(void *dest, int stride, int x1, int y1, int x2, int y2) const
+    {
+        int length=x2/8-x1/8+1;
+        unsigned char *d=reinterpret_cast<unsigned char*>(dest)+x1/8;
+        for(int y=y1;y<=y2;y++) std::memcpy(d+y*stride,&data[y][x1/8],length);
+        return length*(y2-y1+1);
+    }
+
 private:
     ///Pixel data, stored as [M][N] because matches QImage's representation
     unsigned char data[M][(N+7)/8];
@@ -186,6 +224,21 @@ public:
      */
     boost::shared_ptr<UpdateSignalSender> getSender() const { return sender; }
 
+    /**
+     * \return the number of bytes copied from the framebuffer to the screen
+     * so far, to measure how much data a display with the same framebuffer
+     * would need to receive
+     */
+    unsigned long long getBytesTransferred() const { return bytesTransferred; }
+
+    /**
+     * Account for bytes copied from the framebuffer to the screen.
+     * Called by the main thread only while the background thread waits for
+     * the copy to complete
+     * \param bytes number of bytes copied
+     */
+    void addBytesTransferred(int bytes) { bytesTransferred+=bytes; }
+
 private:
     QTBackend(const QTBackend& );
     QTBackend& operator= (const QTBackend& );
@@ -193,11 +246,12 @@ private:
     /**
      * Constructor
      */
-    QTBackend(): started(false) {}
+    QTBackend(): started(false), bytesTransferred(0) {}
 
     FrameBuffer fb; ///< Framebuffer object
     bool started; ///< True if the background thread has already been started
     boost::shared_ptr<UpdateSignalSender> sender; ///< Object to update GUI
+    unsigned long long bytesTransferred; ///< Bytes copied to the screen
 };
 
 #endif //QTBACKEND_H
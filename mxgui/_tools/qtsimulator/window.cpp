@@ -27,8 +27,9 @@ using namespace mxgui;
 // class UpdateSignalSender
 //
 
-void UpdateSignalSender::update()
+void UpdateSignalSender::update(const DirtyRegion& region)
 {
+    this->region=&region;
     emit sendUpdate();
 }
 
@@ -70,9 +71,18 @@ Window::Window(QWidget *parent): QWidget(parent),
 
 void Window::updateFrameBuffer()
 {
-    FrameBuffer& buffer=QTBackend::instance().getFrameBuffer();
-    std::memcpy(image.bits(),buffer.getData(),image.sizeInBytes());
-    this->update();
+    //Copy only what was drawn, like a display driver that tracks the dirty
+    //region would do, and count the bytes to measure it
+    QTBackend& qb=QTBackend::instance();
+    const FrameBuffer& buffer=qb.getFrameBuffer();
+    const DirtyRegion& region=sender->getRegion();
+    for(int i=0;i<region.size();i++)
+    {
+        Point p1=region[i].p1, p2=region[i].p2;
+        qb.addBytesTransferred(buffer.copyRect(image.bits(),
+            image.bytesPerLine(),p1.x(),p1.y(),p2.x(),p2.y()));
+        this->update(QRect(QPoint(p1.x(),p1.y()),QPoint(p2.x(),p2.y())));
+    }
 }
 
 void Window::aPressed()
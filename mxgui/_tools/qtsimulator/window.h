@@ -24,6 +24,7 @@
 #include <QBoxLayout>
 #include <QMouseEvent>
 #include <boost/shared_ptr.hpp>
+#include "dirty_region.h"
 
 /**
  * This class just provides the update() member function to refresh the GUI.
@@ -37,7 +38,7 @@ public:
     /**
      * Constructor.
      */
-    UpdateSignalSender() {}
+    UpdateSignalSender() : region(nullptr) {}
 
     /**
      * Send a signal to the GUI requesting for a refresh. This causes the main
@@ -47,8 +48,16 @@ public:
      * The fact that this call blocks the thread that calls it waiting for the
      * main thread to do something implies that it *cannot* be called from the
      * main thread itself or deadlock will occur.
+     * \param region the parts of the framebuffer to copy, the rest of the
+     * screen is left unchanged
      */
-    void update();
+    void update(const mxgui::DirtyRegion& region);
+
+    /**
+     * \return the parts of the framebuffer to copy, valid only while the
+     * update signal is processed
+     */
+    const mxgui::DirtyRegion& getRegion() const { return *region; }
 
 signals:
     /**
@@ -59,6 +68,8 @@ signals:
 private:
     UpdateSignalSender(const UpdateSignalSender& );
     UpdateSignalSender& operator= (const UpdateSignalSender& );
+
+    const mxgui::DirtyRegion *region; ///< Region of the update in progress
 };
 
 /**
@@ -0,0 +1,259 @@
+/***************************************************************************
+ *   Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016 by Terraneo Federico *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+/*
+ * Host test of off-screen surfaces. A plot is drawn directly on a display and
+ * on a surface that is then blitted to another display, and the two displays
+ * must be equal. The displays are surfaces themselves, that count the calls
+ * to their drawing primitives, which on a display connected through a bus
+ * correspond to separate transfers.
+ * Usage: surface_test
+ * Returns 0 if all tests pass.
+ */
+
+#include <cmath>
+#include <vector>
+#include <iostream>
+#include "surface.h"
+#include "misc_inst.h"
+#include "level2/simple_plot.h"
+
+using namespace std;
+using namespace mxgui;
+
+namespace mxgui {
+void registerDisplayHook(DisplayManager& dm) {}
+} //namespace mxgui
+
+/**
+ * A surface standing for a display, that counts the calls to its drawing
+ * primitives
+ */
+class CountingDisplay : public Surface
+{
+public:
+    CountingDisplay(short width, short height)
+        : Surface(width,height), calls(0) {}
+
+    using Surface::clear;
+
+    void write(Point p, const char *text) override
+    {
+        calls++;
+        Surface::write(p,text);
+    }
+
+    void clippedWrite(Point p, Point a, Point b, const char *text) override
+    {
+        calls++;
+        Surface::clippedWrite(p,a,b,text);
+    }
+
+    void clear(Point p1, Point p2, Color color) override
+    {
+        calls++;
+        Surface::clear(p1,p2,color);
+    }
+
+    void setPixel(Point p, Color color) override
+    {
+        calls++;
+        Surface::setPixel(p,color);
+    }
+
+    void line(Point a, Point b, Color color) override
+    {
+        calls++;
+        Surface::line(a,b,color);
+    }
+
+    void scanLine(Point p, const Color *colors, unsigned short length) override
+    {
+        calls++;
+        Surface::scanLine(p,colors,length);
+    }
+
+    void drawImage(Point p, const ImageBase& img) override
+    {
+        calls++;
+        Surface::drawImage(p,img);
+    }
+
+    void clippedDrawImage(Point p, Point a, Point b,
+                          const ImageBase& img) override
+    {
+        calls++;
+        Surface::clippedDrawImage(p,a,b,img);
+    }
+
+    int calls;
+};
+
+static bool pass=true;
+
+/**
+ * Report the result of a test
+ */
+static void check(const char *name, bool result)
+{
+    cout<<name<<": "<<(result ? "PASS" : "FAIL")<<endl;
+    pass&=result;
+}
+
+/**
+ * \return true if the two surfaces have the same size and pixels
+ */
+static bool equal(const Surface& a, const Surface& b)
+{
+    if(a.getSize()!=b.getSize()) return false;
+    int size=a.getWidth()*a.getHeight();
+    return equal(a.getPixels(),a.getPixels()+size,b.getPixels());
+}
+
+/**
+ * \return a color that depends on the pixel coordinates
+ */
+static Color pattern(int x, int y) { return x*31+y*1021; }
+
+/**
+ * Check the pixel iterators in both directions, by drawing an in memory image
+ * clipped, that uses them, and not clipped, that copies it
+ */
+static bool iterators()
+{
+    const short w=23, h=17;
+    vector<Color> data(w*h);
+    for(int y=0;y<h;y++)
+        for(int x=0;x<w;x++) data[x+y*w]=pattern(x,y);
+    Image img(h,w,data.data());
+    Surface copied(40,30), iterated(40,30), transposed(40,30);
+    copied.clear(black);
+    iterated.clear(black);
+    transposed.clear(black);
+    copied.drawImage(Point(5,6),img);
+    iterated.clippedDrawImage(Point(5,6),Point(0,0),Point(39,29),img);
+    //Down then right
+    auto it=transposed.begin(Point(5,6),Point(5+w-1,6+h-1),DR);
+    for(int x=0;x<w;x++)
+        for(int y=0;y<h;y++) *it=pattern(x,y);
+    bool ok=it==transposed.end();
+    for(int y=0;y<30;y++)
+        for(int x=0;x<40;x++)
+        {
+            bool inside=x>=5 && x<5+w && y>=6 && y<6+h;
+            Color c=inside ? pattern(x-5,y-6) : black;
+            ok&=copied.getPixels()[x+y*40]==c;
+        }
+    return ok && equal(copied,iterated) && equal(copied,transposed);
+}
+
+/**
+ * Draw the same plot directly on a display and through a surface
+ */
+static bool plot()
+{
+    const short width=240, height=320;
+    Point p1(10,40), p2(229,240);
+    vector<float> data1, data2;
+    for(int i=0;i<100;i++)
+    {
+        data1.push_back(20*(1+0.05*i)*sin(0.1*i));
+        data2.push_back(20*(1+0.05*i));
+    }
+    vector<Dataset> dataset;
+    dataset.push_back(Dataset(data1,red));
+    dataset.push_back(Dataset(data2,green));
+
+    CountingDisplay direct(width,height), blitted(width,height);
+    direct.clear(black);
+    blitted.clear(black);
+    direct.calls=blitted.calls=0;
+    {
+        DrawingContext dc(direct);
+        SimplePlot plot(p1,p2);
+        plot.draw(dc,dataset);
+    }
+
+    Surface surface(p2.x()-p1.x()+1,p2.y()-p1.y()+1);
+    {
+        DrawingContext sdc(surface);
+        SimplePlot plot(Point(0,0),Point(surface.getWidth()-1,
+                                         surface.getHeight()-1));
+        plot.draw(sdc,dataset);
+    }
+    {
+        DrawingContext dc(blitted);
+        surface.blit(dc,p1);
+    }
+    cout<<"Plot: "<<direct.calls<<" drawing calls, "<<blitted.calls
+        <<" when blitted"<<endl;
+    bool ok=equal(direct,blitted) && blitted.calls==1;
+
+    //Blit only part of the surface
+    Surface part(width,height);
+    part.clear(black);
+    {
+        DrawingContext dc(part);
+        surface.blit(dc,Point(p1.x()+10,p1.y()+20),Point(10,20),
+                     Point(surface.getWidth()-11,surface.getHeight()-31));
+    }
+    for(int y=0;y<height;y++)
+        for(int x=0;x<width;x++)
+        {
+            bool inside=x>=p1.x()+10 && x<=p2.x()-10
+                     && y>=p1.y()+20 && y<=p2.y()-30;
+            Color expected=inside ? direct.getPixels()[x+y*width] : black;
+            ok&=part.getPixels()[x+y*width]==expected;
+        }
+    return ok;
+}
+
+/**
+ * Draw in a surface with caller provided memory
+ */
+static bool callerMemory()
+{
+    vector<Color> pixels(16*8+1,blue);
+    {
+        Surface surface(16,8,pixels.data());
+        DrawingContext sdc(surface);
+        sdc.clear(red);
+        sdc.line(Point(0,0),Point(15,7),green);
+        sdc.drawRectangle(Point(2,2),Point(13,5),white);
+        sdc.write(Point(0,0),"Clipped");
+    }
+    //The surface did not write past its size, nor free the memory
+    return pixels[16*8]==blue && pixels[0]!=blue;
+}
+
+int main()
+{
+    check("pixel iterators",iterators());
+    check("plot",plot());
+    check("caller memory",callerMemory());
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "byte_reader.h"
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef _MIOSIX
+#include "miosix.h"
+#include "filesystem/file_access.h"
+#endif //_MIOSIX
+
+//
+// class ByteReader
+//
+
+bool ByteReader::open(const char *filename)
+{
+    close();
+    fd = ::open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    #if defined(_MIOSIX) && defined(WITH_FILESYSTEM)
+    // Files in a RomFs can be accessed in place, with no buffer at all
+    auto file = miosix::getFileDescriptorTable().getFile(fd);
+    if (file) {
+        miosix::MemoryMappedFile mm = file->getFileFromMemory();
+        if (mm.isValid()) {
+            ::close(fd);
+            fd = -1;
+            mapped = reinterpret_cast<const byte*>(mm.data);
+            mappedSize = mm.size;
+            base = pos = mapped;
+            end = mapped + mappedSize;
+            bufferOffset = 0;
+            return true;
+        }
+    }
+    #endif //defined(_MIOSIX) && defined(WITH_FILESYSTEM)
+    buffer = new byte[bufferSize];
+    base = pos = end = buffer;
+    bufferOffset = 0;
+    return true;
+}
+
+void ByteReader::close()
+{
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    delete[] buffer;
+    buffer = nullptr;
+    mapped = nullptr;
+    mappedSize = 0;
+    base = pos = end = nullptr;
+    bufferOffset = 0;
+}
+
+bool ByteReader::seek(std::uint32_t offset)
+{
+    if (mapped) {
+        if (offset > mappedSize) {
+            return false;
+        }
+        pos = mapped + offset;
+        return true;
+    }
+    if (fd < 0) {
+        return false;
+    }
+    // Seeking within the buffer does not need to access the file
+    if (offset >= bufferOffset && offset <= bufferOffset + (end - base)) {
+        pos = base + (offset - bufferOffset);
+        return true;
+    }
+    if (lseek(fd, offset, SEEK_SET) != static_cast<off_t>(offset)) {
+        return false;
+    }
+    bufferOffset = offset;
+    base = pos = end = buffer;
+    return true;
+}
+
+bool ByteReader::refill()
+{
+    if (fd < 0) {
+        return false; // Memory mapped files are never refilled
+    }
+    // Called only when the buffer is exhausted, so the file position is
+    // already tell(), there is no need to seek
+    std::uint32_t offset = tell();
+    ssize_t result = read(fd, buffer, bufferSize);
+    if (result <= 0) {
+        return false;
+    }
+    bufferOffset = offset;
+    base = pos = buffer;
+    end = buffer + result;
+    return true;
+}
@@ -1,74 +1,195 @@
 #ifndef BYTEREADER_H
 #define BYTEREADER_H
-#include <iostream>
-#include <fstream>
-#include <vector>
 #include <cstdint> // Include for specific integer types
 
 using byte = std::uint8_t;
 
-// Helper class to read bits from a byte vector
+// Sequential byte input from a file. If the file is memory mapped, such as
+// files in a RomFs, data is accessed in place, otherwise it is read through a
+// small refill buffer, so memory usage does not depend on the file size
+class ByteReader
+{
+public:
+    ByteReader() = default;
+    ByteReader(const ByteReader&) = delete;
+    ByteReader& operator=(const ByteReader&) = delete;
+    ~ByteReader() { close(); }
+
+    // Open a file, return false on failure
+    bool open(const char *filename);
+
+    // Close the file, if open
+    void close();
+
+    // Return true if a file is open
+    bool isOpen() const { return fd >= 0 || mapped != nullptr; }
+
+    // Return true if the file is accessed in place
+    bool isMemoryMapped() const { return mapped != nullptr; }
+
+    // Return the file data if it is accessed in place, nullptr otherwise
+    const byte *data() const { return mapped; }
+
+    // Return the file size if it is accessed in place, 0 otherwise
+    std::uint32_t size() const { return mappedSize; }
+
+    // Read one byte, or return -1 at end of file
+    int get() {
+        if (pos == end && !refill()) {
+            return -1;
+        }
+        return *pos++;
+    }
+
+    // Skip length bytes
+    void skip(std::uint32_t length) { seek(tell() + length); }
+
+    // Return the offset of the next byte that will be read
+    std::uint32_t tell() const { return bufferOffset + (pos - base); }
+
+    // Move to the given offset from the file start, return false on failure
+    bool seek(std::uint32_t offset);
+
+    // Size of the refill buffer when the file is not memory mapped
+    static const std::uint32_t bufferSize = 512;
+
+private:
+    // Read the next chunk of the file, return false at end of file
+    bool refill();
+
+    int fd = -1;                      // File descriptor, if not memory mapped
+    const byte *mapped = nullptr;     // File data, if memory mapped
+    std::uint32_t mappedSize = 0;     // File size, if memory mapped
+    byte *buffer = nullptr;           // Refill buffer, if not memory mapped
+    const byte *base = nullptr;       // Data at offset bufferOffset
+    const byte *pos = nullptr;        // Next byte to read
+    const byte *end = nullptr;        // One past the last valid byte
+    std::uint32_t bufferOffset = 0;   // File offset of base
+};
+
+// Helper class to read bits from the entropy coded segment of a JPEG file.
+// Removes the byte stuffing (0xFF00) on the fly, and stops at markers.
+// Bits are kept in a word sized buffer, so that peeking at up to 16 bits
+// for the Huffman lookup tables does not require touching the file
 class BitReader
 {
 private:
-    std::uint32_t nextByte = 0;
-    std::uint32_t nextBit = 0;
-    const std::vector<byte>* data = nullptr;  // Use a pointer to allow for late initialization
+#if UINTPTR_MAX > 0xFFFFFFFF
+    using word = std::uint64_t;
+#else
+    using word = std::uint32_t;
+#endif
+    static const int wordBits = sizeof(word) * 8;
+
+    ByteReader* reader = nullptr;  // Use a pointer to allow for late initialization
+    word buffer = 0;               // Buffered bits, left aligned
+    int count = 0;                 // Number of bits in buffer
+    int padding = 0;               // Zero bits appended past the end of data
+    int marker = -1;               // Marker found in the data, -1 if none
+
+    // Fetch the next byte of entropy coded data, return -1 at a marker
+    int fetch() {
+        if (marker != -1 || !reader) {
+            return -1;
+        }
+        int c = reader->get();
+        if (c == 0xFF) {
+            int next = reader->get();
+            while (next == 0xFF) next = reader->get(); // Fill bytes
+            if (next != 0x00) {
+                marker = next;
+                return -1;
+            }
+        }
+        return c;
+    }
+
+    // Fill the bit buffer. Past a marker zero bits are appended, keeping
+    // track of them so that reading them is reported as an error
+    void fill() {
+        while (count <= wordBits - 8) {
+            int c = fetch();
+            if (c == -1) {
+                c = 0;
+                padding += 8;
+            }
+            buffer |= static_cast<word>(c) << (wordBits - 8 - count);
+            count += 8;
+        }
+    }
 
 public:
     // Default constructor
     BitReader() = default;
 
-    // Allow setting the data vector after construction
-    void setData(const std::vector<byte>& d) {
-        data = &d;
+    // Start reading entropy coded data from the current position of reader
+    void setSource(ByteReader* r) {
+        reset();
+        reader = r;
     }
 
-    // Read one bit (0 or 1) or return -1 if all bits have already been read
-    int readBit() {
-        if (!data || nextByte >= data->size()) {
-            return -1;
+    // Return the next length bits without consuming them, length <= 16.
+    // Past the end of data the missing bits read as zero
+    std::uint32_t peekBits(int length) {
+        if (count < length) {
+            fill();
         }
-        int bit = ((*data)[nextByte] >> (7 - nextBit)) & 1;
-        nextBit++;
-        if (nextBit == 8) {
-            nextBit = 0;
-            nextByte++;
+        return static_cast<std::uint32_t>(buffer >> (wordBits - length));
+    }
+
+    // Consume length bits, previously returned by peekBits().
+    // Return false if they were past the end of data
+    bool skipBits(int length) {
+        if (length > count - padding) {
+            return false;
         }
-        return bit;
+        buffer <<= length;
+        count -= length;
+        return true;
+    }
+
+    // Read one bit (0 or 1) or return -1 if all bits have already been read
+    int readBit() {
+        return readBits(1);
     }
 
-    // Read a variable number of bits
+    // Read a variable number of bits, up to 16
     // The first read bit is the most significant bit
     // Return -1 if at any point all bits have already been read
-    int readBits(std::uint32_t length) {
-        int bits = 0;
-        for (std::uint32_t i = 0; i < length; ++i) {
-            int bit = readBit();
-            if (bit == -1) {
-                return -1;
-            }
-            bits = (bits << 1) | bit;
+    int readBits(int length) {
+        if (length == 0) {
+            return 0;
         }
-        return bits;
+        int bits = peekBits(length);
+        return skipBits(length) ? bits : -1;
     }
 
     // If there are any bits remaining, advance to the 0th bit of the next byte
     void align() {
-        if (!data || nextByte >= data->size()) {
-            return;
-        }
-        if (nextBit != 0) {
-            nextBit = 0;
-            nextByte++;
+        skipBits(count % 8);
+    }
+
+    // Skip to the data after the next restart marker, return false if the
+    // next marker is not a restart marker
+    bool restart() {
+        // Only the padding to the byte boundary should be left before the
+        // marker, anything else is skipped
+        buffer = 0;
+        count = padding = 0;
+        if (marker == -1) {
+            while (fetch() != -1) ; // Skip anything before the marker
         }
+        bool result = marker >= 0xD0 && marker <= 0xD7;
+        marker = -1;
+        return result;
     }
 
-    // If there are any bits remaining, advance to the 0th bit of the next byte
+    // Detach from the data source
     void reset() {
-        nextByte = 0;
-     nextBit = 0;
-     data = nullptr; 
+        reader = nullptr;
+        buffer = 0;
+        count = padding = 0;
+        marker = -1;
     }
 };
 
@@ -103,6 +103,15 @@ static const unsigned int level2MaxNumApps=4;
 //Default font
 #define defaultFont droid11
 
+///
+/// Inverse DCT used by the JPEG decoder, choose ONE of these.
+/// The integer ones do not require an FPU, and the fast one trades some
+/// accuracy for speed. The float one is slower even with an FPU
+///
+#define MXGUI_JPEG_IDCT_ISLOW
+//#define MXGUI_JPEG_IDCT_IFAST
+//#define MXGUI_JPEG_IDCT_FLOAT
+
 #else //_MIOSIX
 
 // Enable or disable level 2.
@@ -157,6 +166,13 @@ static const unsigned int SIMULATOR_BGCOLOR=0;
 //Default font
 #define defaultFont droid11
 
+//
+// Inverse DCT used by the JPEG decoder, choose ONE of these
+//
+#define MXGUI_JPEG_IDCT_ISLOW
+//#define MXGUI_JPEG_IDCT_IFAST
+//#define MXGUI_JPEG_IDCT_FLOAT
+
 #endif //_MIOSIX
 
 } //namespace mxgui
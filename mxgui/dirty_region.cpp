@@ -0,0 +1,93 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "dirty_region.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace mxgui {
+
+//
+// class DirtyRegion
+//
+
+void DirtyRegion::add(Point p1, Point p2)
+{
+    for(int i=0;i<count;i++)
+        if(contains(rects[i],p1) && contains(rects[i],p2)) return;
+    Rect r={p1,p2};
+    for(;;)
+    {
+        //Merge with all the rectangles that cost nothing to merge, such as
+        //the ones contained in r, or adjacent ones of the same height or
+        //width. Merging grows r, so start over every time
+        for(int i=0;i<count;)
+        {
+            Rect merged=boundingBox(r,rects[i]);
+            if(merged.area()<=r.area()+rects[i].area())
+            {
+                r=merged;
+                remove(i);
+                i=0;
+            } else i++;
+        }
+        if(count<maxRects) break;
+        //No room, merge with the rectangle that adds the fewest pixels
+        int best=0;
+        int bestCost=boundingBox(r,rects[0]).area()-rects[0].area();
+        for(int i=1;i<count;i++)
+        {
+            int cost=boundingBox(r,rects[i]).area()-rects[i].area();
+            if(cost<bestCost)
+            {
+                best=i;
+                bestCost=cost;
+            }
+        }
+        r=boundingBox(r,rects[best]);
+        remove(best);
+    }
+    rects[count++]=r;
+}
+
+int DirtyRegion::area() const
+{
+    int result=0;
+    for(int i=0;i<count;i++) result+=rects[i].area();
+    return result;
+}
+
+DirtyRegion::Rect DirtyRegion::boundingBox(const Rect& a, const Rect& b)
+{
+    Rect result;
+    result.p1=Point(min(a.p1.x(),b.p1.x()),min(a.p1.y(),b.p1.y()));
+    result.p2=Point(max(a.p2.x(),b.p2.x()),max(a.p2.y(),b.p2.y()));
+    return result;
+}
+
+} //namespace mxgui
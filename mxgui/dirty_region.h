@@ -0,0 +1,142 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef DIRTY_REGION_H
+#define DIRTY_REGION_H
+
+#include "point.h"
+
+namespace mxgui {
+
+/**
+ * \internal
+ * The parts of a framebuffer that were drawn since the last time it was copied
+ * to the display, as a small set of rectangles. Framebuffer display drivers
+ * add to it the area touched by every drawing primitive, so that update() only
+ * needs to copy those rectangles instead of the whole framebuffer.
+ * Rectangles are merged when doing so does not increase the number of pixels
+ * to copy, and when there is no room for another rectangle the two that are
+ * cheapest to merge are merged, so pixels that were not drawn may be copied,
+ * but pixels that were drawn are never missed.
+ */
+class DirtyRegion
+{
+public:
+    /**
+     * A rectangle, with both corners included
+     */
+    struct Rect
+    {
+        Point p1; ///< Upper left corner
+        Point p2; ///< Lower right corner
+
+        /**
+         * \return the number of pixels in the rectangle
+         */
+        int area() const { return (p2.x()-p1.x()+1)*(p2.y()-p1.y()+1); }
+    };
+
+    /**
+     * Constructor, the region is initially empty
+     */
+    DirtyRegion() : count(0) {}
+
+    /**
+     * Add a rectangle to the region
+     * \param p1 upper left corner
+     * \param p2 lower right corner
+     */
+    void add(Point p1, Point p2);
+
+    /**
+     * Add a pixel to the region
+     * \param p pixel
+     */
+    void add(Point p)
+    {
+        //Drawing usually proceeds near the previous pixel, so the common case
+        //is a pixel already in the region
+        for(int i=0;i<count;i++) if(contains(rects[i],p)) return;
+        add(p,p);
+    }
+
+    /**
+     * \return the number of rectangles in the region
+     */
+    int size() const { return count; }
+
+    /**
+     * \return true if nothing was drawn
+     */
+    bool empty() const { return count==0; }
+
+    /**
+     * \param i rectangle index, from 0 to size()-1
+     * \return the i-th rectangle
+     */
+    const Rect& operator[](int i) const { return rects[i]; }
+
+    /**
+     * \return the number of pixels in the region
+     */
+    int area() const;
+
+    /**
+     * Make the region empty, to be called after it has been copied
+     */
+    void clear() { count=0; }
+
+    /// Maximum number of rectangles, more are merged together
+    static const int maxRects=4;
+
+private:
+    /**
+     * \return true if p is in r
+     */
+    static bool contains(const Rect& r, Point p)
+    {
+        return p.x()>=r.p1.x() && p.x()<=r.p2.x()
+            && p.y()>=r.p1.y() && p.y()<=r.p2.y();
+    }
+
+    /**
+     * \return the smallest rectangle containing both a and b
+     */
+    static Rect boundingBox(const Rect& a, const Rect& b);
+
+    /**
+     * Remove the i-th rectangle
+     */
+    void remove(int i) { rects[i]=rects[--count]; }
+
+    Rect rects[maxRects];
+    int count;
+};
+
+} //namespace mxgui
+
+#endif //DIRTY_REGION_H
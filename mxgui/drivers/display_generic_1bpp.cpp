@@ -61,6 +61,7 @@ void DisplayGeneric1BPP::clippedWrite(Point p, Point a, Point b, const char *tex
 
 void DisplayGeneric1BPP::clear(Color color)
 {
+    dirty.add(Point(0,0),Point(width-1,height-1));
     memset(backbuffer,conv2(color),fbSize);
 }
 
@@ -68,7 +69,7 @@ void DisplayGeneric1BPP::clear(Point p1, Point p2, Color color)
 {
     if(p1.x()<0 || p2.x()<p1.x() || p2.x()>=width
      ||p1.y()<0 || p2.y()<p1.y() || p2.y()>=height) return;
-    
+    dirty.add(p1,p2);
     //Vertical line is the most optimized
     for(short x=p1.x();x<=p2.x();x++) line(Point(x,p1.y()),Point(x,p2.y()),color);
 }
@@ -77,8 +78,9 @@ void DisplayGeneric1BPP::beginPixel() {}
 
 void DisplayGeneric1BPP::setPixel(Point p, Color color)
 {
+    if(p.x()<0 || p.x()>=width || p.y()<0 || p.y()>=height) return;
+    dirty.add(p);
     int offset=p.x()+(p.y()/8)*width;
-    if(offset<0 || offset>=fbSize) return;
     //TODO: optimize with bit banding
     if(color) backbuffer[offset] |=  (1<<(p.y() & 0x7));
     else      backbuffer[offset] &= ~(1<<(p.y() & 0x7));
@@ -92,6 +94,7 @@ void DisplayGeneric1BPP::line(Point a, Point b, Color color)
         short minx=min(a.x(),b.x());
         short maxx=max(a.x(),b.x());
         if(minx<0 || maxx>=width || a.y()<0 || a.y()>=height) return;
+        dirty.add(Point(minx,a.y()),Point(maxx,a.y()));
         for(short x=minx;x<=maxx;x++) doSetPixel(x,a.y(),color);
         return;
     }
@@ -101,6 +104,7 @@ void DisplayGeneric1BPP::line(Point a, Point b, Color color)
         short miny=min(a.y(),b.y());
         short maxy=max(a.y(),b.y())+1;
         if(a.x()<0 || a.x()>=width || miny<0 || maxy>height) return;
+        dirty.add(Point(a.x(),miny),Point(a.x(),maxy-1));
         if(maxy-miny<8) for(short y=miny;y<maxy;y++) doSetPixel(a.x(),y,color);
         else {
             short minyaligned=(miny+7) & ~0x7;
@@ -123,7 +127,8 @@ void DisplayGeneric1BPP::line(Point a, Point b, Color color)
 void DisplayGeneric1BPP::scanLine(Point p, const Color *colors, unsigned short length)
 {
     if(p.x()<0 || static_cast<int>(p.x())+static_cast<int>(length)>width
-        ||p.y()<0 || p.y()>=height) return;
+        ||p.y()<0 || p.y()>=height || length==0) return;
+    dirty.add(p,Point(p.x()+length-1,p.y()));
     for(short x=0;x<length;x++) doSetPixel(p.x()+x,p.y(),colors[x]);
 }
 
@@ -143,6 +148,7 @@ void DisplayGeneric1BPP::drawImage(Point p, const ImageBase& img)
     short int yEnd=p.y()+img.getHeight()-1;
     if(p.x()<0 || p.y()<0 || xEnd<p.x() || yEnd<p.y()
         ||xEnd >= width || yEnd >= height) return;
+    dirty.add(p,Point(xEnd,yEnd));
 
 //    const unsigned short *imgData=img.getData();
 //    if(imgData!=0)
@@ -183,6 +189,7 @@ DisplayGeneric1BPP::pixel_iterator DisplayGeneric1BPP::begin(Point p1, Point p2,
         this->last=pixel_iterator();
         return this->last;
     }
+    dirty.add(p1,p2);
 
     //Set the last iterator to a suitable one-past-the last value
     if(d==DR) this->last=pixel_iterator(Point(p2.x()+1,p1.y()),p2,d,this);
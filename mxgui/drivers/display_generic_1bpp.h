@@ -32,6 +32,7 @@
 #include "point.h"
 #include "color.h"
 #include "iterator_direction.h"
+#include "dirty_region.h"
 #include <cstdio>
 #include <cstring>
 #include <algorithm>
@@ -48,7 +49,9 @@ namespace mxgui {
  * - the implementation for the doTurnOn(), doTurnOff() and doSetBrightness()
  *   member functions
  * - the update() member function which shall copy the backbuffer which is in
- *   the microcontroller memory to the display memory
+ *   the microcontroller memory to the display memory. Only the rectangles in
+ *   dirty need to be copied, as the rest of the backbuffer was not drawn since
+ *   the previous update(), and dirty shall then be cleared
  */
 class DisplayGeneric1BPP : public Display
 {
@@ -305,6 +308,7 @@ protected:
     const int fbSize; //Framebuffer is 1 bit per pixel
 
     unsigned char *backbuffer; ///< Display backbuffer (frontbuffer is in the display chip)
+    DirtyRegion dirty;         ///< Parts of the backbuffer drawn since update()
 
 private:
 
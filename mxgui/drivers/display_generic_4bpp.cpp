@@ -64,6 +64,7 @@ void DisplayGeneric4BPP::clippedWrite(Point p, Point a, Point b, const char *tex
 
 void DisplayGeneric4BPP::clear(Color color)
 {
+    dirty.add(Point(0,0),Point(width-1,height-1));
     memset(backbuffer,conv2(color),fbSize);
 }
 
@@ -71,7 +72,7 @@ void DisplayGeneric4BPP::clear(Point p1, Point p2, Color color)
 {
     if(p1.x()<0 || p2.x()<p1.x() || p2.x()>=width
      ||p1.y()<0 || p2.y()<p1.y() || p2.y()>=height) return;
-    
+    dirty.add(p1,p2);
     //Horizontal line is memeset-optimized
     for(short y=p1.y();y<=p2.y();y++) line(Point(p1.x(),y),Point(p2.x(),y),color);
 }
@@ -80,8 +81,9 @@ void DisplayGeneric4BPP::beginPixel() {}
 
 void DisplayGeneric4BPP::setPixel(Point p, Color color)
 {
+    if(p.x()<0 || p.x()>=width || p.y()<0 || p.y()>=height) return;
+    dirty.add(p);
     int offset=(p.x()+p.y()*width)/2;
-    if(offset<0 || offset>=fbSize) return;
     if(p.x() & 1)
         backbuffer[offset]=(backbuffer[offset] & 0b11110000) | conv1(color);
     else
@@ -96,6 +98,7 @@ void DisplayGeneric4BPP::line(Point a, Point b, Color color)
         short minx=min(a.x(),b.x());
         short maxx=max(a.x(),b.x())+1;
         if(minx<0 || maxx>width || a.y()<0 || a.y()>=height) return;
+        dirty.add(Point(minx,a.y()),Point(maxx-1,a.y()));
         unsigned char c1=conv1(color), c2=conv2(color);
         if(minx & 1) doSetPixel(minx,a.y(),c1);
         short minxaligned=minx & 1 ? minx+1 : minx;
@@ -110,6 +113,7 @@ void DisplayGeneric4BPP::line(Point a, Point b, Color color)
         short miny=min(a.y(),b.y());
         short maxy=max(a.y(),b.y());
         if(a.x()<0 || a.x()>=width || miny<0 || maxy>=height) return;
+        dirty.add(Point(a.x(),miny),Point(a.x(),maxy));
         unsigned char *ptr=backbuffer+(a.x()+width*miny)/2;
         if(a.x() & 1)
         {
@@ -136,7 +140,8 @@ void DisplayGeneric4BPP::line(Point a, Point b, Color color)
 void DisplayGeneric4BPP::scanLine(Point p, const Color *colors, unsigned short length)
 {
     if(p.x()<0 || static_cast<int>(p.x())+static_cast<int>(length)>width
-        ||p.y()<0 || p.y()>=height) return;
+        ||p.y()<0 || p.y()>=height || length==0) return;
+    dirty.add(p,Point(p.x()+length-1,p.y()));
     for(short x=0;x<length;x++) doSetPixel(p.x()+x,p.y(),conv1(colors[x]));
 }
 
@@ -156,6 +161,7 @@ void DisplayGeneric4BPP::drawImage(Point p, const ImageBase& img)
     short int yEnd=p.y()+img.getHeight()-1;
     if(p.x()<0 || p.y()<0 || xEnd<p.x() || yEnd<p.y()
         ||xEnd >= width || yEnd >= height) return;
+    dirty.add(p,Point(xEnd,yEnd));
 
 //    const unsigned short *imgData=img.getData();
 //    if(imgData!=0)
@@ -196,6 +202,7 @@ DisplayGeneric4BPP::pixel_iterator DisplayGeneric4BPP::begin(Point p1, Point p2,
         this->last=pixel_iterator();
         return this->last;
     }
+    dirty.add(p1,p2);
 
     //Set the last iterator to a suitable one-past-the last value
     if(d==DR) this->last=pixel_iterator(Point(p2.x()+1,p1.y()),p2,d,this);
@@ -80,15 +80,26 @@ public:
      */
     void update() override
     {
-        //Takes ~21ms
-        cmd(0x21); cmd(0); cmd(127);
-        cmd(0x22); cmd(0); cmd(3);
-        
-        i2c::sendStart();
-        if(i2c::send(ADDR)==0) { i2c::sendStop(); return; }
-        i2c::send(GDATA);
-        for(int i=0;i<fbSize;i++) i2c::send(backbuffer[i]);
-        i2c::sendStop();
+        //Takes ~21ms for the whole screen, so only send the dirty part.
+        //Every byte is a column of 8 pixels of a page, so send whole pages
+        for(int i=0;i<dirty.size();i++)
+        {
+            short x1=dirty[i].p1.x(), x2=dirty[i].p2.x();
+            short page1=dirty[i].p1.y()/8, page2=dirty[i].p2.y()/8;
+            cmd(0x21); cmd(x1); cmd(x2);
+            cmd(0x22); cmd(page1); cmd(page2);
+
+            i2c::sendStart();
+            if(i2c::send(ADDR)==0) { i2c::sendStop(); return; }
+            i2c::send(GDATA);
+            for(short page=page1;page<=page2;page++)
+            {
+                const unsigned char *row=backbuffer+page*width;
+                for(short x=x1;x<=x2;x++) i2c::send(row[x]);
+            }
+            i2c::sendStop();
+        }
+        dirty.clear();
     }
     
 private:
@@ -32,6 +32,7 @@
 #include "_tools/qtsimulator/window.h"
 #include "line.h"
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -114,6 +115,7 @@ void DisplayImpl::clear(Point p1, Point p2, Color color)
     if(p2.x()<p1.x() || p2.y()<p1.y())
         throw(logic_error("DisplayImpl::clear: p2<p1"));
     
+    dirty.add(p1,p2);
     FrameBuffer& fb=backend.getFrameBuffer();
     for(int i=p1.x();i<=p2.x();i++)
         for(int j=p1.y();j<=p2.y();j++) fb.setPixel(i,j,color);
@@ -135,6 +137,7 @@ void DisplayImpl::setPixel(Point p, Color color)
     if(p.x()>=width || p.y()>=height)
         throw(logic_error("DisplayImpl::setPixel: point outside display bounds"));
 
+    dirty.add(p);
     backend.getFrameBuffer().setPixel(p.x(),p.y(),color);
 }
 
@@ -146,6 +149,9 @@ void DisplayImpl::line(Point a, Point b, Color color)
     if(a.x()>=width || a.y()>=height || b.x()>=width || b.y()>=height)
         throw(logic_error("DisplayImpl::line: point outside display bounds"));
     
+    //Adding the pixels of the line one at a time would be slower
+    dirty.add(Point(min(a.x(),b.x()),min(a.y(),b.y())),
+              Point(max(a.x(),b.x()),max(a.y(),b.y())));
     Line::draw(*this,a,b,color);
     beginPixelCalled=false;
 }
@@ -214,8 +220,9 @@ void DisplayImpl::drawRectangle(Point a, Point b, Color c)
 }
 
 void DisplayImpl::update()
-{  
-    backend.getSender()->update();
+{
+    if(dirty.empty()==false) backend.getSender()->update(dirty);
+    dirty.clear();
     beginPixelCalled=false;
 }
 
@@ -233,6 +240,7 @@ DisplayImpl::pixel_iterator DisplayImpl::begin(Point p1, Point p2, IteratorDirec
     if(d==DR) this->last=pixel_iterator(Point(p2.x()+1,p1.y()),p2,d,this);
     else this->last=pixel_iterator(Point(p1.x(),p2.y()+1),p2,d,this);
 
+    dirty.add(p1,p2);
     beginPixelCalled=false;
     return pixel_iterator(p1,p2,d,this);
 }
@@ -42,6 +42,7 @@
 #include "font.h"
 #include "image.h"
 #include "iterator_direction.h"
+#include "dirty_region.h"
 #include "_tools/qtsimulator/qtbackend.h"
 #include <stdexcept>
 
@@ -197,7 +198,9 @@ public:
 
     /**
      * Make all changes done to the display since the last call to update()
-     * visible. This backends require it.
+     * visible. This backends require it. Only the parts of the framebuffer
+     * that were drawn are copied to the screen, and
+     * QTBackend::getBytesTransferred() counts the copied bytes
      */
     void update() override;
 
@@ -335,6 +338,7 @@ private:
     pixel_iterator last; ///< Last iterator for end of iteration check
     QTBackend& backend; ///< Backend which contains the framebuffer
     bool beginPixelCalled; ///< Used to check for beginPixel calls
+    DirtyRegion dirty; ///< Parts of the framebuffer drawn since update()
 };
 
 } //namespace mxgui
@@ -30,11 +30,77 @@
 #include "miosix.h"
 #include "misc_inst.h"
 #include "line.h"
+#include <kernel/scheduler/scheduler.h>
+#include <algorithm>
 #include <cstdarg>
 
 using namespace std;
 using namespace miosix;
 
+/**
+ * DMA1 stream 4 IRQ, configured as SPI2 TX
+ */
+void __attribute__((naked)) DMA1_Stream4_IRQHandler()
+{
+    saveContext();
+    asm volatile("bl _Z13spi2txDmaImplv");
+    restoreContext();
+}
+
+static Thread *waiting=nullptr;        //Thread waiting for the DMA to complete
+static volatile bool dmaBusy=false;    //DMA transfer is in progress
+static const unsigned short *dmaNext;  //Pixels of the next DMA chunk
+static unsigned int dmaLeft=0;         //Pixels left after the current chunk
+static bool dmaIncrement;              //False if sending one pixel repeatedly
+
+/**
+ * Start sending the next chunk of pixels, as the DMA can transfer at most
+ * 65535 items at a time
+ */
+static void IRQstartDmaChunk()
+{
+    unsigned int n=min(dmaLeft,65535u);
+    DMA1_Stream4->PAR=reinterpret_cast<unsigned int>(&SPI2->DR);
+    DMA1_Stream4->M0AR=reinterpret_cast<unsigned int>(dmaNext);
+    DMA1_Stream4->NDTR=n;
+    if(dmaIncrement) dmaNext+=n;
+    dmaLeft-=n;
+    DMA1_Stream4->CR=DMA_SxCR_PL_1    //High priority because fifo disabled
+                   | DMA_SxCR_MSIZE_0 //Read 16 bit from memory
+                   | DMA_SxCR_PSIZE_0 //Write 16 bit to peripheral
+                   | (dmaIncrement ? DMA_SxCR_MINC : 0) //Increment memory pointer
+                   | DMA_SxCR_DIR_0   //Memory to peripheral
+                   | DMA_SxCR_TCIE    //Interrupt on transfer complete
+                   | DMA_SxCR_TEIE    //Interrupt on transfer error
+                   | DMA_SxCR_DMEIE   //Interrupt on direct mode error
+                   | DMA_SxCR_EN;     //Start DMA, channel 0 is SPI2_TX
+}
+
+/**
+ * DMA1 stream 4 IRQ actual implementation
+ */
+void __attribute__((used)) spi2txDmaImpl()
+{
+    unsigned int flags=DMA1->HISR;
+    DMA1->HIFCR=DMA_HIFCR_CTCIF4
+              | DMA_HIFCR_CHTIF4
+              | DMA_HIFCR_CTEIF4
+              | DMA_HIFCR_CDMEIF4
+              | DMA_HIFCR_CFEIF4;
+    if(flags & (DMA_HISR_TEIF4 | DMA_HISR_DMEIF4)) dmaLeft=0;
+    if(dmaLeft>0)
+    {
+        IRQstartDmaChunk();
+        return;
+    }
+    dmaBusy=false;
+    if(waiting==nullptr) return;
+    waiting->IRQwakeup();
+    if(waiting->IRQgetPriority()>Thread::IRQgetCurrentThread()->IRQgetPriority())
+        Scheduler::IRQfindNextThread();
+    waiting=nullptr;
+}
+
 namespace mxgui {
 
 //Control interface
@@ -43,6 +109,12 @@ typedef Gpio<GPIOC_BASE, 3> sda; //SPI MOSI
 typedef Gpio<GPIOC_BASE, 0> dcx; //Data/command
 typedef Gpio<GPIOB_BASE,12> csx; //SPI CS
 
+static const unsigned int spiConfig=SPI_CR1_SSM   //Sowtware CS
+                                  | SPI_CR1_SSI   //Software CS high
+                                  | SPI_CR1_SPE   //SPI enabled
+                                  | (3<<3)        //Divide input clock by 16
+                                  | SPI_CR1_MSTR; //Master mode
+
 /**
  * Send and receive a byte through SPI2
  * \param c byte to send
@@ -55,30 +127,107 @@ static unsigned char spi2sendRev(unsigned char c=0)
     return SPI2->DR;
 }
 
-void sendCmd(unsigned char cmd, int len, ...)
+/**
+ * PixelBus on SPI2. Commands are sent as 8 bit frames by the CPU, pixels as
+ * 16 bit frames by DMA1 stream 4, while the waiting thread sleeps. Only a few
+ * pixels, such as a single one, are sent by the CPU as well.
+ * The DMA can't access the core coupled memory, so pixels must not be there.
+ */
+class Spi2DmaBus : public PixelBus
 {
+public:
+    void sendCommand(unsigned char cmd, const unsigned char *args,
+                     int len) override
+    {
+        dcx::low();
+        csx::low();
+        spi2sendRev(cmd);
+        dcx::high();
+        for(int i=0;i<len;i++) spi2sendRev(args[i]);
+        csx::high();
+    }
 
-    // Send Command
-    dcx::low();
-    csx::low();
-    spi2sendRev(cmd);
-    delayUs(1);
-    dcx::high();
+    void startPixels(unsigned char cmd, const Color *pixels,
+                     unsigned int length, bool repeat) override
+    {
+        dcx::low();
+        csx::low();
+        spi2sendRev(cmd);
+        dcx::high();
+        if(length<=cpuPixels)
+        {
+            //Setting up the DMA and taking its interrupt costs more than
+            //sending a few pixels, such as those of setPixel(), by the CPU
+            for(unsigned int i=0;i<length;i++)
+            {
+                Color c=repeat ? pixels[0] : pixels[i];
+                spi2sendRev(c>>8);
+                spi2sendRev(c & 0xff);
+            }
+            csx::high();
+            return;
+        }
+        //The frame format can only be changed while the SPI is not busy
+        while(SPI2->SR & SPI_SR_BSY) ;
+        SPI2->CR1=0;
+        SPI2->CR2=SPI_CR2_TXDMAEN;
+        SPI2->CR1=spiConfig | SPI_CR1_DFF;
+        dmaActive=true;
+        dmaBusy=true;
+        dmaNext=pixels;
+        dmaLeft=length;
+        dmaIncrement=!repeat;
+        FastInterruptDisableLock dLock;
+        IRQstartDmaChunk();
+    }
+
+    void wait() override
+    {
+        if(dmaActive==false) return;
+        {
+            FastInterruptDisableLock dLock;
+            while(dmaBusy)
+            {
+                waiting=Thread::IRQgetCurrentThread();
+                Thread::IRQenableIrqAndWait(dLock);
+            }
+        }
+        //The DMA completes when the last pixel is written to the SPI
+        while((SPI2->SR & SPI_SR_TXE)==0) ;
+        while(SPI2->SR & SPI_SR_BSY) ;
+        csx::high();
+        SPI2->CR1=0;
+        SPI2->CR2=0;
+        SPI2->CR1=spiConfig;
+        //Nothing was read while sending pixels, clear the overrun flag
+        volatile unsigned int temp=SPI2->DR;
+        temp=SPI2->SR;
+        (void)temp;
+        dmaActive=false;
+    }
+
+private:
+    ///Transfers up to this number of pixels are sent by the CPU
+    static const unsigned int cpuPixels=8;
+    bool dmaActive=false; ///< SPI configured for DMA, needs cleanup
+};
+
+static Spi2DmaBus bus;
 
-    // Send Arguments
+void sendCmd(unsigned char cmd, int len, ...)
+{
+    unsigned char args[16];
     va_list arg;
     va_start(arg,len);
-    for(int i=0;i<len;i++)
-    {   
-        spi2sendRev(va_arg(arg,int));
-        delayUs(1);
-    }
+    for(int i=0;i<len;i++) args[i]=va_arg(arg,int);
     va_end(arg);
-    csx::high();
+    bus.wait();
+    bus.sendCommand(cmd,args,len);
 }
 
 Transaction::Transaction(unsigned char cmd)
 {
+    bus.wait();
     dcx::low();
     csx::low();
     spi2sendRev(cmd);
@@ -146,62 +295,43 @@ void DisplayImpl::clear(Color color)
 
 void DisplayImpl::clear(Point p1, Point p2, Color color)
 {
-    unsigned char lsb = color & 0xFF;
-    unsigned char msb = (color >> 8) & 0xFF;
-
-    imageWindow(p1, p2);
-    int numPixels = (p2.x() - p1.x() + 1) * (p2.y() - p1.y() + 1);
-
-    Transaction t(0x2c);
-    //Send data to write on GRAM
-    for(int i=0; i < numPixels; i++)
-    {
-        t.write(msb);
-        t.write(lsb);
-    }
+    memoryAccess(0x08);
+    pipeline.fill(p1,p2,color);
 }
 
 void DisplayImpl::beginPixel() {}
 
 void DisplayImpl::setPixel(Point p, Color color)
 {
-    unsigned char lsb = color & 0xFF;
-    unsigned char msb = (color >> 8) & 0xFF;
-    sendCmd(0x2c,2,msb,lsb); // RAMWR
+    memoryAccess(0x08);
+    pipeline.fill(p,p,color);
 }
 
 void DisplayImpl::line(Point a, Point b, Color color)
 {
-    // TODO - Horizontal line optimization
-    Line::draw(*this, a, b, color);
+    //Horizontal and vertical lines are rectangles one pixel wide
+    if(a.x()==b.x() || a.y()==b.y())
+    {
+        clear(Point(min(a.x(),b.x()),min(a.y(),b.y())),
+              Point(max(a.x(),b.x()),max(a.y(),b.y())),color);
+    } else Line::draw(*this, a, b, color);
 }
 
 void DisplayImpl::scanLine(Point p, const Color *colors, unsigned short length)
 {
-    imageWindow(p,Point(width-1,p.y()));
-
-    unsigned char lsb = 0x00;
-    unsigned char msb = 0x00;
-
-    Transaction t(0x2c); // RAMWR
-    for (int i = 0; i < length; i++)
-    {
-        lsb = colors[i] & 0xFF;
-        msb = (colors[i] >> 8) & 0xFF;
-        t.write(msb);
-        t.write(lsb);
-    }
+    memoryAccess(0x08);
+    pipeline.scanLine(p,colors,length);
 }
 
 Color* DisplayImpl::getScanLineBuffer()
 {
-    if(buffer == 0) buffer = new Color[getWidth()];
-    return buffer;
+    return pipeline.getScanLineBuffer();
 }
 
 void DisplayImpl::scanLineBuffer(Point p, unsigned short length)
 {
-    scanLine(p, buffer, length);
+    memoryAccess(0x08);
+    pipeline.scanLineBuffer(p,length);
 }
 
 void DisplayImpl::drawImage(Point p, const ImageBase& img)
@@ -213,21 +343,13 @@ void DisplayImpl::drawImage(Point p, const ImageBase& img)
     const unsigned short *imgData = img.getData();
     if(imgData != 0)
     {
-        unsigned char lsb = 0x00;
-        unsigned char msb = 0x00;
-
-        //Optimized version for memory-loaded images
-        imageWindow(p, Point(xEnd, yEnd));
+        //Optimized version for memory-loaded images, sent without copying
+        //them. Wait for the transfer to complete, as the caller may
+        //deallocate the image after this function returns
+        memoryAccess(0x08);
         int numPixels = img.getHeight() * img.getWidth();
-
-        Transaction t(0x2c); // RAMWR
-        for(int i=0; i <= numPixels; i++)
-        {
-            lsb = imgData[i] & 0xFF;
-            msb = (imgData[i] >> 8) & 0xFF;
-            t.write(msb);
-            t.write(lsb);
-        }
+        pipeline.write(p, Point(xEnd, yEnd), imgData, numPixels);
+        pipeline.fence();
     }
     else img.draw(*this,p);
 }
@@ -245,6 +367,11 @@ void DisplayImpl::drawRectangle(Point a, Point b, Color c)
     line(Point(a.x(), b.y()), a, c);
 }
 
+void DisplayImpl::update()
+{
+    pipeline.fence();
+}
+
 DisplayImpl::pixel_iterator DisplayImpl::begin(Point p1, Point p2, IteratorDirection d)
 {
     if(p1.x()<0 || p1.y()<0 || p2.x()<0 || p2.y()<0)
@@ -267,7 +394,7 @@ DisplayImpl::pixel_iterator DisplayImpl::begin(Point p1, Point p2, IteratorDirec
     return pixel_iterator(numPixels);
 }
 
-DisplayImpl::DisplayImpl() : buffer(0)
+DisplayImpl::DisplayImpl() : pipeline(bus,width), mac(0x08)
 {
     // TODO - RCC Sequence needed for PLLSAI? There is no PLLSAI for this MCU
 
@@ -281,14 +408,13 @@ DisplayImpl::DisplayImpl() : buffer(0)
         dcx::mode(Mode::OUTPUT);
         
         RCC->APB1ENR |= RCC_APB1ENR_SPI2EN;      
+        RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
         RCC_SYNC();
     }
+    NVIC_SetPriority(DMA1_Stream4_IRQn,10); //Low priority for DMA
+    NVIC_EnableIRQ(DMA1_Stream4_IRQn);
 
-    SPI2->CR1=SPI_CR1_SSM   //Sowtware CS
-            | SPI_CR1_SSI   //Software CS high
-            | SPI_CR1_SPE   //SPI enabled
-            | (3<<3)        //Divide input clock by 16: 84/16=5.25MHz
-            | SPI_CR1_MSTR; //Master mode
+    SPI2->CR1=spiConfig;
     Thread::sleep(1);
 
     // ILI9341 Configuration
@@ -327,10 +453,7 @@ DisplayImpl::DisplayImpl() : buffer(0)
     imageWindow(Point(0,0), Point(width-1,height-1));
 };
 
-DisplayImpl::~DisplayImpl() 
-{
-    if (buffer) delete[] buffer;
-}
+DisplayImpl::~DisplayImpl() {}
 
 }
 
@@ -37,6 +37,7 @@
 #include "display.h"
 #include "color.h"
 #include "point.h"
+#include "pixel_pipeline.h"
 
 namespace mxgui {
 
@@ -172,13 +173,15 @@ public:
     
     /**
      * \return a buffer of length equal to this->getWidth() that can be used to
-     * render a scanline.
+     * render a scanline. Scanlines are sent in the background, so a new buffer
+     * must be requested after every call to scanLineBuffer(), in order to
+     * render the next scanline while the previous one is being sent.
      */
     Color *getScanLineBuffer() override;
 
     /**
      * Draw the content of the last getScanLineBuffer() on an horizontal line
-     * on the screen.
+     * on the screen. Returns as soon as the transfer has started.
      * \param p starting point of the line
      * \param length length of colors array.
      * p.x()+length must be <= display.width()
@@ -211,6 +214,12 @@ public:
      */
     void drawRectangle(Point a, Point b, Color c) override;
 
+    /**
+     * Wait until all pixels have been sent to the display. Called when a
+     * DrawingContext is destroyed.
+     */
+    void update() override;
+
     class pixel_iterator
     {
     public:
@@ -346,24 +355,19 @@ private:
     #error No orientation defined
     #endif
 
-    Color* buffer; ///< For scanLineBuffer
+    PixelPipeline pipeline; ///< Sends pixels by DMA, with scanline buffers
+    unsigned char mac;      ///< Current value of the memory access control
 
     /**
-     * This member function is used to set the cursor stored in memory, as well as
-     * the SC,SP,EC,EP counters of display driver.
-     * \param p1 top-left point of the rectangle
-     * \param p2 bottom-right point of the rectangle
+     * Set the memory access control register, if it has changed
+     * \param value 0x08 to write left-to-right first, then up-to-down,
+     * 0x28 to write up-to-down first, then left-to-right
      */
-    static inline void window(Point p1, Point p2)
+    inline void memoryAccess(unsigned char value)
     {
-        int SC[] = {p1.x() & 0xff, (p1.x() >> 8) & 0xff};
-        int EC[] = {p2.x() & 0xff, (p2.x() >> 8) & 0xff};
-        int SP[] = {p1.y() & 0xff, (p1.y() >> 8) & 0xff};
-        int EP[] = {p2.y() & 0xff, (p2.y() >> 8) & 0xff};
-
-        sendCmd(0x2a,4,SC[1],SC[0],EC[1],EC[0]); //LCD_COLUMN_ADDR
-        sendCmd(0x2b,4,SP[1],SP[0],EP[1],EP[0]); //LCD_PAGE_ADDR
-        sendCmd(0x2c,0); //LCD_RAMWR
+        if(value==mac) return;
+        mac=value;
+        pipeline.command(0x36,&mac,1); //LCD_MAC
     }
 
     /**
@@ -373,13 +377,13 @@ private:
      * \param p1 upper left corner of the window
      * \param p2 lower right corner of the window
      */
-    static inline void textWindow(Point p1, Point p2)
+    inline void textWindow(Point p1, Point p2)
     {
         #ifdef MXGUI_ORIENTATION_VERTICAL
         // p3 is p2 transposed relative to p1. So that the column and page addresses exchanges
         Point p3(p1.x()+p2.y()-p1.y(),p1.y()+p2.x()-p1.x());
-        window(p1,p3);
-        sendCmd(0x36,1,0x28); //LCD_MAC
+        pipeline.window(p1,p3);
+        memoryAccess(0x28);
         #elif defined MXGUI_ORIENTATION_HORIZONTAL
             #error Not implemented
         #elif defined MXGUI_ORIENTATION_VERTICAL_MIRRORED
@@ -396,11 +400,11 @@ private:
      * \param p1 upper left corner of the window
      * \param p2 lower right corner of the window
      */
-    static inline void imageWindow(Point p1, Point p2)
+    inline void imageWindow(Point p1, Point p2)
     {
         #ifdef MXGUI_ORIENTATION_VERTICAL
-        window(p1,p2);
-        sendCmd(0x36,1,0x08); //LCD_MAC
+        pipeline.window(p1,p2);
+        memoryAccess(0x08);
         #elif defined MXGUI_ORIENTATION_HORIZONTAL
             #error Not implemented
         #elif defined MXGUI_ORIENTATION_VERTICAL_MIRRORED
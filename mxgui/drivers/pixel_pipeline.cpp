@@ -0,0 +1,86 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "pixel_pipeline.h"
+#include <cstring>
+
+namespace mxgui {
+
+//
+// class PixelPipeline
+//
+
+void PixelPipeline::window(Point p1, Point p2)
+{
+    unsigned char columns[]=
+    {
+        static_cast<unsigned char>(p1.x()>>8),
+        static_cast<unsigned char>(p1.x()),
+        static_cast<unsigned char>(p2.x()>>8),
+        static_cast<unsigned char>(p2.x())
+    };
+    unsigned char pages[]=
+    {
+        static_cast<unsigned char>(p1.y()>>8),
+        static_cast<unsigned char>(p1.y()),
+        static_cast<unsigned char>(p2.y()>>8),
+        static_cast<unsigned char>(p2.y())
+    };
+    command(columnAddress,columns,sizeof(columns));
+    command(pageAddress,pages,sizeof(pages));
+}
+
+Color *PixelPipeline::getScanLineBuffer()
+{
+    if(buffers[next]==nullptr) buffers[next]=new Color[width];
+    return buffers[next];
+}
+
+void PixelPipeline::scanLineBuffer(Point p, unsigned short length)
+{
+    write(p,Point(p.x()+length-1,p.y()),buffers[next],length);
+    //The caller renders the next scanline in the other buffer while this one
+    //is being sent. The transfer of the other one has already completed, as
+    //write() waits for it before starting this one
+    next^=1;
+}
+
+void PixelPipeline::scanLine(Point p, const Color *colors,
+                             unsigned short length)
+{
+    memcpy(getScanLineBuffer(),colors,length*sizeof(Color));
+    scanLineBuffer(p,length);
+}
+
+PixelPipeline::~PixelPipeline()
+{
+    bus.wait();
+    delete[] buffers[0];
+    delete[] buffers[1];
+}
+
+} //namespace mxgui
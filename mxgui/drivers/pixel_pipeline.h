@@ -0,0 +1,204 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef MXGUI_LIBRARY
+#error "This is header is private, it can be used only within mxgui."
+#error "If your code depends on a private header, it IS broken."
+#endif //MXGUI_LIBRARY
+
+#ifndef PIXEL_PIPELINE_H
+#define PIXEL_PIPELINE_H
+
+#include "color.h"
+#include "point.h"
+
+namespace mxgui {
+
+/**
+ * Interface to the bus of a display controller that receives commands and
+ * pixels, such as the SPI interface of an ILI9341. Pixel transfers are
+ * asynchronous, so that the CPU can do something else while they are in
+ * progress. Display drivers implement it on top of the hardware, while tests
+ * can implement it on the host.
+ */
+class PixelBus
+{
+public:
+    /**
+     * Send a command and its arguments, returning when they have been sent.
+     * Never called while a pixel transfer is in progress
+     * \param cmd command
+     * \param args command arguments, or nullptr if len is 0
+     * \param len number of arguments
+     */
+    virtual void sendCommand(unsigned char cmd, const unsigned char *args,
+                             int len)=0;
+
+    /**
+     * Send a command followed by pixels, returning as soon as the transfer
+     * has started. Never called while a pixel transfer is in progress
+     * \param cmd command, such as memory write
+     * \param pixels pixels to send, must not be modified until wait() returns
+     * \param length number of pixels
+     * \param repeat if true pixels[0] is sent length times
+     */
+    virtual void startPixels(unsigned char cmd, const Color *pixels,
+                             unsigned int length, bool repeat)=0;
+
+    /**
+     * Wait until the pixel transfer in progress, if any, completes
+     */
+    virtual void wait()=0;
+
+    virtual ~PixelBus() {}
+};
+
+/**
+ * Draws to a display controller that uses the MIPI DCS command set, such as
+ * the ILI9341, overlapping the transfer of pixels with drawing.
+ * Scanlines are rendered alternately in two buffers, so that while one is
+ * being sent the caller can render the next one in the other buffer.
+ * Any command first waits for the transfer in progress, and fence() can be
+ * used to wait for it explicitly, for example before the memory being sent
+ * is modified or deallocated.
+ */
+class PixelPipeline
+{
+public:
+    /**
+     * Constructor
+     * \param bus bus to the display controller
+     * \param width length in pixels of the scanline buffers
+     */
+    PixelPipeline(PixelBus& bus, short width)
+        : bus(bus), width(width), next(0)
+    {
+        buffers[0]=buffers[1]=nullptr;
+    }
+
+    /**
+     * Send a command, after the pixel transfer in progress completes
+     * \param cmd command
+     * \param args command arguments
+     * \param len number of arguments
+     */
+    void command(unsigned char cmd, const unsigned char *args=nullptr,
+                 int len=0)
+    {
+        bus.wait();
+        bus.sendCommand(cmd,args,len);
+    }
+
+    /**
+     * Set the rectangle of the display memory where the next pixels go
+     * \param p1 upper left corner
+     * \param p2 lower right corner
+     */
+    void window(Point p1, Point p2);
+
+    /**
+     * Send pixels to a rectangle of the display memory, without waiting for
+     * them to be sent
+     * \param p1 upper left corner
+     * \param p2 lower right corner
+     * \param pixels pixels to send, that must not be modified or deallocated
+     * until fence() returns
+     * \param length number of pixels
+     */
+    void write(Point p1, Point p2, const Color *pixels, unsigned int length)
+    {
+        window(p1,p2);
+        bus.startPixels(memoryWrite,pixels,length,false);
+    }
+
+    /**
+     * Fill a rectangle of the display memory with a color, without waiting
+     * for the pixels to be sent
+     * \param p1 upper left corner
+     * \param p2 lower right corner
+     * \param color fill color
+     */
+    void fill(Point p1, Point p2, Color color)
+    {
+        window(p1,p2); //Also waits for the previous transfer, that may use fillColor
+        fillColor=color;
+        unsigned int length=(p2.x()-p1.x()+1)*(p2.y()-p1.y()+1);
+        bus.startPixels(memoryWrite,&fillColor,length,true);
+    }
+
+    /**
+     * \return a buffer of width pixels that is not being sent, where to
+     * render the next scanline. It remains valid until scanLineBuffer()
+     */
+    Color *getScanLineBuffer();
+
+    /**
+     * Send the scanline rendered in the last getScanLineBuffer(), without
+     * waiting for it to be sent
+     * \param p starting point of the line
+     * \param length number of pixels
+     */
+    void scanLineBuffer(Point p, unsigned short length);
+
+    /**
+     * Send a scanline, copying it in a buffer so that the caller can reuse
+     * colors as soon as this function returns
+     * \param p starting point of the line
+     * \param colors pixels
+     * \param length number of pixels
+     */
+    void scanLine(Point p, const Color *colors, unsigned short length);
+
+    /**
+     * Wait until all pixels have been sent
+     */
+    void fence() { bus.wait(); }
+
+    /**
+     * Destructor
+     */
+    ~PixelPipeline();
+
+    /// MIPI DCS commands used by the pipeline
+    static const unsigned char columnAddress=0x2a;
+    static const unsigned char pageAddress=0x2b;
+    static const unsigned char memoryWrite=0x2c;
+
+private:
+    PixelPipeline(const PixelPipeline&)=delete;
+    PixelPipeline& operator=(const PixelPipeline&)=delete;
+
+    PixelBus& bus;
+    short width;
+    int next;           ///< Index of the buffer not being sent
+    Color *buffers[2];  ///< Scanline buffers, allocated on first use
+    Color fillColor;    ///< Pixel sent repeatedly by fill()
+};
+
+} //namespace mxgui
+
+#endif //PIXEL_PIPELINE_H
@@ -46,7 +46,9 @@ short int Font::calculateLength(const char *s) const
         short int result=0;
         while(*s!='\0')
         {
-            const char c=*s;
+            //Unsigned like in the drawing engines, or chars above 127
+            //would be considered out of the font
+            const unsigned char c=*s;
             if(c<startChar || c>endChar) result+=widths[0];//Width of startchar
             else result+=widths[c-startChar];
             s++;
@@ -32,6 +32,7 @@
 #include "point.h"
 #include "iterator_direction.h"
 #include <algorithm>
+#include <cstring>
 
 namespace mxgui {
 
@@ -84,7 +85,7 @@ public:
 
     /**
      * Draw a string on a surface.
-     * \param surface an object that provides pixel iterators.
+     * \param surface an object that provides pixel iterators and scanlines.
      * \param colors colors for drawing antialiased text
      * \param p point of the upper left corner where the string will be drawn.
      * \param s string to write
@@ -194,101 +195,68 @@ private:
 
     /*
      * This is one nifty use of C++ templates. For size optimization purposes,
-     * the elements in the font tables can either be 8, 16 or 32 bytes. This
-     * however require 3 specialized algorithms for supporting them that only
-     * differ in the cast from void* to unsigned char*, unsigned short* or
-     * unsigned int*. Putting switch in the inner loop would be out of question
-     * for speed reasons, and that triplication has to be done for each of the
-     * six font drawing algorithms that deal with fixed width, variable width
-     * and antialiased fonts, and their clipped versions.
-     * Instead of writing each of these algorithms three times, it is written
-     * only once using the U template parameter to specialize the code.
-     * In the end, on code size it does nothing worse since the alternative
-     * would have been to write 18 functions by hand, but on code compactness
-     * it allows to write only six functions and let template instantiation
-     * do the boring job.
-     */
-
-    /**
-     * Deal with fixed width (monospace) fonts.
-     * \param first piexl iterator to begin of drawing window
-     * \param x start x coord
-     * \param xEnd end x coord
-     * \param fgcolor foreground color
-     * \param bgcolor background color
-     * \param s string to write
+     * the elements in the font tables can either be 8, 16, 32 or 64 bits. This
+     * however require specialized algorithms for supporting them that only
+     * differ in the cast from void* to unsigned short*, unsigned int* or
+     * unsigned long long*, and in the number of bits per pixel, that is 2 for
+     * antialiased fonts. Putting switch in the inner loop would be out of
+     * question for speed reasons.
+     * Instead of writing the drawing algorithm for each of them, it is written
+     * only once using the U and bpp template parameters to specialize the code,
+     * and template instantiation does the boring job.
      */
-    template<typename T, typename U>
-    void fixedWidthDrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color fgcolor, Color bgcolor,
-            const char *s) const;
 
     /**
-     * Deal with variable width fonts.
-     * \param first piexl iterator to begin of drawing window
-     * \param x start x coord
-     * \param xEnd end x coord
-     * \param fgcolor foreground color
-     * \param bgcolor background color
-     * \param s string to write
-     */
-    template<typename T, typename U>
-    void variableWidthDrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color fgcolor, Color bgcolor,
-            const char *s) const;
-
-    /**
-     * Deal with variable antialiased width fonts.
-     * \param first piexl iterator to begin of drawing window
-     * \param x start x coord
-     * \param xEnd end x coord
+     * Select the drawing engine for the font data.
+     * \param surface surface object providing scanlines
+     * \param p point of the upper left corner where the string will be drawn
+     * \param a upper left corner of non empty intersection
+     * \param b lower right corner of non empty intersection
      * \param colors palette for antialiased drawing
      * \param s string to write
      */
-    template<typename T, typename U>
-    void variableWidthAADrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color colors[4], const char *s) const;
+    template<typename T>
+    void drawingEngine(T& surface, Point p, Point a, Point b,
+            const Color colors[4], const char *s) const;
 
     /**
-     * Deal with fixed width (monospace) fonts and clipped drawing.
-     * \param surface surface object providing pixel iterators.
+     * Draw the visible part of a string. Instead of writing pixels one at a
+     * time through a pixel iterator, the string is rendered in bands of 8
+     * rows, or 4 for antialiased fonts. The font columns of each group of 8
+     * pixels are transposed into one byte per row, or two for antialiased
+     * fonts, that are expanded a nibble at a time through a table into the
+     * surface scanline buffer. Every row is then sent with a single
+     * scanLineBuffer() call.
+     * \param surface surface object providing scanlines
      * \param p point of the upper left corner where the string will be drawn
-     * \param a upper left corner of non empty intersection
-     * \param b lower right corner of non empty intersection
-     * \param fgcolor foreground color
-     * \param bgcolor background color
+     * \param a upper left corner of non empty intersection, within the surface
+     * \param b lower right corner of non empty intersection, within the
+     * surface and not past the end of the string
+     * \param colors palette for antialiased drawing, fonts that are not
+     * antialiased use only colors[0] as background and colors[3] as foreground
      * \param s string to write
      */
-    template<typename T, typename U>
-    void fixedWidthClippedDrawingEngine(T& surface, Point p, Point a, Point b,
-            Color fgcolor, Color bgcolor, const char *s) const;
+    template<typename T, typename U, int bpp>
+    void spanDrawingEngine(T& surface, Point p, Point a, Point b,
+            const Color colors[4], const char *s) const;
 
     /**
-     * Deal with variable width fonts and clipped drawing.
-     * \param surface surface object providing pixel iterators.
-     * \param p point of the upper left corner where the string will be drawn
-     * \param a upper left corner of non empty intersection
-     * \param b lower right corner of non empty intersection
-     * \param fgcolor foreground color
-     * \param bgcolor background color
-     * \param s string to write
+     * Transpose an 8x8 bit matrix
+     * \param in in[i] bit j is column i, row j
+     * \param out out[j*stride] bit i is column i, row j
+     * \param stride distance between the output bytes
      */
-    template<typename T, typename U>
-    void variableWidthClippedDrawingEngine(T& surface, Point p, Point a,
-            Point b, Color fgcolor, Color bgcolor, const char *s) const;
+    static void transpose8(const unsigned char in[8], unsigned char *out,
+            int stride);
 
     /**
-     * Deal with variable antialiased width fonts and clipped drawing.
-     * \param surface surface object providing pixel iterators.
-     * \param p point of the upper left corner where the string will be drawn
-     * \param a upper left corner of non empty intersection
-     * \param b lower right corner of non empty intersection
-     * \param colors palette for antialiased drawing
-     * \param s string to write
+     * Transpose a 4x4 matrix of 2 bit elements
+     * \param in in[i] bits 2j and 2j+1 are column i, row j
+     * \param out out[j*stride] bits 2i and 2i+1 are column i, row j
+     * \param stride distance between the output bytes
      */
-    template<typename T, typename U>
-    void variableWidthClippedAADrawingEngine(T& surface, Point p, Point a,
-            Point b, Color colors[4], const char *s) const;
+    static void transpose4x4(const unsigned char in[4], unsigned char *out,
+            int stride);
 
     unsigned char startChar;
     unsigned char endChar;
@@ -306,46 +274,14 @@ void Font::draw(T& surface, Color colors[4], Point p, const char *s) const
 {
     //If no Y space to draw font, stop
     if(p.y()+height>surface.getHeight()) return;
-    //If no X space to draw font, draw it until the screen margin reached
-    typename T::pixel_iterator it;
-    it=surface.begin(p,Point(surface.getWidth()-1,p.y()+height-1),DR);
-    // For code size minimization not all the combinations of 8,16,32,64 bit
-    // fixed, variable width and antialiased fonts are supported, but only these
-    //  8 bit : none (too small for large displays)
-    // 16 bit : fixedWidth, variableWidth
-    // 32 bit : fixedWidth, variableWidth, variableWidthAntialiased
-    // 64 bit : variableWidthAntialiased
-    switch(dataSize)
-    {
-        case 16:
-            if(isAntialiased()) return;
-            if(isFixedWidth())
-                fixedWidthDrawingEngine<T,unsigned short>(it,
-                        p.x(),surface.getWidth(),colors[3],colors[0],s);
-            else variableWidthDrawingEngine<T,unsigned short>(it,
-                        p.x(),surface.getWidth(),colors[3],colors[0],s);
-            break;
-        case 32:
-            if(isAntialiased())
-            {
-                if(isFixedWidth()) return;
-                variableWidthAADrawingEngine<T,unsigned int>(it,
-                            p.x(),surface.getWidth(),colors,s);
-            } else {
-                if(isFixedWidth())
-                    fixedWidthDrawingEngine<T,unsigned int>(it,
-                            p.x(),surface.getWidth(),colors[3],colors[0],s);
-                else variableWidthDrawingEngine<T,unsigned int>(it,
-                            p.x(),surface.getWidth(),colors[3],colors[0],s);
-            }
-            break;
-        case 64:
-            if(isAntialiased()==false || isFixedWidth()) return;
-            variableWidthAADrawingEngine<T,unsigned long long>(it,
-                            p.x(),surface.getWidth(),colors,s);
-            break;
-    }
-    it.invalidate(); //May not fill the requested window
+    if(p.x()<0 || p.y()<0 || p.x()>=surface.getWidth()) return;
+    //If no X space to draw font, draw it until the screen margin reached.
+    //The drawn area ends with the text, so that displays that keep track of
+    //the area that was drawn do not account for the rest of the line
+    short length=calculateLength(s);
+    if(length<=0) return;
+    short xEnd=std::min<int>(surface.getWidth()-1,p.x()+length-1);
+    drawingEngine(surface,p,p,Point(xEnd,p.y()+height-1),colors,s);
 }
 
 template<typename T>
@@ -354,14 +290,24 @@ void Font::clippedDraw(T& surface, Color colors[4],
 {
     using namespace std;
     //Find rectangle which is the non-empty intersection of the image rectangle
-    //with the clip rectangle
-    short ya=max(p.y(),a.y());
-    short yb=min<short>(p.y()+this->getHeight()-1,b.y());
+    //with the clip rectangle and the surface
+    short ya=max<short>(max(p.y(),a.y()),0);
+    short yb=min<int>(min<int>(p.y()+this->getHeight()-1,b.y()),
+                      surface.getHeight()-1);
     if(ya>yb) return; //Empty intersection
 
-    if(p.x()>b.x()) return; //Empty intersection
-    short xa=max(p.x(),a.x());
+    short xa=max<short>(max(p.x(),a.x()),0);
+    short xb=min<int>(min<int>(p.x()+calculateLength(s)-1,b.x()),
+                      surface.getWidth()-1);
+    if(xa>xb) return; //Empty intersection
+
+    drawingEngine(surface,p,Point(xa,ya),Point(xb,yb),colors,s);
+}
 
+template<typename T>
+void Font::drawingEngine(T& surface, Point p, Point a, Point b,
+        const Color colors[4], const char *s) const
+{
     // For code size minimization not all the combinations of 8,16,32,64 bit
     // fixed, variable width and antialiased fonts are supported, but only these
     //  8 bit : none (too small for large displays)
@@ -372,343 +318,165 @@ void Font::clippedDraw(T& surface, Color colors[4],
     {
         case 16:
             if(isAntialiased()) return;
-            if(isFixedWidth())
-                fixedWidthClippedDrawingEngine<T,unsigned short>(surface,p,
-                        Point(xa,ya),Point(b.x(),yb),colors[3],colors[0],s);
-            else variableWidthClippedDrawingEngine<T,unsigned short>(surface,p,
-                        Point(xa,ya),Point(b.x(),yb),colors[3],colors[0],s);
+            spanDrawingEngine<T,unsigned short,1>(surface,p,a,b,colors,s);
             break;
         case 32:
             if(isAntialiased())
             {
                 if(isFixedWidth()) return;
-                variableWidthClippedAADrawingEngine<T,unsigned int>(surface,p,
-                        Point(xa,ya),Point(b.x(),yb),colors,s);
-            } else {
-                if(isFixedWidth())
-                    fixedWidthClippedDrawingEngine<T,unsigned int>(surface,p,
-                        Point(xa,ya),Point(b.x(),yb),colors[3],colors[0],s);
-                else variableWidthClippedDrawingEngine<T,unsigned int>(surface,
-                        p,Point(xa,ya),Point(b.x(),yb),colors[3],colors[0],s);
-            }
+                spanDrawingEngine<T,unsigned int,2>(surface,p,a,b,colors,s);
+            } else spanDrawingEngine<T,unsigned int,1>(surface,p,a,b,colors,s);
             break;
         case 64:
             if(isAntialiased()==false || isFixedWidth()) return;
-            variableWidthClippedAADrawingEngine<T,unsigned long long>(surface,p,
-                        Point(xa,ya),Point(b.x(),yb),colors,s);
+            spanDrawingEngine<T,unsigned long long,2>(surface,p,a,b,colors,s);
             break;
     }
 }
 
-template<typename T, typename U>
-void Font::fixedWidthDrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color fgcolor, Color bgcolor,
-            const char *s) const
+inline void Font::transpose8(const unsigned char in[8], unsigned char *out,
+        int stride)
 {
-    const U *fontData=reinterpret_cast<const U *>(getData());
-    for(;;)
-    {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<width;i++)
-        {
-            if(x++==xEnd) return;
-            U row=fontData[c*width+i];
-            for(int j=0;j<height;j++)
-            {
-                if(row & 0x1) *first=fgcolor;
-                else *first=bgcolor;
-                row>>=1;
-                first++;
-            }      
-        }
-        s++;
-    }
-}
-
-template<typename T, typename U>
-void Font::variableWidthDrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color fgcolor, Color bgcolor,
-            const char *s) const
-{
-    const U *fontData=reinterpret_cast<const U *>(getData());
-    for(;;)
-    {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<widths[c];i++)
-        {
-            if(x++==xEnd) return;
-            U row=fontData[offset[c]+i];
-            for(int j=0;j<height;j++)
-            {
-                if(row & 0x1) *first=fgcolor;
-                else *first=bgcolor;
-                row>>=1;
-                first++;
-            }
-        }
-        s++;
-    }
-}
-
-template<typename T, typename U>
-void Font::variableWidthAADrawingEngine(typename T::pixel_iterator first,
-            short x, short xEnd, Color colors[4], const char *s) const
-{
-    const U *fontData=reinterpret_cast<const U *>(getData());
-    for(;;)
-    {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<widths[c];i++)
-        {
-            if(x++==xEnd) return;
-            U row=fontData[offset[c]+i];
-            for(int j=0;j<height;j++)
-            {
-                *first=colors[row & 0x3];
-                row>>=2;
-                first++;
-            }
-        }
-        s++;
-    }
+    //From Hacker's Delight, with rows taken in reverse order so that the
+    //least significant bit is the first column in the output as in the input
+    unsigned int x=in[7]<<24 | in[6]<<16 | in[5]<<8 | in[4];
+    unsigned int y=in[3]<<24 | in[2]<<16 | in[1]<<8 | in[0];
+    unsigned int t;
+    t=(x ^ (x>>7)) & 0x00aa00aa; x=x ^ t ^ (t<<7);
+    t=(y ^ (y>>7)) & 0x00aa00aa; y=y ^ t ^ (t<<7);
+    t=(x ^ (x>>14)) & 0x0000cccc; x=x ^ t ^ (t<<14);
+    t=(y ^ (y>>14)) & 0x0000cccc; y=y ^ t ^ (t<<14);
+    t=(x & 0xf0f0f0f0) | ((y>>4) & 0x0f0f0f0f);
+    y=((x<<4) & 0xf0f0f0f0) | (y & 0x0f0f0f0f);
+    x=t;
+    out[7*stride]=x>>24; out[6*stride]=x>>16; out[5*stride]=x>>8;
+    out[4*stride]=x;
+    out[3*stride]=y>>24; out[2*stride]=y>>16; out[1*stride]=y>>8;
+    out[0]=y;
 }
 
-template<typename T, typename U>
-void Font::fixedWidthClippedDrawingEngine(T& surface, Point p, Point a, Point b,
-            Color fgcolor, Color bgcolor, const char *s) const
+inline void Font::transpose4x4(const unsigned char in[4], unsigned char *out,
+        int stride)
 {
-    const U *fontData=reinterpret_cast<const U *>(getData());
-
-    //Walk the string till the first at least partially visible char
-    int partial=0;
-    short x=p.x();
-    while(x<a.x())
-    {
-        if(*s=='\0') return; //String ends before draw area begins
-        if(x+getWidth()>a.x())
-        {
-            //The current char is partially visible
-            partial=a.x()-x;
-            break; //Don't go past this char, since it has to be drawn
-        }
-        x+=getWidth();
-        s++;
-    }
-    x=a.x();
-    
-    typename T::pixel_iterator it=surface.begin(a,b,DR);
-
-    const short ySkipped=a.y()-p.y();
-    const short yHeight=b.y()-a.y()+1;
-
-    //Draw the first partially visible char, if it exists
-    if(partial>0)
-    {
-        unsigned char c=*s;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=partial;i<width;i++)
-        {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[c*width+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
-            {
-                if(row & 0x1) *it=fgcolor;
-                else *it=bgcolor;
-                row>>=1;
-            }
-        }
-        s++;
-    }
-
-    //Draw the rest of the string
-    for(;;)
-    {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<width;i++)
-        {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[c*width+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
-            {
-                if(row & 0x1) *it=fgcolor;
-                else *it=bgcolor;
-                row>>=1;
-            }
-        }
-        s++;
-    }
-    it.invalidate(); //May not fill the requested window
+    //Element of column i, row j is at bit 8i+2j, first swap the elements
+    //within each 2x2 block, then the 2x2 blocks themselves
+    unsigned int x=in[3]<<24 | in[2]<<16 | in[1]<<8 | in[0];
+    unsigned int t;
+    t=(x ^ (x>>6)) & 0x00cc00cc; x=x ^ t ^ (t<<6);
+    t=(x ^ (x>>12)) & 0x0000f0f0; x=x ^ t ^ (t<<12);
+    out[0]=x; out[stride]=x>>8; out[2*stride]=x>>16; out[3*stride]=x>>24;
 }
 
-template<typename T, typename U>
-void Font::variableWidthClippedDrawingEngine(T& surface, Point p, Point a,
-        Point b, Color fgcolor, Color bgcolor, const char *s) const
+template<typename T, typename U, int bpp>
+void Font::spanDrawingEngine(T& surface, Point p, Point a, Point b,
+            const Color colors[4], const char *s) const
 {
+    //Pixel values index the palette, fonts that are not antialiased have
+    //only background and foreground
+    const int mask=(1<<bpp)-1;
+    const Color palette[4]={colors[0],bpp==1 ? colors[3] : colors[1],
+                            colors[2],colors[3]};
+    //Each nibble of font data is expanded to this number of pixels
+    const int ppn=4/bpp;
+    Color expand[16][ppn];
+    for(int i=0;i<16;i++)
+        for(int j=0;j<ppn;j++) expand[i][j]=palette[(i>>(j*bpp)) & mask];
+
+    //Strings longer than this are drawn in chunks, to bound stack usage
+    const int chunk=256;
+    const int rowsPerBand=8/bpp;
+    const int stride=chunk*bpp/8;
+    unsigned char rows[rowsPerBand][stride];
     const U *fontData=reinterpret_cast<const U *>(getData());
-
-    //Walk the string till the first at least partially visible char
-    int partial=0;
-    short x=p.x();
-    while(x<a.x())
-    {
-        unsigned char c=*s;
-        if(c=='\0') return; //String ends before draw area begins
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        if(x+widths[c]>a.x())
-        {
-            //The current char is partially visible
-            partial=a.x()-x;
-            break; //Don't go past this char, since it has to be drawn
-        }
-        x+=widths[c];
-        s++;
-    }
-    x=a.x();
-
-    typename T::pixel_iterator it=surface.begin(a,b,DR);
-
-    const short ySkipped=a.y()-p.y();
-    const short yHeight=b.y()-a.y()+1;
-
-    //Draw the first partially visible char, if it exists
-    if(partial>0)
+    //Find where the data of a char starts and its width
+    auto glyph=[&](const char *str, const U *&data, unsigned char& w)
     {
-        unsigned char c=*s;
+        unsigned char c=*str;
         if(c<startChar || c>endChar) c=0;
         else c-=startChar;
-        for(unsigned int i=partial;i<widths[c];i++)
+        if(isFixedWidth())
         {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[offset[c]+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
-            {
-                if(row & 0x1) *it=fgcolor;
-                else *it=bgcolor;
-                row>>=1;
-            }
+            data=fontData+c*width;
+            w=width;
+        } else {
+            data=fontData+offset[c];
+            w=widths[c];
         }
-        s++;
-    }
+    };
 
-    //Draw the rest of the string
-    for(;;)
+    //Walk the string till the first visible column
+    const char *chunkString=s;
+    unsigned char chunkColumn=0;
+    for(short skip=a.x()-p.x();skip>0;chunkString++)
     {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<widths[c];i++)
-        {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[offset[c]+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
-            {
-                if(row & 0x1) *it=fgcolor;
-                else *it=bgcolor;
-                row>>=1;
-            }
-        }
-        s++;
-    }
-    it.invalidate(); //May not fill the requested window
-}
-
-template<typename T, typename U>
-void Font::variableWidthClippedAADrawingEngine(T& surface, Point p, Point a,
-        Point b, Color colors[4], const char *s) const
-{
-    const U *fontData=reinterpret_cast<const U *>(getData());
-
-    //Walk the string till the first at least partially visible char
-    int partial=0;
-    short x=p.x();
-    while(x<a.x())
-    {
-        unsigned char c=*s;
-        if(c=='\0') return; //String ends before draw area begins
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        if(x+widths[c]>a.x())
+        const U *data;
+        unsigned char w;
+        glyph(chunkString,data,w);
+        if(skip<w)
         {
             //The current char is partially visible
-            partial=a.x()-x;
-            break; //Don't go past this char, since it has to be drawn
+            chunkColumn=skip;
+            break;
         }
-        x+=widths[c];
-        s++;
+        skip-=w;
     }
-    x=a.x();
-
-    typename T::pixel_iterator it=surface.begin(a,b,DR);
 
-    const short ySkipped=(a.y()-p.y())*2;
-    const short yHeight=b.y()-a.y()+1;
-
-    //Draw the first partially visible char, if it exists
-    if(partial>0)
+    const short length=b.x()-a.x()+1;
+    const short firstRow=a.y()-p.y();
+    const short lastRow=b.y()-p.y();
+    for(short x=0;x<length;x+=chunk)
     {
-        unsigned char c=*s;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=partial;i<widths[c];i++)
+        const short n=std::min<int>(chunk,length-x);
+        const char *str=chunkString;
+        unsigned char column=chunkColumn;
+        for(short band=firstRow;band<=lastRow;band+=rowsPerBand)
         {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[offset[c]+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
+            //Every band walks again the same columns of the string
+            str=chunkString;
+            column=chunkColumn;
+            const U *data;
+            unsigned char w;
+            glyph(str,data,w);
+            for(short g=0;g<n;g+=8)
             {
-                *it=colors[row & 0x3];
-                row>>=2;
+                unsigned char in[8];
+                for(int i=0;i<8;i++)
+                {
+                    if(g+i>=n) { in[i]=0; continue; }
+                    while(column>=w) //Also skips zero width chars
+                    {
+                        column=0;
+                        glyph(++str,data,w);
+                    }
+                    in[i]=data[column++]>>(band*bpp);
+                }
+                if(bpp==1) transpose8(in,&rows[0][g/8],stride);
+                else {
+                    transpose4x4(in,&rows[0][g/4],stride);
+                    transpose4x4(in+4,&rows[0][g/4+1],stride);
+                }
             }
-        }
-        s++;
-    }
 
-    //Draw the rest of the string
-    for(;;)
-    {
-        unsigned char c=*s;
-        if(*s=='\0') break;
-        if(c<startChar || c>endChar) c=0;
-        else c-=startChar;
-        for(unsigned int i=0;i<widths[c];i++)
-        {
-            if(x>b.x()) return;
-            x++;
-            U row=fontData[offset[c]+i];
-            row>>=ySkipped;
-            for(int j=0;j<yHeight;j++)
+            for(int j=0;j<rowsPerBand && band+j<=lastRow;j++)
             {
-                *it=colors[row & 0x3];
-                row>>=2;
+                Color *line=surface.getScanLineBuffer();
+                const unsigned char *bits=rows[j];
+                short i=0;
+                for(;i+2*ppn<=n;i+=2*ppn)
+                {
+                    const unsigned char nibbles=*bits++;
+                    std::memcpy(line+i,expand[nibbles & 0xf],sizeof(expand[0]));
+                    std::memcpy(line+i+ppn,expand[nibbles>>4],sizeof(expand[0]));
+                }
+                if(i<n)
+                    for(unsigned char pixels=*bits;i<n;i++,pixels>>=bpp)
+                        line[i]=palette[pixels & mask];
+                surface.scanLineBuffer(Point(a.x()+x,p.y()+band+j),n);
             }
         }
-        s++;
+        chunkString=str;
+        chunkColumn=column;
     }
-    it.invalidate(); //May not fill the requested window
 }
 
 } //namespace mxgui
@@ -27,21 +27,112 @@
 
 #include "jpeg_image.h"
 #include <cstring>
+#ifdef __ARM_FEATURE_SAT
+#include <arm_acle.h>
+#endif
 #include <iostream>
 #include <deque>
 #include <memory>
+#include <new>
+#include <algorithm>
 
 namespace mxgui
 {
 
-    void JpegImage::open(const std::string &filename)
+    void JpegImage::open(const std::string &filename, unsigned int scale)
     {
-        previousDCs = new int[3]{0};
+        this->close();
+        for (scaleShift = 0; scaleShift < 3 && (1u << scaleShift) < scale; ++scaleShift) ;
+        if ((1u << scaleShift) != scale)
+        {
+            std::cout << "Error - Scale must be 1, 2, 4 or 8\n";
+            scaleShift = 0;
+            this->isValid = false;
+            return;
+        }
+        this->name = new char[filename.length() + 1];
+        strcpy(this->name, filename.c_str());
         this->header = this->readJPG(filename);
-        if (header->valid == false) this->isValid=false;
+        if (header == nullptr)
+        {
+            this->isValid = false;
+            return;
+        }
+        this->isValid = header->valid;
+        if (!this->isValid)
+        {
+            reader.close();
+            return;
+        }
         generateCodes(this->header);
-        this->height = this->header->height;
-        this->width = this->header->width;
+        scaleComponents(this->header);
+        prepareQuantizationTables(this->header);
+        // The scaled size is rounded up, as libjpeg does
+        const uint scaleRounding = (1 << scaleShift) - 1;
+        this->height = (this->header->height + scaleRounding) >> scaleShift;
+        this->width = (this->header->width + scaleRounding) >> scaleShift;
+        blockSize = 8 >> scaleShift;
+
+        // One MCU, the restart index and the pixels of a row of MCUs, the
+        // only memory needed for decoding besides the header. The index comes
+        // before the pixels, as the size of a row of pixels can be a multiple
+        // of 2 bytes only, and its offset is aligned for RestartPoint
+        rowStride = header->mcuWidth * blockSize * header->horizontalSamplingFactor;
+        const uint mcuRows = header->mcuHeight;
+        const uint rowBufferSize = blockSize * header->verticalSamplingFactor * rowStride * sizeof(Color);
+        const uint indexSize = header->reastartInterval != 0 ? mcuRows * sizeof(RestartPoint) : 0;
+        const uint indexOffset = (sizeof(MCU) + alignof(RestartPoint) - 1) & ~(alignof(RestartPoint) - 1);
+        static_assert(sizeof(RestartPoint) % alignof(Color) == 0, "rowBuffer misaligned");
+        arena = new char[indexOffset + indexSize + rowBufferSize];
+        mcu = new (arena) MCU;
+        rowBuffer = reinterpret_cast<Color *>(arena + indexOffset + indexSize);
+        if (indexSize != 0)
+        {
+            restartIndex = new (arena + indexOffset) RestartPoint[mcuRows];
+            buildRestartIndex();
+        }
+    }
+
+    // Scan the entropy coded data for restart markers, recording for each row
+    // of MCUs where the last restart interval starting before it begins
+    void JpegImage::buildRestartIndex()
+    {
+        const uint mcusPerRow = header->mcuWidth;
+        const uint mcuRows = header->mcuHeight;
+        const uint interval = header->reastartInterval;
+        if (!reader.seek(header->scanOffset))
+            return;
+        uint offset = header->scanOffset;
+        for (uint n = 0;; ++n)
+        {
+            // Rows whose first MCU is in restart interval n
+            const uint first = (n * interval + mcusPerRow - 1) / mcusPerRow;
+            const uint last = std::min(((n + 1) * interval + mcusPerRow - 1) / mcusPerRow, mcuRows);
+            for (uint row = first; row < last; ++row)
+            {
+                restartIndex[row].offset = offset;
+                restartIndex[row].interval = n;
+            }
+            if (last >= mcuRows)
+                return;
+
+            // Find the next restart marker, the data never contains 0xFF
+            // but for stuffing (0xFF00), fill bytes and markers
+            int c;
+            do
+            {
+                c = reader.get();
+                if (c == 0xFF)
+                {
+                    do c = reader.get(); while (c == 0xFF);
+                    if (c != 0x00)
+                        break;
+                }
+            } while (c != -1);
+            if (c < RST0 || c > RST7)
+                return; // Truncated data, the remaining rows are not indexed
+            offset = reader.tell();
+        }
     }
 
 
@@ -51,68 +142,83 @@ namespace mxgui
             return;
         delete[] this->name;
         this->name = 0;
-        fclose(this->f);
+        delete this->header;
+        this->header = 0;
+        delete[] arena;
+        arena = nullptr;
+        mcu = nullptr;
+        rowBuffer = nullptr;
+        restartIndex = nullptr;
+        b.reset();
+        reader.close();
+        reset();
     }
 
     bool JpegImage::getScanLine(mxgui::Point p, mxgui::Color colors[], unsigned short length) const
-    {   if(!this->isValid) return false;
-        const MCU mcu;
-        const uint mcuWidth = (header->width + 7) / 8;       // Calculate MCUs per row
-        static std::vector<MCU> mcuBuffer(mcuWidth);         // Buffer for a row of MCUs, static to persist across calls
-        static std::vector<bool> mcuLoaded(mcuWidth, false); // Track loaded state of MCUs, static to persist across calls
-        static uint lastProcessedRow = 0xFFFFFFFF;
-        
-        if(isFirstLine){
-            b.setData(header->huffmanData);
-            isFirstLine=false;
-        }
+    {
+        if (!this->isValid)
+            return false;
+        if (p.x() < 0 || p.y() < 0 || p.y() >= this->height || p.x() + length > this->width)
+            return false;
 
-        const uint mcuRow = p.y() / 8;
-        const uint pixelRow = p.y() % 8;
+        const int mcuHeight = blockSize * header->verticalSamplingFactor;
+        const int mcuRow = p.y() / mcuHeight;
+        if (mcuRow != decodedMcuRow && !decodeMCURow(mcuRow))
+            return false;
 
-        // Check if we've moved to a new row of MCUs or if it's the first call
-        if (mcuRow != lastProcessedRow / 8)
-        {
-            std::fill(mcuLoaded.begin(), mcuLoaded.end(), false); // Reset MCU loaded states
-            lastProcessedRow = this->current_height;              // Update the last processed row
-        }
+        const Color *line = rowBuffer + (p.y() % mcuHeight) * rowStride + p.x();
+        std::copy(line, line + length, colors);
+        return true;
+    }
 
-        for (uint x = 0; x < header->width; ++x)
+    bool JpegImage::decodeMCURow(int row) const
+    {
+        // Entropy coded data can only be decoded sequentially. Decoding
+        // resumes from the closest restart interval if the image has them,
+        // otherwise going back requires to start over from the beginning of
+        // the scan. Data is streamed from the file, so resuming costs a seek
+        const int mcusPerRow = header->mcuWidth;
+        const int first = row * mcusPerRow;
+        int start = -1;
+        uint offset = 0;
+        if (restartIndex != nullptr && restartIndex[row].offset != 0)
         {
-            const uint mcuColumn = x / 8;
-            const uint pixelColumn = x % 8;
-            const uint pixelIndex = pixelRow * 8 + pixelColumn;
-            const int mcuIndex = mcuRow * mcuWidth + mcuColumn;
-
-
-            // Load MCU into buffer if not already loaded for this row of MCUs
-           if (!mcuLoaded[mcuColumn])
+            const int intervalStart = restartIndex[row].interval * header->reastartInterval;
+            if (nextMcu < 0 || first < nextMcu || intervalStart > nextMcu)
             {
-                mcuBuffer[mcuColumn] = processOneMCU(header,mcu, mcuIndex, b,previousDCs);
-                mcuLoaded[mcuColumn] = true; // Mark as loaded
+                start = intervalStart;
+                offset = restartIndex[row].offset;
             }
-
-            const MCU &mcu = mcuBuffer[mcuColumn];
-
-            // Perform color conversion and store in the colors array
-            //std::cout << "R value: " << mcu.r[pixelIndex] << "   G value  " << mcu.g[pixelIndex] << "   B value  " << mcu.b[pixelIndex] << "\n";
-            colors[x] = ((mcu.r[pixelIndex] & 0xF8) << 8) | ((mcu.g[pixelIndex] & 0xFC) << 3) | (mcu.b[pixelIndex] >> 3);
         }
-        
-        this->current_height++;
-        if(this->current_height == this->height){
-            std::cout <<"Start resetting";
+        else if (nextMcu < 0 || first < nextMcu)
+        {
+            start = 0;
+            offset = header->scanOffset;
+        }
+        if (start >= 0)
+        {
             reset();
+            if (!reader.seek(offset))
+                return false;
+            b.setSource(&reader);
+            nextMcu = resumeMcu = start;
         }
 
-
-
+        // MCUs before the requested row only need to be entropy decoded
+        for (; nextMcu < first; ++nextMcu)
+        {
+            decodeHuffmanData(*mcu, nextMcu);
+        }
+        for (int x = 0; x < mcusPerRow; ++x, ++nextMcu)
+        {
+            processOneMCU(nextMcu, rowBuffer + x * blockSize * header->horizontalSamplingFactor);
+        }
+        decodedMcuRow = row;
         return true;
     }
 
-    void JpegImage::readQuantizationTable(std::ifstream &inFile, Header *const header)
+    void JpegImage::readQuantizationTable(ByteReader &inFile, Header *const header)
     {
-        std::cout << "reading DQT marker\n";
         // Legge due byte dal file 'inFile' e li combina per creare un valore intero a 16 bit.
         // La prima chiamata 'inFile.get()' legge i primi 8 bit e restituisce un valore non segnato.
         // L'operatore '<< 8' sposta questi 8 bit a sinistra di 8 posizioni (moltiplicando per 256).
@@ -161,10 +267,9 @@ namespace mxgui
         }
     }
 
-    bool JpegImage::readStartOfFrame(std::ifstream &inFile, Header *const header)
+    bool JpegImage::readStartOfFrame(ByteReader &inFile, Header *const header)
     {
 
-        std::cout << "Reading SOF Marker\n";
         if (header->numComponents != 0)
         {
             std::cout << "Error - Multiple SOFs detected\n";
@@ -242,14 +347,6 @@ namespace mxgui
             component->used = true;
             byte samplingFactor = inFile.get();
             component->horizontalSamplingFactor = samplingFactor >> 4;
-
-            if (component->horizontalSamplingFactor != 1 || component->verticalSamplingFactor != 1)
-            {
-                std::cout << "Error - Error sampling factors not supported\n"
-                          << "\n";
-                header->valid = false;
-                return false;
-            }
             component->verticalSamplingFactor = samplingFactor & 0x0F;
             component->quantizationtableID = inFile.get();
             if (component->quantizationtableID > 3)
@@ -267,12 +364,71 @@ namespace mxgui
                 return false;
             }
         }
+
+        // A scan with a single component is not interleaved, its MCUs are
+        // always one block whatever the sampling factors are
+        ColorComponent &luma = header->colorComponents[0];
+        if (header->numComponents == 1)
+        {
+            luma.horizontalSamplingFactor = 1;
+            luma.verticalSamplingFactor = 1;
+        }
+        // Supported layouts are full resolution chroma (4:4:4), and chroma
+        // subsampled by 2 horizontally (4:2:2), vertically, or both (4:2:0)
+        bool supported = luma.horizontalSamplingFactor >= 1 && luma.horizontalSamplingFactor <= 2 &&
+                         luma.verticalSamplingFactor >= 1 && luma.verticalSamplingFactor <= 2;
+        for (uint i = 1; i < header->numComponents; ++i)
+        {
+            if (header->colorComponents[i].horizontalSamplingFactor != 1 ||
+                header->colorComponents[i].verticalSamplingFactor != 1)
+            {
+                supported = false;
+            }
+        }
+        if (!supported)
+        {
+            std::cout << "Error - Sampling factors not supported\n";
+            header->valid = false;
+            return false;
+        }
+        header->horizontalSamplingFactor = luma.horizontalSamplingFactor;
+        header->verticalSamplingFactor = luma.verticalSamplingFactor;
+        header->mcuWidth = (header->width + 8 * header->horizontalSamplingFactor - 1) / (8 * header->horizontalSamplingFactor);
+        header->mcuHeight = (header->height + 8 * header->verticalSamplingFactor - 1) / (8 * header->verticalSamplingFactor);
         return true;
     }
 
-    void JpegImage::readRestartInterval(std::ifstream &inFile, Header *const header)
+    // Choose the size each component is decoded to. Like libjpeg does, when
+    // decoding at a reduced scale chroma subsampled both ways is decoded at
+    // twice the size of luma instead of being upsampled
+    void JpegImage::scaleComponents(Header *const header)
+    {
+        for (uint i = 0; i < header->numComponents; ++i)
+        {
+            header->colorComponents[i].scaleShift = scaleShift;
+        }
+        if (scaleShift == 0 || header->horizontalSamplingFactor != 2 || header->verticalSamplingFactor != 2)
+        {
+            return;
+        }
+#ifdef MXGUI_JPEG_IDCT_IFAST
+        // The full size inverse DCT needs prescaled quantization tables and
+        // the reduced size ones do not, a table can't be used by both
+        const byte lumaTable = header->colorComponents[0].quantizationtableID;
+        if (scaleShift == 1 && (header->colorComponents[1].quantizationtableID == lumaTable ||
+                                header->colorComponents[2].quantizationtableID == lumaTable))
+        {
+            return;
+        }
+#endif
+        for (uint i = 1; i < header->numComponents; ++i)
+        {
+            header->colorComponents[i].scaleShift = scaleShift - 1;
+        }
+    }
+
+    void JpegImage::readRestartInterval(ByteReader &inFile, Header *const header)
     {
-        std::cout << "Reading DRI Marker\n";
         uint length = (inFile.get() << 8) + inFile.get();
         header->reastartInterval = (inFile.get() << 8) + inFile.get();
         if (length - 4 != 0)
@@ -282,9 +438,8 @@ namespace mxgui
         }
     }
 
-    void JpegImage::readHuffmanTable(std::ifstream &inFile, Header *const header)
+    void JpegImage::readHuffmanTable(ByteReader &inFile, Header *const header)
     {
-        std::cout << "Reading DHT Marker\n";
         int length = (inFile.get() << 8) + inFile.get();
         length -= 2;
 
@@ -342,9 +497,8 @@ namespace mxgui
         }
     }
 
-    void JpegImage::readStartOfScan(std::ifstream &inFile, Header *const header)
+    void JpegImage::readStartOfScan(ByteReader &inFile, Header *const header)
     {
-        std::cout << "Reading SOS Marker \n";
         if (header->numComponents == 0)
         {
             std::cout << "Error - Too many simbols in Huffman table \n";
@@ -412,22 +566,15 @@ namespace mxgui
     }
 
     // skip all APPN
-    void JpegImage::readAPPN(std::ifstream &inFile, Header *const header)
+    void JpegImage::readAPPN(ByteReader &inFile, Header *const header)
     {
-        std::cout << "reading APPN Marker \n";
         uint length = (inFile.get() << 8) + inFile.get();
-
-        for (uint i = 0; i < length - 2; ++i)
-        {
-            inFile.get();
-            // We read all the part of the file we are not interested so the last c
-            // charchter we read is the first marker of the QUANTIZATION TABLE
-        }
+        // We skip all the part of the file we are not interested in
+        inFile.skip(length - 2);
     }
 
-    void JpegImage::readComment(std::ifstream &inFile, Header *const header)
+    void JpegImage::readComment(ByteReader &inFile, Header *const header)
     {
-        std::cout << "Reading COM Marker\n";
         uint length = (inFile.get() << 8) + inFile.get();
         if (length < 2)
         {
@@ -435,42 +582,29 @@ namespace mxgui
             header->valid = false;
             return;
         }
-
-        for (uint i = 0; i < length - 2; ++i)
-        {
-            byte read = inFile.get();
-            std::cout << "Reading comment: " << read << "\n";
-        }
+        inFile.skip(length - 2);
     }
 
     // Implementation of readJPG
+    // Parses the markers up to the start of scan. The entropy coded data that
+    // follows is not loaded, getScanLine() streams it from the file
     Header *JpegImage::readJPG(const std::string &filename)
     {
-        // Apri un file JPG specificato da 'filename' e leggi i dati dell'immagine qui
-        // Creazione di un oggetto 'std::ifstream' chiamato 'inFile'.
-        // Questo oggetto verrà utilizzato per leggere dati da un file specificato da 'filename'.
-        std::ifstream inFile = std::ifstream(filename, std::ios::in | std::ios::binary);
-        // 'filename' è il nome del file che verrà aperto per la lettura. Assicurati che contenga il percorso completo o relativo al file.
-        // La modalità 'std::ios::in' indica che il file verrà aperto in modalità di lettura, consentendo la lettura dei dati dal file.
-        // La modalità 'std::ios::binary' indica che il file verrà aperto in modalità binaria, ideale per la lettura di file binari come le immagini.
-        if (!inFile.is_open())
-        {
-            std::cout << "Error - Error opening input file\n";
-        }
-        // Crea un nuovo puntatore di tipo 'Header' chiamato 'header' e assegna a esso un nuovo oggetto di tipo 'Header' allocato sulla memoria heap.
         Header *header = new (std::nothrow) Header;
-        // L'uso di 'new' consente di allocare memoria dinamicamente sulla heap per un nuovo oggetto di tipo 'Header'.
-        // 'std::nothrow' è utilizzato per gestire eventuali errori di allocazione di memoria senza generare eccezioni.
-        // 'header' è ora un puntatore che può essere utilizzato per accedere e manipolare l'oggetto 'Header' allocato dinamicamente.
-        // Assicurati di deallocare correttamente questa memoria quando non ne hai più bisogno utilizzando 'delete' per evitare perdite di memoria.
         if (header == nullptr)
         {
             std::cout << "Error - Memory error \n";
-            inFile.close();
             return nullptr;
         }
-        byte last = inFile.get();
-        byte current = inFile.get();
+        ByteReader &inFile = this->reader;
+        if (!inFile.open(filename.c_str()))
+        {
+            std::cout << "Error - Error opening input file\n";
+            header->valid = false;
+            return header;
+        }
+        int last = inFile.get();
+        int current = inFile.get();
         if (last != 0xFF || current != SOI)
         {
             // Non è un file JPEG valido
@@ -481,18 +615,16 @@ namespace mxgui
         current = inFile.get();
         while (header->valid)
         {
-            if (!inFile)
+            if (current == -1)
             {
                 std::cout << "Error - file ended premature\n";
                 header->valid = false;
-                inFile.close();
                 return header;
             }
             if (last != 0xFF)
             {
                 std::cout << "Error - Expected a marker\n";
                 header->valid = false;
-                inFile.close();
                 return header;
             }
             if (current == SOF0)
@@ -598,72 +730,18 @@ namespace mxgui
             current = inFile.get();
         }
 
-        if (header->valid)
+        if (!header->valid)
         {
-            current = inFile.get();
-            // read compressed image dataa
-            while (true)
-            {
-
-                if (!inFile)
-                {
-                    std::cout << "Error - File ended prematurely";
-                    header->valid = false;
-                    inFile.close();
-                    return header;
-                }
-
-                last = current;
-                current = inFile.get();
-                if (last == 0xFF)
-                {
-
-                    // end of image
-                    if (current == EOI)
-                    {
-                        break;
-                    }
-                    // 0xFF00 means put a literal 0xFF in image data and ignore 0x00
-                    else if (current == 0x00)
-                    {
-                        header->huffmanData.push_back(last);
-                        // overwrite 0x00 with next byte
-                        current = inFile.get();
-                    }
-                    // Restart marker
-                    else if (current >= RST0 && current <= RST7)
-                    {
-                        // overwrite marker with nextByte
-                        current = inFile.get();
-                    }
-                    // ignore multiple 0xFFF in a row
-                    else if (current == 0xFF)
-                    {
-                        continue;
-                    }
-                    else
-                    {
-                        std::cout << "Error - Unknown marker: 0x" << std::hex << (uint)current << std::dec << '\n';
-                        header->valid = false;
-                        return header;
-                    }
-                    // its not last==0xFF
-                }
-                else
-                {
-                    header->huffmanData.push_back(last);
-                }
-            }
+            return header;
         }
+        // The entropy coded data starts right after the SOS marker
+        header->scanOffset = inFile.tell();
 
-        std::cout << " Jpeg file read!"
-                  << "\n";
         // validate Header info
         if (header->numComponents != 1 && header->numComponents != 3)
         {
             std::cout << "Error - " << (uint)header->numComponents << "Color components given (1 or 3 required)\n";
             header->valid = false;
-            inFile.close();
             return header;
         }
 
@@ -673,38 +751,51 @@ namespace mxgui
             {
                 std::cout << "Error - Color component using unitialized quantization table \n";
                 header->valid = false;
-                inFile.close();
                 return header;
             }
-            if (header->quantizationTable[header->colorComponents[i].huffmanACTableID].set == false)
+            if (header->huffmanACTable[header->colorComponents[i].huffmanACTableID].set == false)
             {
                 std::cout << "Error - Color component using unitialized Huffman AC table \n";
                 header->valid = false;
-                inFile.close();
                 return header;
             }
-            if (!header->quantizationTable[header->colorComponents[i].huffmanDCTableID].set)
+            if (!header->huffmanDCTable[header->colorComponents[i].huffmanDCTableID].set)
             {
                 std::cout << "Error - Color component using unitialized Huffman DC table \n";
                 header->valid = false;
-                inFile.close();
                 return header;
             }
         }
-        inFile.close();
         return header;
     }
 
-    // generate all Huffman codes based on symbols from a Huffman table
+    // generate all Huffman codes based on symbols from a Huffman table,
+    // filling the lookup table for the short codes and the per length code
+    // ranges for the long ones
     void JpegImage::generateCode(HuffmanTable &hTable)
     {
+        memset(hTable.lookup, 0, sizeof(hTable.lookup));
         uint code = 0;
         for (uint i = 0; i < 16; ++i)
         {
+            const int length = i + 1;
+            const int numCodes = hTable.offset[i + 1] - hTable.offset[i];
+            hTable.valueOffset[length] = static_cast<int>(hTable.offset[i]) - static_cast<int>(code);
+            hTable.maxCode[length] = numCodes == 0 ? -1 : static_cast<int>(code) + numCodes - 1;
             for (uint j = hTable.offset[i]; j < hTable.offset[i + 1]; ++j)
             {
-                // We read the code following the offset and we save the code respectevly
-                hTable.codes[j] = code;
+                // Codes that do not fit in length bits come from a corrupted
+                // table and are never matched
+                if (length <= huffmanLookupBits && code < (1u << length))
+                {
+                    // All the entries whose first length bits are this code
+                    const int shift = huffmanLookupBits - length;
+                    const unsigned short entry = length << 8 | hTable.symbols[j];
+                    for (uint k = 0; k < (1u << shift); ++k)
+                    {
+                        hTable.lookup[(code << shift) | k] = entry;
+                    }
+                }
                 code += 1;
             }
             code <<= 1; // binary shifting on left (adding a zero=)
@@ -713,29 +804,33 @@ namespace mxgui
 
     // return the symbol from the Huffman table that corresponds to
     //  the next Huffman code read from the BitReader
-    // Leggi fino a 16 bit e cerchi se esiste un codice con quella lunghezza
     byte JpegImage::getNextSymbol(BitReader &b, const HuffmanTable &hTable) const
     {
-        // We read just one bit, we compare the bit with all the codes represented in one bit
-        // if we find the match return the corresponding symbol, if e dont we add another bit and repeat procedure
-        uint currentCode = 0;
-        for (uint i = 0; i < 16; ++i)
+        // Codes up to huffmanLookupBits long are decoded with a single lookup
+        const unsigned short entry = hTable.lookup[b.peekBits(huffmanLookupBits)];
+        if (entry != 0)
         {
-
-            int bit = b.readBit();
-            if (bit == -1)
+            if (!b.skipBits(entry >> 8))
             {
                 std::cout << "Error - FF is an invalid symbol\n";
-                // FF (255) is not a valid symbol, so we return -1 as error
                 return -1;
             }
-            currentCode = (currentCode << 1) | bit; // Our current code will shift of one bit and OR with the bit
-            for (uint j = hTable.offset[i]; j < hTable.offset[i + 1]; ++j)
+            return entry & 0xFF;
+        }
+
+        // Longer codes are compared against the range of codes of each length
+        const uint bits = b.peekBits(16);
+        for (int length = huffmanLookupBits + 1; length <= 16; ++length)
+        {
+            const int currentCode = bits >> (16 - length);
+            if (currentCode <= hTable.maxCode[length])
             {
-                if (currentCode == hTable.codes[j])
+                if (!b.skipBits(length))
                 {
-                    return hTable.symbols[j];
+                    std::cout << "Error - FF is an invalid symbol\n";
+                    return -1;
                 }
+                return hTable.symbols[hTable.valueOffset[length] + currentCode];
             }
         }
 
@@ -861,69 +956,414 @@ namespace mxgui
         }
     }
 
-    MCU JpegImage::decodeHuffmanData(Header *const header, MCU mcu, int index, BitReader &bitReader, int previousDCs[3]) const
+    void JpegImage::decodeHuffmanData(MCU &mcu, int index) const
     {
         if (header->reastartInterval != 0 && index % header->reastartInterval == 0)
         {
             previousDCs[0] = 0;
             previousDCs[1] = 0;
             previousDCs[2] = 0;
-            bitReader.align();
+            // The data of every restart interval is preceded by a RST marker,
+            // but for the first one and the one decoding resumed from
+            if (index != resumeMcu && !b.restart())
+            {
+                std::cout << "Error - Expected restart marker\n";
+            }
         }
 
+        // Blocks of each component are stored in the MCU left to right, top
+        // to bottom
         for (uint j = 0; j < header->numComponents; ++j)
         {
-            if (!decodeMCUComponents(bitReader,
-                                     mcu[j],
-                                     previousDCs[j],
-                                     header->huffmanDCTable[header->colorComponents[j].huffmanDCTableID],
-                                     header->huffmanACTable[header->colorComponents[j].huffmanACTableID]))
+            const ColorComponent &component = header->colorComponents[j];
+            const uint blocks = component.horizontalSamplingFactor * component.verticalSamplingFactor;
+            for (uint k = 0; k < blocks; ++k)
             {
-                std::cout << "Failed to decode MCU component"
-                          << "\n";
-                return mcu;
+                if (!decodeMCUComponents(b,
+                                         mcu[j] + 64 * k,
+                                         previousDCs[j],
+                                         header->huffmanDCTable[component.huffmanDCTableID],
+                                         header->huffmanACTable[component.huffmanACTableID]))
+                {
+                    std::cout << "Failed to decode MCU component"
+                              << "\n";
+                    return;
+                }
             }
         }
+    }
 
-        return mcu;
+    // Clamp a value to the 0..255 range of a sample
+    static inline int rangeLimit(int x)
+    {
+#ifdef __ARM_FEATURE_SAT
+        return __usat(x, 8);
+#else
+        return x < 0 ? 0 : (x > 255 ? 255 : x);
+#endif
     }
 
-    void JpegImage::dequantizeMCUComponent(const QuantizationTable &qTable, int *const component) const
+    // Divide by 2^n, rounding
+    static inline int descale(int x, int n) { return (x + (1 << (n - 1))) >> n; }
+
+#if defined(MXGUI_JPEG_IDCT_IFAST)
+
+    // Scale factors of the AAN algorithm, scaled up by 14 bits. They are
+    // folded into the quantization tables when the image is opened
+    static const unsigned short aanScales[64] = {
+        16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+        22725, 31521, 29692, 26722, 22725, 17855, 12299, 6270,
+        21407, 29692, 27969, 25172, 21407, 16819, 11585, 5906,
+        19266, 26722, 25172, 22654, 19266, 15137, 10426, 5315,
+        16384, 22725, 21407, 19266, 16384, 12873, 8867, 4520,
+        12873, 17855, 16819, 15137, 12873, 10114, 6967, 3552,
+        8867, 12299, 11585, 10426, 8867, 6967, 4799, 2446,
+        4520, 6270, 5906, 5315, 4520, 3552, 2446, 1247};
+
+    void JpegImage::prepareQuantizationTables(Header *const header)
     {
-        for (uint i = 0; i < 64; ++i)
+        // The IDCT expects the coefficients scaled up by two bits. Tables of
+        // components decoded by the reduced size inverse DCTs are left as they are
+        bool prescale[4] = {false};
+        for (uint i = 0; i < header->numComponents; ++i)
         {
-            component[i] *= qTable.table[i];
+            if (header->colorComponents[i].scaleShift == 0)
+            {
+                prescale[header->colorComponents[i].quantizationtableID] = true;
+            }
+        }
+        for (uint i = 0; i < 4; ++i)
+        {
+            if (!prescale[i])
+            {
+                continue;
+            }
+            for (uint j = 0; j < 64; ++j)
+            {
+                const uint q = header->quantizationTable[i].table[j] * aanScales[j];
+                header->quantizationTable[i].table[j] = (q + (1 << 11)) >> 12;
+            }
         }
     }
 
-    MCU JpegImage::dequantize(const Header *const header, MCU mcu) const
+    // Fixed point AAN inverse DCT, same as the libjpeg "ifast" one.
+    // Multiplications are scaled up by 8 bits and not rounded
+    static inline int ifastMultiply(int x, int c) { return (x * c) >> 8; }
+    const int fix_1_082392200 = 277;
+    const int fix_1_414213562 = 362;
+    const int fix_1_847759065 = 473;
+    const int fix_2_613125930 = 669;
+
+    void JpegImage::inverseDCTComponent(const QuantizationTable &qTable, int *const component) const
     {
-        for (uint j = 0; j < header->numComponents; ++j)
+        const uint *const q = qTable.table;
+        int workspace[64];
+
+        // Columns, dequantizing the coefficients
+        for (uint i = 0; i < 8; ++i)
+        {
+            const int *in = component + i;
+            int *ws = workspace + i;
+            if (in[8] == 0 && in[16] == 0 && in[24] == 0 && in[32] == 0 &&
+                in[40] == 0 && in[48] == 0 && in[56] == 0)
+            {
+                // Only the DC coefficient, the column is constant
+                const int dc = in[0] * q[i];
+                for (uint j = 0; j < 8; ++j)
+                {
+                    ws[j * 8] = dc;
+                }
+                continue;
+            }
+
+            // Even part
+            int tmp0 = in[0] * q[i];
+            int tmp1 = in[16] * q[16 + i];
+            int tmp2 = in[32] * q[32 + i];
+            int tmp3 = in[48] * q[48 + i];
+
+            int tmp10 = tmp0 + tmp2;
+            int tmp11 = tmp0 - tmp2;
+            int tmp13 = tmp1 + tmp3;
+            int tmp12 = ifastMultiply(tmp1 - tmp3, fix_1_414213562) - tmp13;
+
+            tmp0 = tmp10 + tmp13;
+            tmp3 = tmp10 - tmp13;
+            tmp1 = tmp11 + tmp12;
+            tmp2 = tmp11 - tmp12;
+
+            // Odd part
+            int tmp4 = in[8] * q[8 + i];
+            int tmp5 = in[24] * q[24 + i];
+            int tmp6 = in[40] * q[40 + i];
+            int tmp7 = in[56] * q[56 + i];
+
+            const int z13 = tmp6 + tmp5;
+            const int z10 = tmp6 - tmp5;
+            const int z11 = tmp4 + tmp7;
+            const int z12 = tmp4 - tmp7;
+
+            tmp7 = z11 + z13;
+            tmp11 = ifastMultiply(z11 - z13, fix_1_414213562);
+            const int z5 = ifastMultiply(z10 + z12, fix_1_847759065);
+            tmp10 = ifastMultiply(z12, fix_1_082392200) - z5;
+            tmp12 = ifastMultiply(z10, -fix_2_613125930) + z5;
+
+            tmp6 = tmp12 - tmp7;
+            tmp5 = tmp11 - tmp6;
+            tmp4 = tmp10 + tmp5;
+
+            ws[0] = tmp0 + tmp7;
+            ws[56] = tmp0 - tmp7;
+            ws[8] = tmp1 + tmp6;
+            ws[48] = tmp1 - tmp6;
+            ws[16] = tmp2 + tmp5;
+            ws[40] = tmp2 - tmp5;
+            ws[32] = tmp3 + tmp4;
+            ws[24] = tmp3 - tmp4;
+        }
+
+        // Rows, removing the scaling and level shifting to samples
+        for (uint i = 0; i < 8; ++i)
+        {
+            const int *ws = workspace + i * 8;
+            int *out = component + i * 8;
+            if (ws[1] == 0 && ws[2] == 0 && ws[3] == 0 && ws[4] == 0 &&
+                ws[5] == 0 && ws[6] == 0 && ws[7] == 0)
+            {
+                const int dc = rangeLimit((ws[0] >> 5) + 128);
+                for (uint j = 0; j < 8; ++j)
+                {
+                    out[j] = dc;
+                }
+                continue;
+            }
+
+            // Even part
+            int tmp10 = ws[0] + ws[4];
+            int tmp11 = ws[0] - ws[4];
+            int tmp13 = ws[2] + ws[6];
+            int tmp12 = ifastMultiply(ws[2] - ws[6], fix_1_414213562) - tmp13;
+
+            const int tmp0 = tmp10 + tmp13;
+            const int tmp3 = tmp10 - tmp13;
+            const int tmp1 = tmp11 + tmp12;
+            const int tmp2 = tmp11 - tmp12;
+
+            // Odd part
+            const int z13 = ws[5] + ws[3];
+            const int z10 = ws[5] - ws[3];
+            const int z11 = ws[1] + ws[7];
+            const int z12 = ws[1] - ws[7];
+
+            const int tmp7 = z11 + z13;
+            tmp11 = ifastMultiply(z11 - z13, fix_1_414213562);
+            const int z5 = ifastMultiply(z10 + z12, fix_1_847759065);
+            tmp10 = ifastMultiply(z12, fix_1_082392200) - z5;
+            tmp12 = ifastMultiply(z10, -fix_2_613125930) + z5;
+
+            const int tmp6 = tmp12 - tmp7;
+            const int tmp5 = tmp11 - tmp6;
+            const int tmp4 = tmp10 + tmp5;
+
+            out[0] = rangeLimit(((tmp0 + tmp7) >> 5) + 128);
+            out[7] = rangeLimit(((tmp0 - tmp7) >> 5) + 128);
+            out[1] = rangeLimit(((tmp1 + tmp6) >> 5) + 128);
+            out[6] = rangeLimit(((tmp1 - tmp6) >> 5) + 128);
+            out[2] = rangeLimit(((tmp2 + tmp5) >> 5) + 128);
+            out[5] = rangeLimit(((tmp2 - tmp5) >> 5) + 128);
+            out[4] = rangeLimit(((tmp3 + tmp4) >> 5) + 128);
+            out[3] = rangeLimit(((tmp3 - tmp4) >> 5) + 128);
+        }
+    }
+
+#elif defined(MXGUI_JPEG_IDCT_ISLOW)
+
+    void JpegImage::prepareQuantizationTables(Header *const) {}
+
+    // Fixed point Loeffler-Ligtenberg-Moschytz inverse DCT, same as the
+    // libjpeg "islow" one. Constants are scaled up by 13 bits, and the
+    // intermediate results by 2 bits to keep more precision
+    const int islowConstBits = 13;
+    const int islowPass1Bits = 2;
+    const int fix_0_298631336 = 2446;
+    const int fix_0_390180644 = 3196;
+    const int fix_0_541196100 = 4433;
+    const int fix_0_765366865 = 6270;
+    const int fix_0_899976223 = 7373;
+    const int fix_1_175875602 = 9633;
+    const int fix_1_501321110 = 12299;
+    const int fix_1_847759065 = 15137;
+    const int fix_1_961570560 = 16069;
+    const int fix_2_053119869 = 16819;
+    const int fix_2_562915447 = 20995;
+    const int fix_3_072711026 = 25172;
+
+    void JpegImage::inverseDCTComponent(const QuantizationTable &qTable, int *const component) const
+    {
+        const uint *const q = qTable.table;
+        int workspace[64];
+
+        // Columns, dequantizing the coefficients
+        for (uint i = 0; i < 8; ++i)
         {
-            dequantizeMCUComponent(
-                header->quantizationTable[header->colorComponents[j].quantizationtableID],
-                mcu[j]);
+            const int *in = component + i;
+            int *ws = workspace + i;
+            if (in[8] == 0 && in[16] == 0 && in[24] == 0 && in[32] == 0 &&
+                in[40] == 0 && in[48] == 0 && in[56] == 0)
+            {
+                // Only the DC coefficient, the column is constant
+                const int dc = (in[0] * q[i]) << islowPass1Bits;
+                for (uint j = 0; j < 8; ++j)
+                {
+                    ws[j * 8] = dc;
+                }
+                continue;
+            }
+
+            // Even part
+            int z2 = in[16] * q[16 + i];
+            int z3 = in[48] * q[48 + i];
+            int z1 = (z2 + z3) * fix_0_541196100;
+            int tmp2 = z1 + z3 * -fix_1_847759065;
+            int tmp3 = z1 + z2 * fix_0_765366865;
+
+            z2 = in[0] * q[i];
+            z3 = in[32] * q[32 + i];
+            int tmp0 = (z2 + z3) << islowConstBits;
+            int tmp1 = (z2 - z3) << islowConstBits;
+
+            const int tmp10 = tmp0 + tmp3;
+            const int tmp13 = tmp0 - tmp3;
+            const int tmp11 = tmp1 + tmp2;
+            const int tmp12 = tmp1 - tmp2;
+
+            // Odd part
+            tmp0 = in[56] * q[56 + i];
+            tmp1 = in[40] * q[40 + i];
+            tmp2 = in[24] * q[24 + i];
+            tmp3 = in[8] * q[8 + i];
+
+            z1 = tmp0 + tmp3;
+            z2 = tmp1 + tmp2;
+            z3 = tmp0 + tmp2;
+            int z4 = tmp1 + tmp3;
+            const int z5 = (z3 + z4) * fix_1_175875602;
+
+            tmp0 = tmp0 * fix_0_298631336;
+            tmp1 = tmp1 * fix_2_053119869;
+            tmp2 = tmp2 * fix_3_072711026;
+            tmp3 = tmp3 * fix_1_501321110;
+            z1 = z1 * -fix_0_899976223;
+            z2 = z2 * -fix_2_562915447;
+            z3 = z3 * -fix_1_961570560 + z5;
+            z4 = z4 * -fix_0_390180644 + z5;
+
+            tmp0 += z1 + z3;
+            tmp1 += z2 + z4;
+            tmp2 += z2 + z3;
+            tmp3 += z1 + z4;
+
+            const int n = islowConstBits - islowPass1Bits;
+            ws[0] = descale(tmp10 + tmp3, n);
+            ws[56] = descale(tmp10 - tmp3, n);
+            ws[8] = descale(tmp11 + tmp2, n);
+            ws[48] = descale(tmp11 - tmp2, n);
+            ws[16] = descale(tmp12 + tmp1, n);
+            ws[40] = descale(tmp12 - tmp1, n);
+            ws[24] = descale(tmp13 + tmp0, n);
+            ws[32] = descale(tmp13 - tmp0, n);
         }
 
-        return mcu;
+        // Rows, removing the scaling and level shifting to samples
+        for (uint i = 0; i < 8; ++i)
+        {
+            const int *ws = workspace + i * 8;
+            int *out = component + i * 8;
+            if (ws[1] == 0 && ws[2] == 0 && ws[3] == 0 && ws[4] == 0 &&
+                ws[5] == 0 && ws[6] == 0 && ws[7] == 0)
+            {
+                const int dc = rangeLimit(descale(ws[0], islowPass1Bits + 3) + 128);
+                for (uint j = 0; j < 8; ++j)
+                {
+                    out[j] = dc;
+                }
+                continue;
+            }
+
+            // Even part
+            int z2 = ws[2];
+            int z3 = ws[6];
+            int z1 = (z2 + z3) * fix_0_541196100;
+            int tmp2 = z1 + z3 * -fix_1_847759065;
+            int tmp3 = z1 + z2 * fix_0_765366865;
+
+            int tmp0 = (ws[0] + ws[4]) << islowConstBits;
+            int tmp1 = (ws[0] - ws[4]) << islowConstBits;
+
+            const int tmp10 = tmp0 + tmp3;
+            const int tmp13 = tmp0 - tmp3;
+            const int tmp11 = tmp1 + tmp2;
+            const int tmp12 = tmp1 - tmp2;
+
+            // Odd part
+            tmp0 = ws[7];
+            tmp1 = ws[5];
+            tmp2 = ws[3];
+            tmp3 = ws[1];
+
+            z1 = tmp0 + tmp3;
+            z2 = tmp1 + tmp2;
+            z3 = tmp0 + tmp2;
+            int z4 = tmp1 + tmp3;
+            const int z5 = (z3 + z4) * fix_1_175875602;
+
+            tmp0 = tmp0 * fix_0_298631336;
+            tmp1 = tmp1 * fix_2_053119869;
+            tmp2 = tmp2 * fix_3_072711026;
+            tmp3 = tmp3 * fix_1_501321110;
+            z1 = z1 * -fix_0_899976223;
+            z2 = z2 * -fix_2_562915447;
+            z3 = z3 * -fix_1_961570560 + z5;
+            z4 = z4 * -fix_0_390180644 + z5;
+
+            tmp0 += z1 + z3;
+            tmp1 += z2 + z4;
+            tmp2 += z2 + z3;
+            tmp3 += z1 + z4;
+
+            const int n = islowConstBits + islowPass1Bits + 3;
+            out[0] = rangeLimit(descale(tmp10 + tmp3, n) + 128);
+            out[7] = rangeLimit(descale(tmp10 - tmp3, n) + 128);
+            out[1] = rangeLimit(descale(tmp11 + tmp2, n) + 128);
+            out[6] = rangeLimit(descale(tmp11 - tmp2, n) + 128);
+            out[2] = rangeLimit(descale(tmp12 + tmp1, n) + 128);
+            out[5] = rangeLimit(descale(tmp12 - tmp1, n) + 128);
+            out[3] = rangeLimit(descale(tmp13 + tmp0, n) + 128);
+            out[4] = rangeLimit(descale(tmp13 - tmp0, n) + 128);
+        }
     }
 
+#else // MXGUI_JPEG_IDCT_FLOAT
+
+    void JpegImage::prepareQuantizationTables(Header *const) {}
+
     // We want to follow the optimizarion of the Inverse transform by using row column decomposition, using AAN
 
     // There are two more optimization that could be done
-    void JpegImage::inverseDCTComponent(int *const component) const
+    void JpegImage::inverseDCTComponent(const QuantizationTable &qTable, int *const component) const
     {
+        float workspace[64];
         for (uint i = 0; i < 8; ++i)
         {
-            const float g0 = component[0 * 8 + i] * s0;
-            const float g1 = component[4 * 8 + i] * s4;
-            const float g2 = component[2 * 8 + i] * s2;
-            const float g3 = component[6 * 8 + i] * s6;
-            const float g4 = component[5 * 8 + i] * s5;
-            const float g5 = component[1 * 8 + i] * s1;
-            const float g6 = component[7 * 8 + i] * s7;
-            const float g7 = component[3 * 8 + i] * s3;
-
+            const float g0 = component[0 * 8 + i] * static_cast<int>(qTable.table[0 * 8 + i]) * s0;
+            const float g1 = component[4 * 8 + i] * static_cast<int>(qTable.table[4 * 8 + i]) * s4;
+            const float g2 = component[2 * 8 + i] * static_cast<int>(qTable.table[2 * 8 + i]) * s2;
+            const float g3 = component[6 * 8 + i] * static_cast<int>(qTable.table[6 * 8 + i]) * s6;
+            const float g4 = component[5 * 8 + i] * static_cast<int>(qTable.table[5 * 8 + i]) * s5;
+            const float g5 = component[1 * 8 + i] * static_cast<int>(qTable.table[1 * 8 + i]) * s1;
+            const float g6 = component[7 * 8 + i] * static_cast<int>(qTable.table[7 * 8 + i]) * s7;
+            const float g7 = component[3 * 8 + i] * static_cast<int>(qTable.table[3 * 8 + i]) * s3;
             const float f0 = g0;
             const float f1 = g1;
             const float f2 = g2;
@@ -972,27 +1412,26 @@ namespace mxgui
             const float b6 = c6 - c7;
             const float b7 = c7;
 
-            component[0 * 8 + i] = b0 + b7;
-            component[1 * 8 + i] = b1 + b6;
-            component[2 * 8 + i] = b2 + b5;
-            component[3 * 8 + i] = b3 + b4;
-            component[4 * 8 + i] = b3 - b4;
-            component[5 * 8 + i] = b2 - b5;
-            component[6 * 8 + i] = b1 - b6;
-            component[7 * 8 + i] = b0 - b7;
+            workspace[0 * 8 + i] = b0 + b7;
+            workspace[1 * 8 + i] = b1 + b6;
+            workspace[2 * 8 + i] = b2 + b5;
+            workspace[3 * 8 + i] = b3 + b4;
+            workspace[4 * 8 + i] = b3 - b4;
+            workspace[5 * 8 + i] = b2 - b5;
+            workspace[6 * 8 + i] = b1 - b6;
+            workspace[7 * 8 + i] = b0 - b7;
         }
 
         for (uint i = 0; i < 8; ++i)
         {
-            const float g0 = component[i * 8 + 0] * s0;
-            const float g1 = component[i * 8 + 4] * s4;
-            const float g2 = component[i * 8 + 2] * s2;
-            const float g3 = component[i * 8 + 6] * s6;
-            const float g4 = component[i * 8 + 5] * s5;
-            const float g5 = component[i * 8 + 1] * s1;
-            const float g6 = component[i * 8 + 7] * s7;
-            const float g7 = component[i * 8 + 3] * s3;
-
+            const float g0 = workspace[i * 8 + 0] * s0;
+            const float g1 = workspace[i * 8 + 4] * s4;
+            const float g2 = workspace[i * 8 + 2] * s2;
+            const float g3 = workspace[i * 8 + 6] * s6;
+            const float g4 = workspace[i * 8 + 5] * s5;
+            const float g5 = workspace[i * 8 + 1] * s1;
+            const float g6 = workspace[i * 8 + 7] * s7;
+            const float g7 = workspace[i * 8 + 3] * s3;
             const float f0 = g0;
             const float f1 = g1;
             const float f2 = g2;
@@ -1041,63 +1480,308 @@ namespace mxgui
             const float b6 = c6 - c7;
             const float b7 = c7;
 
-            component[i * 8 + 0] = b0 + b7 + 0.5f;
-            component[i * 8 + 1] = b1 + b6 + 0.5f;
-            component[i * 8 + 2] = b2 + b5 + 0.5f;
-            component[i * 8 + 3] = b3 + b4 + 0.5f;
-            component[i * 8 + 4] = b3 - b4 + 0.5f;
-            component[i * 8 + 5] = b2 - b5 + 0.5f;
-            component[i * 8 + 6] = b1 - b6 + 0.5f;
-            component[i * 8 + 7] = b0 - b7 + 0.5f;
+            // Level shift to samples, rounding
+            component[i * 8 + 0] = rangeLimit(b0 + b7 + 128.5f);
+            component[i * 8 + 1] = rangeLimit(b1 + b6 + 128.5f);
+            component[i * 8 + 2] = rangeLimit(b2 + b5 + 128.5f);
+            component[i * 8 + 3] = rangeLimit(b3 + b4 + 128.5f);
+            component[i * 8 + 4] = rangeLimit(b3 - b4 + 128.5f);
+            component[i * 8 + 5] = rangeLimit(b2 - b5 + 128.5f);
+            component[i * 8 + 6] = rangeLimit(b1 - b6 + 128.5f);
+            component[i * 8 + 7] = rangeLimit(b0 - b7 + 128.5f);
         }
     }
 
-    MCU JpegImage::inverseDCT(const Header *const header, MCU mcu) const
+#endif // MXGUI_JPEG_IDCT_FLOAT
+
+    // Reduced size inverse DCTs, same as the libjpeg ones used when scaling.
+    // They compute the low frequency part of the 8x8 inverse DCT, so the
+    // coefficients they do not use need not be transformed at all. Whatever
+    // inverse DCT is selected, they are fixed point with constants scaled up
+    // by 13 bits and the intermediate results by 2 bits
+    const int reducedConstBits = 13;
+    const int reducedPass1Bits = 2;
+
+    // 4x4 samples, for 1/2 scale
+    static void inverseDCT4x4(const uint *const q, int *const component)
+    {
+        const int fix_0_211164243 = 1730;
+        const int fix_0_509795579 = 4176;
+        const int fix_0_601344887 = 4926;
+        const int fix_0_765366865 = 6270;
+        const int fix_0_899976223 = 7373;
+        const int fix_1_061594337 = 8697;
+        const int fix_1_451774981 = 11893;
+        const int fix_1_847759065 = 15137;
+        const int fix_2_172734803 = 17799;
+        const int fix_2_562915447 = 20995;
+        int workspace[8 * 4];
+
+        // Columns, dequantizing the coefficients. Row 4 contributes nothing
+        for (uint i = 0; i < 8; ++i)
+        {
+            if (i == 4)
+            {
+                continue; // The second pass does not use column 4
+            }
+            const int *in = component + i;
+            int *ws = workspace + i;
+            if (in[8] == 0 && in[16] == 0 && in[24] == 0 &&
+                in[40] == 0 && in[48] == 0 && in[56] == 0)
+            {
+                const int dc = static_cast<int>(in[0] * q[i]) << reducedPass1Bits;
+                ws[0] = ws[8] = ws[16] = ws[24] = dc;
+                continue;
+            }
+
+            // Even part
+            const int tmp0 = static_cast<int>(in[0] * q[i]) << (reducedConstBits + 1);
+            int z2 = in[16] * q[16 + i];
+            int z3 = in[48] * q[48 + i];
+            const int tmp2 = z2 * fix_1_847759065 + z3 * -fix_0_765366865;
+            const int tmp10 = tmp0 + tmp2;
+            const int tmp12 = tmp0 - tmp2;
+
+            // Odd part
+            const int z1 = in[56] * q[56 + i];
+            z2 = in[40] * q[40 + i];
+            z3 = in[24] * q[24 + i];
+            const int z4 = in[8] * q[8 + i];
+            const int odd0 = z1 * -fix_0_211164243 + z2 * fix_1_451774981 +
+                             z3 * -fix_2_172734803 + z4 * fix_1_061594337;
+            const int odd2 = z1 * -fix_0_509795579 + z2 * -fix_0_601344887 +
+                             z3 * fix_0_899976223 + z4 * fix_2_562915447;
+
+            const int n = reducedConstBits - reducedPass1Bits + 1;
+            ws[0] = descale(tmp10 + odd2, n);
+            ws[24] = descale(tmp10 - odd2, n);
+            ws[8] = descale(tmp12 + odd0, n);
+            ws[16] = descale(tmp12 - odd0, n);
+        }
+
+        // Rows, removing the scaling and level shifting to samples
+        for (uint i = 0; i < 4; ++i)
+        {
+            const int *ws = workspace + i * 8;
+            int *out = component + i * 4;
+            if (ws[1] == 0 && ws[2] == 0 && ws[3] == 0 &&
+                ws[5] == 0 && ws[6] == 0 && ws[7] == 0)
+            {
+                out[0] = out[1] = out[2] = out[3] =
+                    rangeLimit(descale(ws[0], reducedPass1Bits + 3) + 128);
+                continue;
+            }
+
+            // Even part
+            const int tmp0 = ws[0] << (reducedConstBits + 1);
+            const int tmp2 = ws[2] * fix_1_847759065 + ws[6] * -fix_0_765366865;
+            const int tmp10 = tmp0 + tmp2;
+            const int tmp12 = tmp0 - tmp2;
+
+            // Odd part
+            const int odd0 = ws[7] * -fix_0_211164243 + ws[5] * fix_1_451774981 +
+                             ws[3] * -fix_2_172734803 + ws[1] * fix_1_061594337;
+            const int odd2 = ws[7] * -fix_0_509795579 + ws[5] * -fix_0_601344887 +
+                             ws[3] * fix_0_899976223 + ws[1] * fix_2_562915447;
+
+            const int n = reducedConstBits + reducedPass1Bits + 3 + 1;
+            out[0] = rangeLimit(descale(tmp10 + odd2, n) + 128);
+            out[3] = rangeLimit(descale(tmp10 - odd2, n) + 128);
+            out[1] = rangeLimit(descale(tmp12 + odd0, n) + 128);
+            out[2] = rangeLimit(descale(tmp12 - odd0, n) + 128);
+        }
+    }
+
+    // 2x2 samples, for 1/4 scale
+    static void inverseDCT2x2(const uint *const q, int *const component)
+    {
+        const int fix_0_720959822 = 5906;
+        const int fix_0_850430095 = 6967;
+        const int fix_1_272758580 = 10426;
+        const int fix_3_624509785 = 29692;
+        int workspace[8 * 2];
+
+        // Columns, dequantizing the coefficients. Even rows but 0 contribute
+        // nothing
+        for (uint i = 0; i < 8; ++i)
+        {
+            if (i == 2 || i == 4 || i == 6)
+            {
+                continue; // The second pass does not use even columns but 0
+            }
+            const int *in = component + i;
+            int *ws = workspace + i;
+            if (in[8] == 0 && in[24] == 0 && in[40] == 0 && in[56] == 0)
+            {
+                const int dc = static_cast<int>(in[0] * q[i]) << reducedPass1Bits;
+                ws[0] = ws[8] = dc;
+                continue;
+            }
+
+            const int even = static_cast<int>(in[0] * q[i]) << (reducedConstBits + 2);
+            const int odd = static_cast<int>(in[56] * q[56 + i]) * -fix_0_720959822 +
+                            static_cast<int>(in[40] * q[40 + i]) * fix_0_850430095 +
+                            static_cast<int>(in[24] * q[24 + i]) * -fix_1_272758580 +
+                            static_cast<int>(in[8] * q[8 + i]) * fix_3_624509785;
+
+            const int n = reducedConstBits - reducedPass1Bits + 2;
+            ws[0] = descale(even + odd, n);
+            ws[8] = descale(even - odd, n);
+        }
+
+        // Rows, removing the scaling and level shifting to samples
+        for (uint i = 0; i < 2; ++i)
+        {
+            const int *ws = workspace + i * 8;
+            int *out = component + i * 2;
+            if (ws[1] == 0 && ws[3] == 0 && ws[5] == 0 && ws[7] == 0)
+            {
+                out[0] = out[1] = rangeLimit(descale(ws[0], reducedPass1Bits + 3) + 128);
+                continue;
+            }
+
+            const int even = ws[0] << (reducedConstBits + 2);
+            const int odd = ws[7] * -fix_0_720959822 + ws[5] * fix_0_850430095 +
+                            ws[3] * -fix_1_272758580 + ws[1] * fix_3_624509785;
+
+            const int n = reducedConstBits + reducedPass1Bits + 3 + 2;
+            out[0] = rangeLimit(descale(even + odd, n) + 128);
+            out[1] = rangeLimit(descale(even - odd, n) + 128);
+        }
+    }
+
+    // A single sample, for 1/8 scale, only needs the DC coefficient
+    static void inverseDCT1x1(const uint *const q, int *const component)
+    {
+        component[0] = rangeLimit(descale(static_cast<int>(component[0] * q[0]), 3) + 128);
+    }
+
+    void JpegImage::inverseDCT(MCU &mcu) const
     {
 
         for (uint j = 0; j < header->numComponents; ++j)
         {
-            inverseDCTComponent(mcu[j]);
+            const ColorComponent &component = header->colorComponents[j];
+            const QuantizationTable &qTable = header->quantizationTable[component.quantizationtableID];
+            const uint blocks = component.horizontalSamplingFactor * component.verticalSamplingFactor;
+            for (uint k = 0; k < blocks; ++k)
+            {
+                int *const block = mcu[j] + 64 * k;
+                switch (component.scaleShift)
+                {
+                case 0:
+                    inverseDCTComponent(qTable, block);
+                    break;
+                case 1:
+                    inverseDCT4x4(qTable.table, block);
+                    break;
+                case 2:
+                    inverseDCT2x2(qTable.table, block);
+                    break;
+                default:
+                    inverseDCT1x1(qTable.table, block);
+                    break;
+                }
+            }
         }
-        return mcu;
     }
 
-    MCU JpegImage::YCbCrToRGBMCU(MCU mcu) const
+    // Fixed point JFIF YCbCr to RGB conversion, same as the libjpeg one.
+    // Constants are scaled up by 16 bits
+    const int colorFracBits = 16;
+    const int colorHalf = 1 << (colorFracBits - 1);
+    const int fix_1_40200 = 91881;
+    const int fix_1_77200 = 116130;
+    const int fix_0_71414 = 46802;
+    const int fix_0_34414 = 22554;
+
+    static inline Color toRGB565(int r, int g, int b)
     {
-        for (uint i = 0; i < 64; ++i)
-        {
-            int r = mcu.y[i] + 1.40f * mcu.cr[i] + 128;
-            int g = mcu.y[i] - 0.344f * mcu.cb[i] - 0.714f * mcu.cr[i] + 128;
-            int b = mcu.y[i] + 1.722f * mcu.cb[i] + 128;
-
-            if (r < 0)
-                r = 0;
-            if (r > 225)
-                r = 255;
-            if (g < 0)
-                g = 0;
-            if (g > 255)
-                g = 255;
-            if (b < 0)
-                b = 0;
-            if (b > 225)
-                b = 255;
-            mcu.r[i] = r;
-            mcu.b[i] = b;
-            mcu.g[i] = g;
-        }
-        return mcu;
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
     }
 
-    MCU JpegImage::processOneMCU(Header *const header, MCU mcu, int index, BitReader &bitReader, int previousDCs[3]) const
+    // Convert an MCU whose luma blocks are n x n samples to pixels. The block
+    // size is a template parameter so that indexing the luma samples takes
+    // no divisions, and no more operations than at full size
+    template <uint n>
+    static void colorConvertMCU(const MCU &mcu, const ColorComponent *components,
+                                uint h, uint v, Color *dest, uint rowStride)
     {
+        // Chroma may be decoded at a larger size than luma, needing less
+        // upsampling than the sampling factors say
+        const uint chromaSize = 8 >> components[1].scaleShift;
+        const uint uh = n * h / chromaSize;
+        const uint uv = n * v / chromaSize;
+        for (uint i = 0; i < chromaSize; ++i)
+        {
+            for (uint j = 0; j < chromaSize; ++j)
+            {
+                const int cb = mcu.cb[i * chromaSize + j] - 128;
+                const int cr = mcu.cr[i * chromaSize + j] - 128;
+                const int red = (fix_1_40200 * cr + colorHalf) >> colorFracBits;
+                const int green = (-fix_0_34414 * cb - fix_0_71414 * cr + colorHalf) >> colorFracBits;
+                const int blue = (fix_1_77200 * cb + colorHalf) >> colorFracBits;
+                for (uint dy = 0; dy < uv; ++dy)
+                {
+                    const uint py = i * uv + dy; // Pixel coordinates in the MCU
+                    for (uint dx = 0; dx < uh; ++dx)
+                    {
+                        const uint px = j * uh + dx;
+                        const int y = mcu.y[((py / n) * h + px / n) * 64 + (py % n) * n + px % n];
+                        dest[py * rowStride + px] = toRGB565(rangeLimit(y + red),
+                                                             rangeLimit(y + green),
+                                                             rangeLimit(y + blue));
+                    }
+                }
+            }
+        }
+    }
+
+    // Convert an MCU to pixels, written to dest with rowStride pixels per line.
+    // Subsampled chroma is upsampled by replication while converting, the
+    // chroma terms are computed once and added to all the luma samples
+    // sharing them, as in the libjpeg merged upsampler
+    void JpegImage::YCbCrToRGB(const MCU &mcu, Color *dest) const
+    {
+        const uint n = blockSize;
+        if (header->numComponents == 1)
+        {
+            for (uint i = 0; i < n * n; i += n, dest += rowStride)
+            {
+                for (uint j = 0; j < n; ++j)
+                {
+                    const int y = mcu.y[i + j];
+                    dest[j] = toRGB565(y, y, y);
+                }
+            }
+            return;
+        }
+
+        const uint h = header->horizontalSamplingFactor;
+        const uint v = header->verticalSamplingFactor;
+        switch (scaleShift)
+        {
+        case 0:
+            colorConvertMCU<8>(mcu, header->colorComponents, h, v, dest, rowStride);
+            break;
+        case 1:
+            colorConvertMCU<4>(mcu, header->colorComponents, h, v, dest, rowStride);
+            break;
+        case 2:
+            colorConvertMCU<2>(mcu, header->colorComponents, h, v, dest, rowStride);
+            break;
+        default:
+            colorConvertMCU<1>(mcu, header->colorComponents, h, v, dest, rowStride);
+            break;
+        }
+    }
 
-        mcu = decodeHuffmanData(header, mcu, index, bitReader, previousDCs);
-        mcu = dequantize(header, mcu);
-        mcu = inverseDCT(header, mcu);
-        mcu = YCbCrToRGBMCU(mcu);
-        index++;
-        return mcu;
+    // Decode an MCU in place, and write its pixels to dest
+    void JpegImage::processOneMCU(int index, Color *dest) const
+    {
+        decodeHuffmanData(*mcu, index);
+        inverseDCT(*mcu);
+        YCbCrToRGB(*mcu, dest);
     }
 
 } // namespace mxgui
\ No newline at end of file
@@ -4,8 +4,7 @@
 #include "image.h"
 #include "byte_reader.h"
 #include <string>
-#include <fstream>
-#include <vector> //least painful since we dont now how long the huffmancode are
+#include <vector>
 #include <cmath>
 #include <deque>
 #include <memory>
@@ -13,9 +12,19 @@
 
 
 
-namespace mxgui {
+// The inverse DCT is selected in mxgui_settings.h, default to the accurate
+// integer one for configurations that do not choose it. If more than one is
+// defined the float one has the precedence, then the fast integer one
+#if defined(MXGUI_JPEG_IDCT_FLOAT)
+#undef MXGUI_JPEG_IDCT_IFAST
+#undef MXGUI_JPEG_IDCT_ISLOW
+#elif defined(MXGUI_JPEG_IDCT_IFAST)
+#undef MXGUI_JPEG_IDCT_ISLOW
+#else
+#define MXGUI_JPEG_IDCT_ISLOW
+#endif
 
-   
+namespace mxgui {
 
 
     typedef unsigned char byte;
@@ -113,11 +122,19 @@ namespace mxgui {
         bool set = false; // True if is popolized
     };
 
+    // Number of bits decoded at once through the Huffman lookup table. Most
+    // symbols have codes not longer than this, longer ones take a slower path
+    const int huffmanLookupBits = 9;
+
     struct HuffmanTable
     {
         byte offset[17] = {0}; // Here we save the offset of each of the 16 jagged array
         byte symbols[162] = {0};
-        uint codes[162] = {0};
+        // Indexed by the next huffmanLookupBits bits of data, code length in
+        // the upper byte and symbol in the lower one, 0 if the code is longer
+        unsigned short lookup[1 << huffmanLookupBits] = {0};
+        int maxCode[17] = {0};   // Largest code of each length, -1 if none
+        int valueOffset[17] = {0}; // Index in symbols minus the first code of each length
         bool set = false;
     };
 
@@ -128,11 +145,19 @@ namespace mxgui {
         byte quantizationtableID = 0;
         byte huffmanDCTableID = 0;
         byte huffmanACTableID = 0;
+        byte scaleShift = 0; // Blocks are decoded to 8 >> scaleShift pixels per side
         bool used = false;
     };
 
 
 
+    // Where decoding can resume to reach a row of MCUs, from the restart index
+    struct RestartPoint
+    {
+        uint offset = 0;   // File offset of the restart interval, 0 if unknown
+        uint interval = 0; // Number of the restart interval
+    };
+
     // Here is the data structure for the entire jpeg file (header is not appropriate)
     struct Header
     {
@@ -151,14 +176,14 @@ namespace mxgui {
         byte succesiveApproximationHigh = 0;
         byte succesiveApproximationLow = 0;
 
-        std::vector<byte> huffmanData; // least painful way dont knoww the size
+        uint scanOffset = 0; // File offset of the entropy coded data
 
         uint reastartInterval = 0;
         ColorComponent colorComponents[3];
         bool valid = true;
 
-        uint mcuHeight = 0;
-        uint mcuWidth = 0;
+        uint mcuHeight = 0; // Rows of MCUs
+        uint mcuWidth = 0;  // MCUs in a row
         uint mcuHeightReal = 0;
         uint mcuWidthReal = 0;
 
@@ -167,23 +192,13 @@ namespace mxgui {
     };
 
     struct MCU {
-        union
-        { 
-            // same addres in memory with multiple names
-            int y[64] = {0};
-            int r[64];
-        };
-        union
-        {
-            int cb[64] = {0};
-            int g[64];
-        };
-        union
-        {
-
-            int cr[64] = {0};
-            int b[64];
-        };
+        // Components, after the inverse DCT they hold samples in the 0..255 range.
+        // Luma has up to 2x2 blocks, left to right and top to bottom. When
+        // decoding at a reduced scale each block only uses its first n*n
+        // entries, n samples per line
+        int y[4 * 64] = {0};
+        int cb[64] = {0};
+        int cr[64] = {0};
 
         int* operator[](uint i ){
             switch (i)
@@ -200,7 +215,7 @@ namespace mxgui {
         }
     };
 
-    // IDCT scaling factors
+    // Float IDCT scaling factors
     const float m0 = 2.0 * std::cos(1.0 / 16.0 * 2.0 * M_PI);
     const float m1 = 2.0 * std::cos(2.0 / 16.0 * 2.0 * M_PI);
     const float m3 = 2.0 * std::cos(2.0 / 16.0 * 2.0 * M_PI);
@@ -230,29 +245,40 @@ namespace mxgui {
         53, 60, 61, 54, 47, 55, 62, 63};
         
 
-//Do not support sampling factors and progresssive jpeg
+//Supports baseline jpeg, with chroma at full resolution (4:4:4) or
+//subsampled by 2 horizontally (4:2:2), vertically or both (4:2:0).
+//Do not support progresssive jpeg
+//Images can be decoded at 1/2, 1/4 or 1/8 of their size, for instance to make
+//thumbnails, with reduced size inverse DCTs that are much cheaper than
+//decoding at full size and throwing pixels away
+//Every instance has its own decoding state and buffers, so different
+//instances can be drawn concurrently from different threads
 class JpegImage : public ImageBase { 
 public:
     /**
      * Default constructor
      */
-    JpegImage() : ImageBase(100,100), name(0), f(0) {}
+    JpegImage() : ImageBase(100,100), name(0), header(0) {}
 
     /**
      * Construct from a filename
      * \param filename file name of jpeg image
+     * \param scale the image is decoded at 1/scale of its size, must be 1, 2,
+     * 4 or 8. getWidth() and getHeight() return the scaled size
      */
-    explicit JpegImage(const std::string &filename): name(0),
-     header(0) {this->open(filename); }
+    explicit JpegImage(const std::string &filename, unsigned int scale=1):
+     name(0), header(0) {this->open(filename,scale); }
 
     /**
      * Open a jpeg file
      * \param filename file name of jpeg image
+     * \param scale the image is decoded at 1/scale of its size, must be 1, 2,
+     * 4 or 8. getWidth() and getHeight() return the scaled size
      */
-    void open(const std::string &filename);
+    void open(const std::string &filename, unsigned int scale=1);
 
     /**
-     * Close tga file
+     * Close jpeg file
      */
     void close();
 
@@ -265,7 +291,10 @@ public:
      * Copy constructor
      * \param rhs instance to copy from
      */
-    JpegImage(const JpegImage& rhs): name(0) { this->open(rhs.name); }
+    JpegImage(const JpegImage& rhs): name(0), header(0)
+    {
+        if(rhs.name) this->open(rhs.name,1<<rhs.scaleShift);
+    }
 
      /**
      * Operator =
@@ -274,7 +303,11 @@ public:
      */
     const JpegImage& operator= (const JpegImage& rhs)
     {
-        if(this!=&rhs) this->open(rhs.name);
+        if(this!=&rhs)
+        {
+            if(rhs.name) this->open(rhs.name,1<<rhs.scaleShift);
+            else this->close();
+        }
         return *this;
     }
 
@@ -303,51 +336,58 @@ public:
 private:
 
     char* name;
-    mutable int current_height=0;
-    FILE *f;
     mutable Header* header;
-    mutable int* previousDCs;
+    byte scaleShift=0; ///< The image is decoded at 1/(2^scaleShift) of its size
+    mutable ByteReader reader; ///< Streams the file, no need to load it in RAM
     mutable BitReader b;
-    mutable int previousIndex = -1;
-    mutable int index = 0;
+    mutable int previousDCs[3]={0};
+    mutable int nextMcu=-1;       ///< Next MCU to decode, -1 if not started
+    mutable int resumeMcu=0;      ///< MCU where decoding was last resumed
+    mutable int decodedMcuRow=-1; ///< Row of MCUs in rowBuffer, -1 if none
     mutable bool isValid= true;
-    mutable bool isFirstLine=true;
 
-    
+    // Buffers, allocated in a single block sized to the image when opened
+    char *arena=nullptr;
+    MCU *mcu=nullptr;         ///< Coefficients of the MCU being decoded
+    Color *rowBuffer=nullptr; ///< Decoded pixels of a row of MCUs
+    uint rowStride=0;         ///< Pixels in a line of rowBuffer
+    uint blockSize=8;         ///< Pixels per side of a decoded luma block
+    /// For each row of MCUs the closest restart interval starting before it,
+    /// nullptr if the image has no restart intervals
+    RestartPoint *restartIndex=nullptr;
 
     // Reading functions
     Header* readJPG(const std::string &filename);
-    bool readStartOfFrame(std::ifstream &inFile, Header *const header);
-    void readQuantizationTable(std::ifstream &inFile, Header *const header);
-    void readHuffmanTable(std::ifstream &inFile, Header *const header);
-    void readStartOfScan(std::ifstream &inFile, Header *const header);
-    void readRestartInterval(std::ifstream &inFile, Header *const header);
-    void readAPPN(std::ifstream &inFile, Header *const header);
-    void readComment(std::ifstream &inFile, Header *const header);
+    bool readStartOfFrame(ByteReader &inFile, Header *const header);
+    void readQuantizationTable(ByteReader &inFile, Header *const header);
+    void readHuffmanTable(ByteReader &inFile, Header *const header);
+    void readStartOfScan(ByteReader &inFile, Header *const header);
+    void readRestartInterval(ByteReader &inFile, Header *const header);
+    void readAPPN(ByteReader &inFile, Header *const header);
+    void readComment(ByteReader &inFile, Header *const header);
 
     //Decoding functions
     void generateCode(HuffmanTable &hTable);
     byte getNextSymbol(BitReader &b, const HuffmanTable &hTable) const;
     bool decodeMCUComponents(BitReader &b, int *const component, int &previousDC, const HuffmanTable &dcTable, const HuffmanTable &acTable) const;
-    void dequantizeMCUComponent(const QuantizationTable& qTable, int* const component) const;
-    MCU decodeHuffmanData(Header *const header, MCU mcu, int index, BitReader &bitReader, int previousDCs[3]) const;
+    void decodeHuffmanData(MCU &mcu, int index) const;
     void generateCodes(Header *const header);
-    MCU inverseDCT(const Header* const header, MCU  mcu) const;
-    void inverseDCTComponent( int* const component) const;
-    MCU dequantize(const Header* const header, MCU mcu) const;
-    MCU processOneMCU(Header *const header,MCU mcu, int index, BitReader &bitReader, int previousDCs[3]) const;
-    MCU YCbCrToRGBMCU(MCU mcu) const;
+    void prepareQuantizationTables(Header *const header);
+    void inverseDCT(MCU &mcu) const;
+    void inverseDCTComponent(const QuantizationTable& qTable, int* const component) const;
+    void scaleComponents(Header *const header);
+    void YCbCrToRGB(const MCU &mcu, Color *dest) const;
+    void processOneMCU(int index, Color *dest) const;
+    bool decodeMCURow(int row) const;
+    void buildRestartIndex();
 
 
 void reset() const{
-    previousDCs = new int[3]{0};
-    // Reset other member variables to their initial states
-    current_height = 0;
-    b.reset(); // This will destroy the managed BitReader object, if any, and reset the unique_ptr
-    previousIndex = -1;
-    index = 0;
-    isFirstLine = true;
-
+    previousDCs[0] = previousDCs[1] = previousDCs[2] = 0;
+    // The next row will be decoded starting again from the scan start
+    b.reset();
+    nextMcu = -1;
+    decodedMcuRow = -1;
 }
 
 
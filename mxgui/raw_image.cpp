@@ -0,0 +1,177 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "raw_image.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+namespace mxgui {
+
+/// Size of the header of uncompressed images
+static const unsigned int headerSize=3*sizeof(unsigned short);
+/// Compressed images have a padding short and then the line offsets
+static const unsigned int lineOffsetsStart=4*sizeof(unsigned short);
+
+void RawImage::open(const char *filename)
+{
+    this->close();
+    if(filename==0) return;
+    if(reader.open(filename)==false) return;
+
+    #if defined(MXGUI_COLOR_DEPTH_8_BIT)
+    const int expectedDepth=8;
+    #elif defined(MXGUI_COLOR_DEPTH_16_BIT)
+    const int expectedDepth=16;
+    #else
+    const int expectedDepth=-1; //1 bit linear images are not supported
+    #endif
+    int h=readShort();
+    int w=readShort();
+    int depth=readShort();
+    bool fail=h<=0 || w<=0 || depth<0;
+    if((depth & ~rleFlag)!=expectedDepth) fail=true;
+    if((depth & rleFlag) && expectedDepth!=16) fail=true;
+    if(fail)
+    {
+        reader.close();
+        return;
+    }
+    this->height=h;
+    this->width=w;
+    this->rle=depth & rleFlag;
+
+    //Uncompressed images in a memory mapped filesystem are used in place
+    const unsigned int size=headerSize+h*w*sizeof(Color);
+    if(rle==false && reader.data()!=0 && reader.size()>=size)
+        data=reinterpret_cast<const Color*>(reader.data()+headerSize);
+
+    //Last, copy file name to local variable
+    int length=strlen(filename)+1;
+    this->name=new char[length];
+    strcpy(this->name,filename);
+}
+
+void RawImage::close()
+{
+    if(this->name==0) return;
+    delete[] this->name;
+    this->name=0;
+    reader.close();
+    data=0;
+    rle=false;
+    this->width=0;
+    this->height=0;
+}
+
+bool RawImage::getScanLine(mxgui::Point p, mxgui::Color colors[],
+        unsigned short length) const
+{
+    if(isOpen()==false) return false;
+    if(p.x()<0 || p.y()<0 || p.y()>=this->height) return false;
+    if(p.x()+length>this->width) return false;
+
+    if(data)
+    {
+        const Color *line=data+p.x()+p.y()*this->width;
+        copy(line,line+length,colors);
+        return true;
+    }
+
+    if(rle==false)
+    {
+        int offset=headerSize+(p.x()+p.y()*this->width)*sizeof(Color);
+        if(reader.seek(offset)==false) return false;
+        for(unsigned short i=0;i<length;i++)
+        {
+            #ifdef MXGUI_COLOR_DEPTH_16_BIT
+            int c=readShort();
+            #else
+            int c=reader.get();
+            #endif
+            if(c<0) return false;
+            colors[i]=c;
+        }
+        return true;
+    }
+
+    //Compressed lines are found through the line offsets, then the runs
+    //before p.x() are skipped
+    if(reader.seek(lineOffsetsStart+4*p.y())==false) return false;
+    int low=readShort();
+    int high=readShort();
+    if(low<0 || high<0 || reader.seek(low | high<<16)==false) return false;
+    int skip=p.x();
+    unsigned short i=0;
+    while(i<length)
+    {
+        int n=readShort();
+        if(n<0) return false;
+        int count=(n & 0x7fff)+1;
+        if(n & 0x8000)
+        {
+            int c=readShort();
+            if(c<0) return false;
+            if(skip>=count)
+            {
+                skip-=count;
+                continue;
+            }
+            count=min<int>(count-skip,length-i);
+            skip=0;
+            for(int j=0;j<count;j++) colors[i++]=c;
+        } else {
+            if(skip>=count)
+            {
+                reader.skip(count*sizeof(Color));
+                skip-=count;
+                continue;
+            }
+            reader.skip(skip*sizeof(Color));
+            count=min<int>(count-skip,length-i);
+            skip=0;
+            for(int j=0;j<count;j++)
+            {
+                int c=readShort();
+                if(c<0) return false;
+                colors[i++]=c;
+            }
+        }
+    }
+    return true;
+}
+
+int RawImage::readShort() const
+{
+    int low=reader.get();
+    int high=reader.get();
+    if(high<0) return -1;
+    return low | high<<8;
+}
+
+} //namespace mxgui
@@ -0,0 +1,153 @@
+/***************************************************************************
+ *   Copyright (C) 2024 by Terraneo Federico                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "image.h"
+#include "byte_reader.h"
+
+#ifndef RAW_IMAGE_H
+#define	RAW_IMAGE_H
+
+namespace mxgui {
+
+/**
+ * \ingroup pub_iface
+ * This is a class for handling images already converted to the display pixel
+ * format, as produced by "pngconverter --binary", for example while building
+ * a RomFs image with "buildromfs --convert". Since the pixels need no decoding
+ * these images are fast to draw, and when they are stored in a memory mapped
+ * filesystem such as RomFs getData() returns a pointer to them in place, so
+ * the display drivers can draw them at bus speed without copying them to RAM.
+ * Images in other filesystems are read one scanline at a time, like TgaImage.
+ *
+ * The file format is little endian, and starts with a header of three
+ * unsigned shorts: height, width and pixel depth, that can be 8 or 16 and
+ * must match the mxgui color depth. Uncompressed pixels follow, left to right
+ * and top to bottom. If bit rleFlag of the pixel depth is set the image is
+ * 16 bit and compressed with run length encoding. In this case, after another
+ * unsigned short of padding, follows an unsigned int per line with the file
+ * offset of the line. Every line is compressed independently as a sequence of
+ * runs, each starting with an unsigned short n. If its most significant bit is
+ * set it is followed by a pixel to repeat (n & 0x7fff)+1 times, otherwise by
+ * n+1 pixels to copy as they are. Compressed images take less space, but can
+ * only be drawn one scanline at a time, and getData() returns NULL for them.
+ */
+class RawImage : public ImageBase
+{
+public:
+    /**
+     * Default constructor
+     */
+    RawImage() : ImageBase(), name(0) {}
+
+    /**
+     * Construct from a filename
+     * \param filename file name of the image
+     */
+    explicit RawImage(const char *filename): name(0) { this->open(filename); }
+
+    /**
+     * Copy constructor
+     * \param rhs instance to copy from
+     */
+    RawImage(const RawImage& rhs): ImageBase(), name(0) { this->open(rhs.name); }
+
+    /**
+     * Operator =
+     * \param rhs instance to copy from
+     * \return reference to *this
+     */
+    const RawImage& operator= (const RawImage& rhs)
+    {
+        if(this!=&rhs)
+        {
+            if(rhs.name) this->open(rhs.name);
+            else this->close();
+        }
+        return *this;
+    }
+
+    /**
+     * Open an image file
+     * \param filename file name of the image
+     */
+    void open(const char *filename);
+
+    /**
+     * Close image file
+     */
+    void close();
+
+    /**
+     * \return true if image is open
+     */
+    bool isOpen() const { return name!=0; }
+
+    /**
+     * \return a pointer to the image pixels if the image is uncompressed and
+     * stored in a memory mapped filesystem, NULL otherwise
+     */
+    virtual const Color *getData() const { return data; }
+
+    /**
+     * Get pixels from tha image. This member function can be used to get
+     * up to a full horizontal line of pixels from an image.
+     * \param p Start point, within <0,0> and <getWidth()-1,getHeight()-1>
+     * \param colors pixel data is returned here. Array size must be equal to
+     * the length parameter
+     * \param length number of pixel to retrieve from the starting point.
+     * start.x()+length must be less or equal to getWidth()
+     * \return true if success. If false then it means the class does not
+     * represent a valid image, or a disk error occurred in case the image
+     * is stored on disk.
+     */
+    virtual bool getScanLine(mxgui::Point p, mxgui::Color colors[],
+            unsigned short length) const;
+
+    /**
+     * Destructor
+     */
+    virtual ~RawImage() { close(); }
+
+    /// Bit of the pixel depth field set in run length encoded images
+    static const unsigned short rleFlag=0x100;
+
+private:
+    /**
+     * Read a little endian unsigned short from the current file position
+     * \return the value read, or -1 at end of file
+     */
+    int readShort() const;
+
+    char *name; ///< File name. Also if == NULL it means the file is closed
+    mutable ByteReader reader; ///< Image file, accessed in place if possible
+    const Color *data=nullptr; ///< Pixels, if uncompressed and memory mapped
+    bool rle=false; ///< True if the image is run length encoded
+};
+
+} //namespace mxgui
+
+#endif //RAW_IMAGE_H
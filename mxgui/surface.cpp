@@ -0,0 +1,240 @@
+/***************************************************************************
+ *   Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016 by Terraneo Federico *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#include "surface.h"
+#include "misc_inst.h"
+#include "line.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace mxgui {
+
+//
+// class Surface
+//
+
+Surface::Surface(short width, short height)
+    : width(width), height(height), pixels(new Color[width*height]),
+      owner(true), buffer(nullptr)
+{
+    setTextColor(make_pair(white,black));
+}
+
+Surface::Surface(short width, short height, Color *pixels)
+    : width(width), height(height), pixels(pixels), owner(false),
+      buffer(nullptr)
+{
+    setTextColor(make_pair(white,black));
+}
+
+void Surface::blit(DrawingContext& dc, Point p) const
+{
+    blit(dc,p,Point(0,0),Point(width-1,height-1));
+}
+
+void Surface::blit(DrawingContext& dc, Point p, Point a, Point b) const
+{
+    if(a.x()<0 || a.y()<0 || b.x()>=width || b.y()>=height
+        || b.x()<a.x() || b.y()<a.y()) return;
+    #ifndef MXGUI_COLOR_DEPTH_1_BIT_LINEAR
+    //The surface is shown to the display as an image in memory, that drivers
+    //can send in a single transfer. When whole rows are copied they are
+    //contiguous in memory, so the image starts from the first one
+    if(a.x()==0 && b.x()==width-1)
+    {
+        Image img(b.y()-a.y()+1,width,pixels+a.y()*width);
+        dc.drawImage(p,img);
+    } else {
+        Image img(height,width,pixels);
+        Point q(p.x()+b.x()-a.x(),p.y()+b.y()-a.y());
+        dc.clippedDrawImage(Point(p.x()-a.x(),p.y()-a.y()),p,q,img);
+    }
+    #else //MXGUI_COLOR_DEPTH_1_BIT_LINEAR
+    //In memory 1bpp images have 8 pixels per byte, while surfaces one per
+    //byte, so they are sent a scanline at a time
+    for(short y=a.y();y<=b.y();y++)
+        dc.scanLine(Point(p.x(),p.y()+y-a.y()),pixels+a.x()+y*width,
+                    b.x()-a.x()+1);
+    #endif //MXGUI_COLOR_DEPTH_1_BIT_LINEAR
+}
+
+void Surface::doTurnOn() {}
+
+void Surface::doTurnOff() {}
+
+void Surface::doSetBrightness(int brt) {}
+
+pair<short int, short int> Surface::doGetSize() const
+{
+    return make_pair(height,width);
+}
+
+void Surface::write(Point p, const char *text)
+{
+    font.draw(*this,textColor,p,text);
+}
+
+void Surface::clippedWrite(Point p, Point a, Point b, const char *text)
+{
+    font.clippedDraw(*this,textColor,p,a,b,text);
+}
+
+void Surface::clear(Color color)
+{
+    fill(pixels,pixels+width*height,color);
+}
+
+void Surface::clear(Point p1, Point p2, Color color)
+{
+    if(p1.x()<0 || p2.x()<p1.x() || p2.x()>=width
+     ||p1.y()<0 || p2.y()<p1.y() || p2.y()>=height) return;
+    for(short y=p1.y();y<=p2.y();y++)
+    {
+        Color *row=pixels+y*width;
+        fill(row+p1.x(),row+p2.x()+1,color);
+    }
+}
+
+void Surface::beginPixel() {}
+
+void Surface::setPixel(Point p, Color color)
+{
+    if(p.x()<0 || p.x()>=width || p.y()<0 || p.y()>=height) return;
+    doSetPixel(p.x(),p.y(),color);
+}
+
+void Surface::line(Point a, Point b, Color color)
+{
+    //Horizontal line speed optimization
+    if(a.y()==b.y())
+    {
+        short minx=min(a.x(),b.x());
+        short maxx=max(a.x(),b.x());
+        if(minx<0 || maxx>=width || a.y()<0 || a.y()>=height) return;
+        Color *row=pixels+a.y()*width;
+        fill(row+minx,row+maxx+1,color);
+        return;
+    }
+    //Vertical line speed optimization
+    if(a.x()==b.x())
+    {
+        short miny=min(a.y(),b.y());
+        short maxy=max(a.y(),b.y());
+        if(a.x()<0 || a.x()>=width || miny<0 || maxy>=height) return;
+        Color *ptr=pixels+a.x()+miny*width;
+        for(short y=miny;y<=maxy;y++)
+        {
+            *ptr=color;
+            ptr+=width;
+        }
+        return;
+    }
+    //General case
+    Line::draw(*this,a,b,color);
+}
+
+void Surface::scanLine(Point p, const Color *colors, unsigned short length)
+{
+    if(p.x()<0 || static_cast<int>(p.x())+static_cast<int>(length)>width
+        ||p.y()<0 || p.y()>=height) return;
+    memcpy(pixels+p.x()+p.y()*width,colors,length*sizeof(Color));
+}
+
+Color *Surface::getScanLineBuffer()
+{
+    if(buffer==nullptr) buffer=new Color[width];
+    return buffer;
+}
+
+void Surface::scanLineBuffer(Point p, unsigned short length)
+{
+    scanLine(p,buffer,length);
+}
+
+void Surface::drawImage(Point p, const ImageBase& img)
+{
+    short int xEnd=p.x()+img.getWidth()-1;
+    short int yEnd=p.y()+img.getHeight()-1;
+    if(p.x()<0 || p.y()<0 || xEnd<p.x() || yEnd<p.y()
+        ||xEnd >= width || yEnd >= height) return;
+
+    #ifndef MXGUI_COLOR_DEPTH_1_BIT_LINEAR
+    //In memory images have the same pixel format, so copy them a row at a time
+    const Color *imgData=img.getData();
+    if(imgData!=nullptr)
+    {
+        short imgWidth=img.getWidth();
+        for(short y=0;y<img.getHeight();y++)
+            memcpy(pixels+p.x()+(p.y()+y)*width,imgData+y*imgWidth,
+                   imgWidth*sizeof(Color));
+        return;
+    }
+    #endif //MXGUI_COLOR_DEPTH_1_BIT_LINEAR
+    img.draw(*this,p);
+}
+
+void Surface::clippedDrawImage(Point p, Point a, Point b, const ImageBase& img)
+{
+    img.clippedDraw(*this,p,a,b);
+}
+
+void Surface::drawRectangle(Point a, Point b, Color c)
+{
+    line(a,Point(b.x(),a.y()),c);
+    line(Point(b.x(),a.y()),b,c);
+    line(b,Point(a.x(),b.y()),c);
+    line(Point(a.x(),b.y()),a,c);
+}
+
+Surface::pixel_iterator Surface::begin(Point p1, Point p2, IteratorDirection d)
+{
+    if(p1.x()<0 || p1.y()<0 || p2.x()>=width || p2.y()>=height
+        || p2.x()<p1.x() || p2.y()<p1.y())
+    {
+        //Return invalid (dummy) iterators
+        this->last=pixel_iterator();
+        return this->last;
+    }
+
+    int w=p2.x()-p1.x()+1;
+    int h=p2.y()-p1.y()+1;
+    //Only the number of written pixels is used to compare with last
+    this->last=pixel_iterator(nullptr,w*h,0,0,0);
+    Color *first=pixels+p1.x()+p1.y()*width;
+    if(d==RD) return pixel_iterator(first,0,w,1,width-w+1);
+    else return pixel_iterator(first,0,h,width,1-(h-1)*width);
+}
+
+Surface::~Surface()
+{
+    if(owner) delete[] pixels;
+    delete[] buffer;
+}
+
+} //namespace mxgui
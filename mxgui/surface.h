@@ -0,0 +1,371 @@
+/***************************************************************************
+ *   Copyright (C) 2011, 2012, 2013, 2014, 2015, 2016 by Terraneo Federico *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   As a special exception, if other files instantiate templates or use   *
+ *   macros or inline functions from this file, or you compile this file   *
+ *   and link it with other works to produce a work based on this file,    *
+ *   this file does not by itself cause the resulting work to be covered   *
+ *   by the GNU General Public License. However the source code for this   *
+ *   file must still be made available in accordance with the GNU General  *
+ *   Public License. This exception does not invalidate any other reasons  *
+ *   why a work based on this file might be covered by the GNU General     *
+ *   Public License.                                                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, see <http://www.gnu.org/licenses/>   *
+ ***************************************************************************/
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include <config/mxgui_settings.h>
+#include "display.h"
+#include "point.h"
+#include "color.h"
+#include "iterator_direction.h"
+
+namespace mxgui {
+
+/**
+ * \ingroup pub_iface
+ * An off-screen surface, that is, an in-memory framebuffer that can be drawn
+ * with the same API as a display and then copied to a display with blit().
+ * Drawing a composite widget such as a plot or a label over an image in a
+ * surface and then blitting it avoids flicker, as the display never shows a
+ * partially drawn widget, and is faster on displays connected through a bus,
+ * as the widget is sent in a single transfer instead of one for every
+ * drawing primitive.
+ *
+ * To draw on a surface, create a DrawingContext on it:
+ * \code
+ * Surface surface(100,50);
+ * {
+ *     DrawingContext sdc(surface);
+ *     sdc.clear(black);
+ *     sdc.write(Point(0,0),"Hello");
+ * }
+ * DrawingContext dc(DisplayManager::instance().getDisplay());
+ * surface.blit(dc,Point(10,10));
+ * \endcode
+ * Pixels are stored with the configured color depth, one Color per pixel.
+ * The surface is not registered in the DisplayManager, and turning it on or
+ * off or setting its brightness does nothing.
+ */
+class Surface : public Display
+{
+public:
+    /**
+     * Constructor, allocates the pixels on the heap
+     * \param width surface width
+     * \param height surface height
+     */
+    Surface(short width, short height);
+
+    /**
+     * Constructor, uses memory provided by the caller for the pixels, such as
+     * a statically allocated buffer or a buffer reused for many surfaces
+     * \param width surface width
+     * \param height surface height
+     * \param pixels width*height pixels, that must remain valid for the
+     * lifetime of the surface and are not deallocated by it
+     */
+    Surface(short width, short height, Color *pixels);
+
+    /**
+     * Copy the whole surface to a display
+     * \param dc drawing context of the display
+     * \param p point of the display where the upper left corner of the
+     * surface is copied
+     */
+    void blit(DrawingContext& dc, Point p) const;
+
+    /**
+     * Copy a rectangle of the surface to a display
+     * \param dc drawing context of the display
+     * \param p point of the display where the upper left corner of the
+     * rectangle is copied
+     * \param a upper left corner of the rectangle of the surface to copy
+     * \param b lower right corner of the rectangle of the surface to copy
+     */
+    void blit(DrawingContext& dc, Point p, Point a, Point b) const;
+
+    /**
+     * \return the pixels of the surface, stored row by row
+     */
+    Color *getPixels() { return pixels; }
+
+    /**
+     * \return the pixels of the surface, stored row by row
+     */
+    const Color *getPixels() const { return pixels; }
+
+    /**
+     * Turn the display On after it has been turned Off.
+     * Does nothing for a surface.
+     */
+    void doTurnOn() override;
+
+    /**
+     * Turn the display Off. It can be later turned back On.
+     * Does nothing for a surface.
+     */
+    void doTurnOff() override;
+
+    /**
+     * Set display brightness. Does nothing for a surface.
+     * \param brt from 0 to 100
+     */
+    void doSetBrightness(int brt) override;
+
+    /**
+     * \return a pair with the surface height and width
+     */
+    std::pair<short int, short int> doGetSize() const override;
+
+    /**
+     * Write text to the surface. If text is too long it will be truncated
+     * \param p point where the upper left corner of the text will be printed
+     * \param text, text to print.
+     */
+    void write(Point p, const char *text) override;
+
+    /**
+     * Write part of text to the surface
+     * \param p point of the upper left corner where the text will be drawn.
+     * Negative coordinates are allowed, as long as the clipped view has
+     * positive or zero coordinates
+     * \param a Upper left corner of clipping rectangle
+     * \param b Lower right corner of clipping rectangle
+     * \param text text to write
+     */
+    void clippedWrite(Point p, Point a, Point b, const char *text) override;
+
+    /**
+     * Clear the surface. It will be filled with the desired color
+     * \param color fill color
+     */
+    void clear(Color color) override;
+
+    /**
+     * Clear an area of the surface
+     * \param p1 upper left corner of area to clear
+     * \param p2 lower right corner of area to clear
+     * \param color fill color
+     */
+    void clear(Point p1, Point p2, Color color) override;
+
+    /**
+     * This backend does not require it, so it is a blank.
+     */
+    void beginPixel() override;
+
+    /**
+     * Draw a pixel with desired color. You have to call beginPixel() once
+     * before calling setPixel()
+     * \param p point where to draw pixel
+     * \param color pixel color
+     */
+    void setPixel(Point p, Color color) override;
+
+    /**
+     * Draw a line between point a and point b, with color c
+     * \param a first point
+     * \param b second point
+     * \param c line color
+     */
+    void line(Point a, Point b, Color color) override;
+
+    /**
+     * Draw an horizontal line on the surface.
+     * Instead of line(), this member function takes an array of colors to be
+     * able to individually set pixel colors of a line.
+     * \param p starting point of the line
+     * \param colors an array of pixel colors whoase size must be b.x()-a.x()+1
+     * \param length length of colors array.
+     * p.x()+length must be <= surface.width()
+     */
+    void scanLine(Point p, const Color *colors, unsigned short length) override;
+
+    /**
+     * \return a buffer of length equal to this->getWidth() that can be used to
+     * render a scanline.
+     */
+    Color *getScanLineBuffer() override;
+
+    /**
+     * Draw the content of the last getScanLineBuffer() on an horizontal line
+     * on the surface.
+     * \param p starting point of the line
+     * \param length length of colors array.
+     * p.x()+length must be <= surface.width()
+     */
+    void scanLineBuffer(Point p, unsigned short length) override;
+
+    /**
+     * Draw an image on the surface
+     * \param p point of the upper left corner where the image will be drawn
+     * \param i image to draw
+     */
+    void drawImage(Point p, const ImageBase& img) override;
+
+    /**
+     * Draw part of an image on the surface
+     * \param p point of the upper left corner where the image will be drawn.
+     * Negative coordinates are allowed, as long as the clipped view has
+     * positive or zero coordinates
+     * \param a Upper left corner of clipping rectangle
+     * \param b Lower right corner of clipping rectangle
+     * \param i Image to draw
+     */
+    void clippedDrawImage(Point p, Point a, Point b, const ImageBase& img) override;
+
+    /**
+     * Draw a rectangle (not filled) with the desired color
+     * \param a upper left corner of the rectangle
+     * \param b lower right corner of the rectangle
+     * \param c color of the line
+     */
+    void drawRectangle(Point a, Point b, Color c) override;
+
+    /**
+     * Pixel iterator. A pixel iterator is an output iterator that allows to
+     * define a window on the surface and write to its pixels.
+     */
+    class pixel_iterator
+    {
+    public:
+        /**
+         * Default constructor, results in an invalid iterator.
+         */
+        pixel_iterator() : ptr(nullptr), left(0), count(0), reload(0),
+                           next(0), wrap(0) {}
+
+        /**
+         * Set a pixel and move the pointer to the next one
+         * \param color color to set the current pixel
+         * \return a reference to this
+         */
+        pixel_iterator& operator= (Color color)
+        {
+            if(ptr==nullptr) return *this;
+            *ptr=color;
+            if(--left>0) ptr+=next;
+            else {
+                left=reload;
+                ptr+=wrap;
+            }
+            count++;
+            return *this;
+        }
+
+        /**
+         * Compare two pixel_iterators for equality.
+         * They are equal if they point to the same location.
+         */
+        bool operator== (const pixel_iterator& itr)
+        {
+            return this->count==itr.count;
+        }
+
+        /**
+         * Compare two pixel_iterators for inequality.
+         * They different if they point to different locations.
+         */
+        bool operator!= (const pixel_iterator& itr)
+        {
+            return this->count!=itr.count;
+        }
+
+        /**
+         * \return a reference to this.
+         */
+        pixel_iterator& operator* () { return *this; }
+
+        /**
+         * \return a reference to this. Does not increment pixel pointer.
+         */
+        pixel_iterator& operator++ ()  { return *this; }
+
+        /**
+         * \return a reference to this. Does not increment pixel pointer.
+         */
+        pixel_iterator& operator++ (int)  { return *this; }
+
+        /**
+         * Must be called if not all pixels of the required window are going
+         * to be written.
+         */
+        void invalidate() {}
+
+    private:
+        /**
+         * Constructor
+         * \param ptr first pixel of the window
+         * \param count number of pixels already written, to compare iterators
+         * \param reload pixels in a row, or a column for DR
+         * \param next offset to the next pixel in the row, or column for DR
+         * \param wrap offset from the last pixel of a row to the first pixel
+         * of the next one, or columns for DR
+         */
+        pixel_iterator(Color *ptr, int count, int reload, int next, int wrap)
+            : ptr(ptr), left(reload), count(count), reload(reload),
+              next(next), wrap(wrap) {}
+
+        Color *ptr; ///< Pixel that will be written next
+        int left;   ///< Pixels left in the current row or column
+        int count;  ///< Pixels written so far
+        int reload, next, wrap;
+
+        friend class Surface; //Needs access to ctor
+    };
+
+    /**
+     * Specify a window on the surface and return an object that allows to
+     * write its pixels.
+     * Note: a call to begin() will invalidate any previous iterator.
+     * \param p1 upper left corner of window
+     * \param p2 lower right corner (included)
+     * \param d increment direction
+     * \return a pixel iterator
+     */
+    pixel_iterator begin(Point p1, Point p2, IteratorDirection d);
+
+    /**
+     * \return an iterator which is one past the last pixel in the pixel
+     * specified by begin. Behaviour is undefined if called before calling
+     * begin()
+     */
+    pixel_iterator end() const { return last; }
+
+    /**
+     * Destructor
+     */
+    ~Surface();
+
+private:
+    /**
+     * Non bound checked setPixel
+     */
+    void doSetPixel(short x, short y, Color c) { pixels[x+y*width]=c; }
+
+    const short int width;
+    const short int height;
+    Color *pixels;       ///< Surface pixels
+    bool owner;          ///< True if pixels were allocated by the surface
+    Color *buffer;       ///< For scanLineBuffer, allocated on first use
+    pixel_iterator last; ///< Last iterator for end of iteration check
+};
+
+} //namespace mxgui
+
+#endif //SURFACE_H
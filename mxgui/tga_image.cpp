@@ -27,10 +27,186 @@
 
 #include "tga_image.h"
 #include <cstring>
-#include <iostream>
+#include <algorithm>
+
+using namespace std;
 
 namespace mxgui {
 
+namespace {
+
+/**
+ * Convert a pixel with 8 bits per channel to the mxgui color depth,
+ * specialized for every Color type
+ */
+template<typename C>
+C fromRGB(unsigned int r, unsigned int g, unsigned int b);
+
+template<>
+inline unsigned short fromRGB<unsigned short>(unsigned int r, unsigned int g,
+        unsigned int b)
+{
+    return (r & 0xf8)<<8 | (g & 0xfc)<<3 | b>>3;
+}
+
+template<>
+inline unsigned char fromRGB<unsigned char>(unsigned int r, unsigned int g,
+        unsigned int b)
+{
+    return (r & 0xe0) | (g & 0xe0)>>3 | b>>6;
+}
+
+template<>
+inline Color1bitlinear fromRGB<Color1bitlinear>(unsigned int r,
+        unsigned int g, unsigned int b)
+{
+    //Same as pngconverter, only pixels with no black channel are white
+    return (r!=0 && g!=0 && b!=0) ? 1 : 0;
+}
+
+/**
+ * Convert a pixel as stored in a tga file with B bytes per pixel
+ */
+template<unsigned int B>
+Color convertPixel(const unsigned char *pix);
+
+//Grayscale
+template<>
+inline Color convertPixel<1>(const unsigned char *pix)
+{
+    return fromRGB<Color>(pix[0],pix[0],pix[0]);
+}
+
+//Truecolor, 15 or 16 bit, 5 bits per channel
+template<>
+inline Color convertPixel<2>(const unsigned char *pix)
+{
+    unsigned int p=pix[0] | pix[1]<<8;
+    unsigned int r=(p>>7) & 0xf8;
+    unsigned int g=(p>>2) & 0xf8;
+    unsigned int b=(p<<3) & 0xf8;
+    return fromRGB<Color>(r | r>>5, g | g>>5, b | b>>5);
+}
+
+//Truecolor, 24 bit
+template<>
+inline Color convertPixel<3>(const unsigned char *pix)
+{
+    return fromRGB<Color>(pix[2],pix[1],pix[0]);
+}
+
+//Truecolor, 32 bit, alpha is ignored
+template<>
+inline Color convertPixel<4>(const unsigned char *pix)
+{
+    return fromRGB<Color>(pix[2],pix[1],pix[0]);
+}
+
+/**
+ * Convert a run of pixels as stored in a tga file with B bytes per pixel
+ */
+template<unsigned int B>
+void convertPixels(const unsigned char *pix, Color colors[], int length)
+{
+    for(int i=0;i<length;i++,pix+=B) colors[i]=convertPixel<B>(pix);
+}
+
+/**
+ * Reads a file in chunks as large as a caller provided buffer, used to decode
+ * run length encoded images where the size of a row is not known in advance
+ */
+class ChunkReader
+{
+public:
+    /**
+     * Constructor
+     * \param f file to read
+     * \param buffer buffer where the file is read
+     * \param size size of buffer
+     */
+    ChunkReader(FILE *f, unsigned char *buffer, unsigned int size)
+        : f(f), buffer(buffer), size(size), pos(buffer), end(buffer), offset(0) {}
+
+    /**
+     * Move to a file offset
+     * \return false on failure
+     */
+    bool seek(unsigned int o)
+    {
+        pos=end=buffer;
+        offset=o;
+        return fseek(f,o,SEEK_SET)==0;
+    }
+
+    /**
+     * \param n number of bytes to read, must be less or equal than the buffer
+     * size
+     * \return a pointer to the next n bytes, or NULL if the file ends first
+     */
+    const unsigned char *get(unsigned int n)
+    {
+        if(static_cast<unsigned int>(end-pos)<n && refill(n)==false) return 0;
+        const unsigned char *result=pos;
+        pos+=n;
+        return result;
+    }
+
+    /**
+     * Skip n bytes
+     * \return false on failure
+     */
+    bool skip(unsigned int n)
+    {
+        unsigned int buffered=end-pos;
+        if(n<=buffered)
+        {
+            pos+=n;
+            return true;
+        }
+        return seek(offset+n-buffered);
+    }
+
+    /**
+     * \return the number of bytes that get() can return without reading the
+     * file
+     */
+    unsigned int available() const { return end-pos; }
+
+    /**
+     * \return the file offset of the next byte get() will return
+     */
+    unsigned int tell() const { return offset-(end-pos); }
+
+private:
+    /**
+     * Keep the buffered bytes and fill the rest of the buffer from the file
+     * \return true if at least n bytes are buffered
+     */
+    bool refill(unsigned int n)
+    {
+        unsigned int buffered=end-pos;
+        memmove(buffer,pos,buffered);
+        unsigned int r=fread(buffer+buffered,1,size-buffered,f);
+        offset+=r;
+        pos=buffer;
+        end=buffer+buffered+r;
+        return buffered+r>=n;
+    }
+
+    FILE *f;
+    unsigned char *buffer;
+    unsigned int size;
+    unsigned char *pos; ///< Next byte to return
+    unsigned char *end; ///< One past the last buffered byte
+    unsigned int offset; ///< File offset of end
+};
+
+} //anonymous namespace
+
+//
+// class TgaImage
+//
+
 void TgaImage::open(const char *filename)
 {
     if(filename==0) return;
@@ -39,17 +215,29 @@ void TgaImage::open(const char *filename)
     //Try to open file
     this->f=fopen(filename,"rb");
     if(this->f==NULL) return;
-    //setbuf(this->f,0); //Too slow if unbuffered
+    //Rows are read in bulk into row, so buffering them also in the FILE
+    //would only waste RAM and time copying them
+    setvbuf(this->f,NULL,_IONBF,0);
 
     //Try to parse header
     bool fail=false;
     TgaHeader header;
     if(fread(&header,1,sizeof(TgaHeader),this->f)!=sizeof(TgaHeader)) fail=true;
-    //TODO: more support for options
     //TODO: endianness
+    bool grayscale=(header.imgType & 0x7)==3;
+    bool rle=(header.imgType & 0x8)!=0;
     if(header.colorMapType!=0) fail=true; //Color maps unsupported
-    if(header.imgType!=2) fail=true;      //Only uncompressed truecolor image
-    if(header.pixDepth!=24) fail=true;    //Only 24bit images supported
+    //Only truecolor and grayscale images, uncompressed or run length encoded
+    if(header.imgType!=2 && header.imgType!=3 &&
+       header.imgType!=10 && header.imgType!=11) fail=true;
+    if(grayscale)
+    {
+        if(header.pixDepth!=8) fail=true;
+    } else if(header.pixDepth!=15 && header.pixDepth!=16 &&
+              header.pixDepth!=24 && header.pixDepth!=32) fail=true;
+    if(header.imgDesc & 0x10) fail=true; //Right to left images unsupported
+    if(header.width==0 || header.height==0) fail=true;
+    if(header.width>32767 || header.height>32767) fail=true;
     if(fail)
     {
         fclose(this->f);
@@ -59,9 +247,34 @@ void TgaImage::open(const char *filename)
     //Fill image data
     this->height=header.height;
     this->width=header.width;
-    //Image is stored with reversed y axis, so store the end of the image as
-    //offset and then use subraction to get current line
     this->offset=sizeof(TgaHeader)+header.idLength;
+    this->bytesPerPixel=(header.pixDepth+7)/8;
+    this->topDown=(header.imgDesc & 0x20)!=0;
+    this->rowSize=this->width*this->bytesPerPixel;
+    this->row=new unsigned char[this->rowSize];
+    if(rle)
+    {
+        this->rowIndex=new RowStart[this->height];
+        bool ok=false;
+        switch(this->bytesPerPixel)
+        {
+            case 1: ok=buildRowIndex<1>(); break;
+            case 2: ok=buildRowIndex<2>(); break;
+            case 3: ok=buildRowIndex<3>(); break;
+            case 4: ok=buildRowIndex<4>(); break;
+        }
+        if(ok==false)
+        {
+            delete[] this->rowIndex;
+            this->rowIndex=0;
+            delete[] this->row;
+            this->row=0;
+            this->width=0;
+            this->height=0;
+            fclose(this->f);
+            return;
+        }
+    }
 
     //Last, copy file name to local variable
     int length=strlen(filename)+1;
@@ -75,6 +288,10 @@ void TgaImage::close()
     delete[] this->name;
     this->name=0;
     fclose(this->f);
+    delete[] this->row;
+    this->row=0;
+    delete[] this->rowIndex;
+    this->rowIndex=0;
     this->width=0;
     this->height=0;
     this->offset=0;
@@ -83,18 +300,135 @@ void TgaImage::close()
 bool TgaImage::getScanLine(mxgui::Point p, mxgui::Color colors[],
             unsigned short length) const
 {
-    std::cout << "Get Scanline";
     if(this->isOpen()==false) return false;
-    if(p.x()<0 || p.x()<0) return false;
-    if(p.x()>=this->getWidth() || p.y()>=this->getHeight()) return false;
-    int o=p.x()+this->getWidth()*p.y();
-    fseek(f,this->offset+3*o,SEEK_SET);
-    //TODO: specialize: this only works if MXGUI_COLOR_DEPTH_16_BIT
-    for(int i=0;i<length;i++)
+    if(p.x()<0 || p.y()<0) return false;
+    if(p.x()+length>this->getWidth() || p.y()>=this->getHeight()) return false;
+    //Rows are stored bottom to top unless the image says otherwise
+    int y=this->topDown ? p.y() : this->getHeight()-1-p.y();
+    switch(this->bytesPerPixel)
+    {
+        case 1:
+            if(this->rowIndex) return readRle<1>(y,p.x(),colors,length);
+            return readRaw<1>(y,p.x(),colors,length);
+        case 2:
+            if(this->rowIndex) return readRle<2>(y,p.x(),colors,length);
+            return readRaw<2>(y,p.x(),colors,length);
+        case 3:
+            if(this->rowIndex) return readRle<3>(y,p.x(),colors,length);
+            return readRaw<3>(y,p.x(),colors,length);
+        case 4:
+            if(this->rowIndex) return readRle<4>(y,p.x(),colors,length);
+            return readRaw<4>(y,p.x(),colors,length);
+    }
+    return false;
+}
+
+template<unsigned int B>
+bool TgaImage::buildRowIndex()
+{
+    //Every packet starts with a byte whose most significant bit selects
+    //between a run of pixels all equal, followed by only one pixel, or
+    //pixels stored as they are. The other bits are the number of pixels-1
+    ChunkReader in(this->f,this->row,this->rowSize);
+    if(in.seek(this->offset)==false) return false;
+    this->rowIndex[0].offset=this->offset;
+    this->rowIndex[0].skip=0;
+    int y=0;
+    unsigned int pixels=0; //Pixels already read of row y
+    while(y<this->getHeight())
+    {
+        unsigned int packet=in.tell();
+        const unsigned char *header=in.get(1);
+        if(header==0) return false;
+        unsigned int n=(*header & 0x7f)+1;
+        if(*header & 0x80)
+        {
+            if(in.get(B)==0) return false;
+        } else if(in.skip(n*B)==false) return false;
+        pixels+=n;
+        while(pixels>=static_cast<unsigned int>(this->getWidth()))
+        {
+            pixels-=this->getWidth();
+            if(++y>=this->getHeight()) break;
+            if(pixels==0)
+            {
+                this->rowIndex[y].offset=in.tell();
+                this->rowIndex[y].skip=0;
+            } else {
+                //The packet spans the two rows
+                this->rowIndex[y].offset=packet;
+                this->rowIndex[y].skip=n-pixels;
+            }
+        }
+    }
+    return true;
+}
+
+template<unsigned int B>
+bool TgaImage::readRaw(int y, int x, mxgui::Color colors[], int length) const
+{
+    unsigned int o=this->offset+(y*this->getWidth()+x)*B;
+    if(fseek(this->f,o,SEEK_SET)!=0) return false;
+    unsigned int size=length*B;
+    if(fread(this->row,1,size,this->f)!=size) return false;
+    convertPixels<B>(this->row,colors,length);
+    return true;
+}
+
+template<unsigned int B>
+bool TgaImage::readRle(int y, int x, mxgui::Color colors[], int length) const
+{
+    ChunkReader in(this->f,this->row,this->rowSize);
+    if(in.seek(this->rowIndex[y].offset)==false) return false;
+    //Pixels to discard, of previous rows and before x
+    int skip=this->rowIndex[y].skip+x;
+    while(length>0)
     {
-        unsigned char pix[3];
-        if(fread(pix,1,3,f)!=3) return false;
-        colors[i]=(pix[2] & 0xf8)<<8 | (pix[1] & 0xfc)<<3 | pix[0]>>3;
+        const unsigned char *header=in.get(1);
+        if(header==0) return false;
+        int n=(*header & 0x7f)+1;
+        if(*header & 0x80)
+        {
+            const unsigned char *pix=in.get(B);
+            if(pix==0) return false;
+            if(n<=skip)
+            {
+                skip-=n;
+                continue;
+            }
+            n=min(n-skip,length);
+            skip=0;
+            length-=n;
+            Color c=convertPixel<B>(pix);
+            for(int i=0;i<n;i++) *colors++=c;
+        } else {
+            if(n<=skip)
+            {
+                skip-=n;
+                if(in.skip(n*B)==false) return false;
+                continue;
+            }
+            if(in.skip(skip*B)==false) return false;
+            n=min(n-skip,length);
+            skip=0;
+            length-=n;
+            while(n>0)
+            {
+                //Convert together all the pixels already in the buffer
+                int m=min<int>(n,in.available()/B);
+                if(m==0)
+                {
+                    const unsigned char *pix=in.get(B);
+                    if(pix==0) return false;
+                    *colors++=convertPixel<B>(pix);
+                    n--;
+                } else {
+                    convertPixels<B>(in.get(m*B),colors,m);
+                    colors+=m;
+                    n-=m;
+                }
+            }
+        }
     }
     return true;
 }
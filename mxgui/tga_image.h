@@ -37,10 +37,14 @@ namespace mxgui {
  * \ingroup pub_iface
  * This is a class for handling .tga images stored on disk.
  * It is optimized for memory usage, so that it can used on arbitrary sized
- * images on microcontrollers. To do this it does not load the image on disk
- * and only fseeks around as needed. The obvious drawback is that it is heavy
- * on disk bandwidth, but there's no other way to do that when you don't have
- * enough RAM
+ * images on microcontrollers. To do this it does not load the image in RAM,
+ * only a buffer the size of an uncompressed row of pixels, and reads every
+ * requested scanline from disk with a single bulk read.
+ * Supported images are truecolor with 15, 16, 24 or 32 bits per pixel and
+ * grayscale with 8 bits per pixel, both uncompressed and run length encoded,
+ * stored top to bottom or bottom to top. The alpha channel is ignored.
+ * To seek to any scanline of a run length encoded image, the file offset of
+ * every scanline is found when the image is opened and stored in RAM.
  */
 class TgaImage : public ImageBase
 {
@@ -48,19 +52,25 @@ public:
     /**
      * Default constructor
      */
-    TgaImage() : ImageBase(), name(0), f(0), offset(0) {}
+    TgaImage() : ImageBase(), name(0), f(0), row(0), rowIndex(0) {}
 
     /**
      * Construct from a filename
      * \param filename file name of tga image
      */
-    explicit TgaImage(const char *filename): name(0) { this->open(filename); }
+    explicit TgaImage(const char *filename): name(0), row(0), rowIndex(0)
+    {
+        this->open(filename);
+    }
 
     /**
      * Copy constructor
      * \param rhs instance to copy from
      */
-    TgaImage(const TgaImage& rhs): name(0) { this->open(rhs.name); }
+    TgaImage(const TgaImage& rhs): ImageBase(), name(0), row(0), rowIndex(0)
+    {
+        this->open(rhs.name);
+    }
 
     /**
      * Operator =
@@ -132,9 +142,46 @@ private:
         unsigned char imgDesc;
     };
 
+    /**
+     * Where a row of a run length encoded image starts. Packets can span
+     * rows, so a row may start in the middle of a packet
+     */
+    struct RowStart
+    {
+        unsigned int offset; ///< File offset of the packet the row starts in
+        unsigned char skip;  ///< Pixels of the packet that belong to previous rows
+    };
+
+    /**
+     * Find where every row of a run length encoded image starts
+     * \param B bytes per pixel
+     * \return false if the image is truncated or corrupted
+     */
+    template<unsigned int B>
+    bool buildRowIndex();
+
+    /**
+     * Get pixels from an uncompressed image, parameters as getScanLine()
+     * \param B bytes per pixel
+     */
+    template<unsigned int B>
+    bool readRaw(int y, int x, mxgui::Color colors[], int length) const;
+
+    /**
+     * Get pixels from a run length encoded image, parameters as getScanLine()
+     * \param B bytes per pixel
+     */
+    template<unsigned int B>
+    bool readRle(int y, int x, mxgui::Color colors[], int length) const;
+
     char *name; ///< File name. Also if == NULL it means the file is closed
     FILE *f; ///< Tga image file
-    short offset; ///< Offset from start of file where image data starts
+    unsigned int offset; ///< Offset from start of file where image data starts
+    unsigned char *row; ///< Buffer for one row of pixels as stored in the file
+    unsigned int rowSize; ///< Size of row in bytes
+    RowStart *rowIndex; ///< Start of every row if run length encoded, or NULL
+    unsigned char bytesPerPixel; ///< 1 to 4
+    bool topDown; ///< True if the first row in the file is the top one
 };
 
 } //namespace mmxgui